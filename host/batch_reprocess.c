@@ -0,0 +1,225 @@
+/**
+ * Batch reprocessing of recorded raw frames
+ *
+ * Recordings are packet streams as a device sends them in raw output mode (MLX SET OUT RAW), e.g. the
+ * bytes read from its serial port: EEPROM packets followed by raw subpages.
+ *
+ * Usage:
+ *   batch_reprocess synth recording [frames]
+ *   batch_reprocess run recording output.f32 [threads] [emissivity] [ambient offset]
+ *   batch_reprocess scale recording [max threads]
+ *
+ * synth writes a synthetic recording. run converts every frame with the given calibration settings and
+ * writes the frames as raw little-endian float32 frames, the frame_codec_bench input format. scale
+ * converts the recording with 1, 2, 4 ... max threads, reports frames/s and checks that every run gives
+ * the same frames as a sequential conversion.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "mlx_batch.h"
+#include "mlx_synthetic.h"
+#include "transport_fd.h"
+
+#define DEFAULT_FRAMES 100000
+#define FRAME_BYTES (MLX90640_PIXEL_NUM * sizeof(float))
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Synthetic recording, chess pattern at 64 subpages per second
+ */
+static int synth(const char *path, uint32_t frames)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static MlxCalibration_type calibration;
+	static uint16_t raw[MLX_PACKET_RAW_WORDS];
+	static float scene[MLX90640_PIXEL_NUM];
+	Transport_type transport;
+	TransportFd_type backend;
+	MlxPacketHeader_type header;
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		perror(path);
+		return 1;
+	}
+	transport_fd_init(&transport, &backend, fd, "recording");
+	mlx_synthetic_eeprom(eeprom);
+	mlx_calibration_init(&calibration, eeprom);
+	mlx_packet_header_init(&header, MLX_PACKET_EEPROM, 0, 0, sizeof(eeprom));
+	mlx_packet_write(&transport, &header, (const uint8_t *)eeprom);
+
+	for (uint32_t n = 0; n < frames; n++)
+	{
+		mlx_synthetic_scene(scene, n / 2);
+		mlx_synthetic_subpage(&calibration, scene, 1, n % 2, raw);
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, n, (uint64_t)n * 15625, sizeof(raw));
+		header.pixel_format = MLX_PIXEL_RAW;
+		header.subpage = n % 2;
+		if (mlx_packet_write(&transport, &header, (const uint8_t *)raw) != 0)
+		{
+			perror(path);
+			close(fd);
+			return 1;
+		}
+	}
+	close(fd);
+	printf("%s: %u raw frames\n", path, frames);
+	return 0;
+}
+
+/**
+ * @brief Frames of a run, written in place so threads never wait for each other
+ */
+typedef struct RunOutput_type
+{
+	int fd;
+	uint32_t *checksums; // scale mode
+} RunOutput_type;
+
+static void frame_write(void *context, uint32_t index, const MlxPacketHeader_type *header, const float *temps, float ta)
+{
+	(void)header;
+	(void)ta;
+	RunOutput_type *output = (RunOutput_type *)context;
+	if (pwrite(output->fd, temps, FRAME_BYTES, (off_t)index * FRAME_BYTES) != (ssize_t)FRAME_BYTES)
+	{
+		perror("pwrite");
+	}
+}
+
+static void frame_checksum(void *context, uint32_t index, const MlxPacketHeader_type *header, const float *temps, float ta)
+{
+	(void)header;
+	(void)ta;
+	RunOutput_type *output = (RunOutput_type *)context;
+	output->checksums[index] = mlx_crc32(0, (const uint8_t *)temps, FRAME_BYTES);
+}
+
+static int open_recording(MlxBatch_type *batch, const char *path)
+{
+	double start = now_s();
+	if (mlx_batch_open(batch, path) != 0)
+	{
+		fprintf(stderr, "Cannot open %s\n", path);
+		return -1;
+	}
+	printf("%s: %.1f MB, %u raw frames, %u calibrations, %u crc errors, indexed in %.1f ms\n", path, batch->size / 1e6,
+		   batch->frame_count, batch->calibration_count, batch->crc_errors, (now_s() - start) * 1e3);
+	return 0;
+}
+
+static int run(const char *path, const char *output_path, int threads, float emissivity, float ambient_offset)
+{
+	MlxBatch_type batch;
+	if (open_recording(&batch, path) != 0)
+	{
+		return 1;
+	}
+	RunOutput_type output = {.fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+	if (output.fd < 0)
+	{
+		perror(output_path);
+		mlx_batch_close(&batch);
+		return 1;
+	}
+	MlxBatchOptions_type options = {
+		.threads = threads,
+		.emissivity = emissivity,
+		.ambient_offset = ambient_offset,
+		.callback = frame_write,
+		.context = &output,
+	};
+	double start = now_s();
+	int converted = mlx_batch_run(&batch, &options);
+	double elapsed = now_s() - start;
+	close(output.fd);
+	printf("%d frames in %.2f s, %.0f frames/s\n", converted, elapsed, converted / elapsed);
+	int result = (converted == (int)batch.frame_count) ? 0 : 1;
+	mlx_batch_close(&batch);
+	return result;
+}
+
+static int scale(const char *path, int max_threads)
+{
+	MlxBatch_type batch;
+	if (open_recording(&batch, path) != 0)
+	{
+		return 1;
+	}
+	uint32_t *reference = calloc(batch.frame_count, sizeof(uint32_t));
+	RunOutput_type output = {.checksums = calloc(batch.frame_count, sizeof(uint32_t))};
+	MlxBatchOptions_type options = {
+		.emissivity = MLX_EMISSIVITY,
+		.ambient_offset = MLX_TA_OFFSET,
+		.callback = frame_checksum,
+		.context = &output,
+	};
+
+	// One thread, one chunk: the sequential conversion every run is checked against
+	options.threads = 1;
+	options.chunk_frames = batch.frame_count;
+	mlx_batch_run(&batch, &options);
+	memcpy(reference, output.checksums, batch.frame_count * sizeof(uint32_t));
+	options.chunk_frames = 0;
+
+	printf("threads  frames/s  speedup  efficiency  mismatches\n");
+	double single_fps = 0;
+	for (int threads = 1; threads <= max_threads;)
+	{
+		memset(output.checksums, 0, batch.frame_count * sizeof(uint32_t));
+		options.threads = threads;
+		double start = now_s();
+		int converted = mlx_batch_run(&batch, &options);
+		double fps = converted / (now_s() - start);
+		single_fps = (threads == 1) ? fps : single_fps;
+		uint32_t mismatches = 0;
+		for (uint32_t n = 0; n < batch.frame_count; n++)
+		{
+			mismatches += (output.checksums[n] != reference[n]);
+		}
+		printf("%7d %9.0f %8.2f %10.0f%% %11u\n", threads, fps, fps / single_fps, 100 * fps / single_fps / threads, mismatches);
+		// 1, 2, 4 ... and max_threads itself
+		threads = (threads == max_threads) ? max_threads + 1 : (threads * 2 < max_threads) ? threads * 2 : max_threads;
+	}
+	free(reference);
+	free(output.checksums);
+	mlx_batch_close(&batch);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "synth") == 0)
+	{
+		return synth(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 10) : DEFAULT_FRAMES);
+	}
+	if (argc >= 4 && strcmp(argv[1], "run") == 0)
+	{
+		return run(argv[2], argv[3], (argc > 4) ? atoi(argv[4]) : 0, (argc > 5) ? strtof(argv[5], NULL) : MLX_EMISSIVITY,
+				   (argc > 6) ? strtof(argv[6], NULL) : MLX_TA_OFFSET);
+	}
+	if (argc >= 3 && strcmp(argv[1], "scale") == 0)
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		int max_threads = (argc > 3) ? atoi(argv[3]) : (cores > 1 ? cores : 2);
+		return scale(argv[2], (max_threads < MLX_BATCH_MAX_THREADS) ? max_threads : MLX_BATCH_MAX_THREADS);
+	}
+	fprintf(stderr, "Usage: %s synth recording [frames]\n"
+					"       %s run recording output.f32 [threads] [emissivity] [ambient offset]\n"
+					"       %s scale recording [max threads]\n",
+			argv[0], argv[0], argv[0]);
+	return 1;
+}
@@ -0,0 +1,131 @@
+/**
+ * Host calibration benchmark
+ *
+ * Converts raw subpages (MLX SET OUT RAW) with the Melexis reference math, as the firmware does per
+ * subpage (MLX90640_GetTa, MLX90640_CalculateTo, MLX90640_BadPixelsCorrection), and with the compiled
+ * calibration of mlx_calibration_convert. Reports the time per subpage, the speedup and the largest
+ * difference between both.
+ *
+ * Without an EEPROM file a synthetic EEPROM is used. The raw subpages of a test scene are produced with
+ * mlx_synthetic_subpage, the inverse of the reference math, so both conversions give back the scene
+ * within MLX_SYNTHETIC_TOLERANCE.
+ *
+ * Usage: calibration_bench [eeprom file, 832 little-endian words as sent in MLX_PACKET_EEPROM] [subpages]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "mlx_calibration.h"
+#include "mlx_protocol.h"
+#include "mlx_synthetic.h"
+
+#define PIXELS 768
+#define DEFAULT_SUBPAGES 200000
+#define INIT_RUNS 200
+#define SUBPAGE_RATE 64 /*!< Subpages per second of a device at 32 Hz*/
+#define SCENE_SUBPAGES 4 /*!< Chess and interleaved, both subpages*/
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Firmware per subpage conversion, mlx_calculate_subpage_temps
+ */
+static void convert_reference(paramsMLX90640 *params, uint16_t *raw, float *temps, float emissivity, float ambient_offset)
+{
+	float tr = MLX90640_GetTa(raw, params) + ambient_offset;
+	MLX90640_CalculateTo(raw, params, emissivity, tr, temps);
+	int mode = (raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
+	MLX90640_BadPixelsCorrection(params->brokenPixels, temps, mode, params);
+	MLX90640_BadPixelsCorrection(params->outlierPixels, temps, mode, params);
+}
+
+int main(int argc, char **argv)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static MlxCalibration_type calibration;
+	static paramsMLX90640 params;
+	static uint16_t raw[SCENE_SUBPAGES][MLX_PACKET_RAW_WORDS];
+	static float scene[PIXELS];
+	static float reference[PIXELS];
+	static float prepared[PIXELS];
+	int subpages = (argc > 2) ? atoi(argv[2]) : DEFAULT_SUBPAGES;
+
+	if (mlx_synthetic_load_eeprom((argc > 1) ? argv[1] : NULL, eeprom) != 0)
+	{
+		fprintf(stderr, "Cannot read %d EEPROM words from %s\n", MLX_PACKET_EEPROM_WORDS, argv[1]);
+		return 1;
+	}
+
+	double start = now_s();
+	for (int run = 0; run < INIT_RUNS; run++)
+	{
+		MLX90640_ExtractParameters(eeprom, &params);
+	}
+	double extract_s = (now_s() - start) / INIT_RUNS;
+	start = now_s();
+	for (int run = 0; run < INIT_RUNS; run++)
+	{
+		if (mlx_calibration_init(&calibration, eeprom) != 0)
+		{
+			fprintf(stderr, "Invalid EEPROM\n");
+			return 1;
+		}
+	}
+	double init_s = (now_s() - start) / INIT_RUNS;
+	printf("EEPROM: ExtractParameters %.1f us, mlx_calibration_init %.1f us\n", extract_s * 1e6, init_s * 1e6);
+
+	mlx_synthetic_scene(scene, 0);
+	for (int n = 0; n < SCENE_SUBPAGES; n++)
+	{
+		mlx_synthetic_subpage(&calibration, scene, n / 2, n % 2, raw[n]);
+	}
+
+	// Accuracy over both patterns and subpages, both outputs start from the same frame
+	float max_difference = 0;
+	float max_scene_error = 0;
+	for (int n = 0; n < SCENE_SUBPAGES; n++)
+	{
+		float ta = 0;
+		convert_reference(&params, raw[n], reference, calibration.emissivity, calibration.ambient_offset);
+		mlx_calibration_convert(&calibration, raw[n], prepared, &ta);
+		for (int pixel = 0; pixel < PIXELS; pixel++)
+		{
+			max_difference = fmaxf(max_difference, fabsf(reference[pixel] - prepared[pixel]));
+		}
+		if (n % 2 == 1)
+		{
+			for (int pixel = 0; pixel < PIXELS; pixel++)
+			{
+				max_scene_error = fmaxf(max_scene_error, fabsf(reference[pixel] - scene[pixel]));
+			}
+			printf("%s: Ta %.2f C, pixel 0 %.2f C, spot %.2f C (scene %.2f / %.2f C)\n", (n / 2) ? "chess" : "interleaved",
+				   ta, reference[0], reference[12 * 32 + 16], scene[0], scene[12 * 32 + 16]);
+		}
+	}
+
+	start = now_s();
+	for (int n = 0; n < subpages; n++)
+	{
+		convert_reference(&params, raw[n % SCENE_SUBPAGES], reference, calibration.emissivity, calibration.ambient_offset);
+	}
+	double reference_s = (now_s() - start) / subpages;
+	start = now_s();
+	for (int n = 0; n < subpages; n++)
+	{
+		mlx_calibration_convert(&calibration, raw[n % SCENE_SUBPAGES], prepared, NULL);
+	}
+	double prepared_s = (now_s() - start) / subpages;
+
+	printf("reference: %8.2f us per subpage, %6.0f devices per core\n", reference_s * 1e6, 1 / (reference_s * SUBPAGE_RATE));
+	printf("prepared:  %8.2f us per subpage, %6.0f devices per core\n", prepared_s * 1e6, 1 / (prepared_s * SUBPAGE_RATE));
+	printf("speedup %.1fx, max difference %.5f C, scene error %.3f C\n", reference_s / prepared_s, max_difference, max_scene_error);
+	return 0;
+}
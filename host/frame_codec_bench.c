@@ -0,0 +1,173 @@
+/**
+ * Frame codec benchmark
+ *
+ * Encodes a sequence of 768 pixel float32 frames with frame_codec, decodes it again and reports the
+ * compression ratio against the float32 and int16 payloads, the encode / decode time per frame and
+ * the largest reconstruction error.
+ *
+ * Usage: frame_codec_bench [frames.f32] [frames]
+ *
+ * frames.f32 is a file of raw little-endian float32 frames, e.g. MLX_PIXEL_FLOAT32 payloads dumped from
+ * the UART stream. Without a file a synthetic scene is used: a static gradient with sensor noise and a
+ * warm blob moving across the frame.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "frame_codec.h"
+#include "pixel_encoding.h"
+#include "mlx_protocol.h"
+
+#define ROWS 24
+#define COLS 32
+#define DEFAULT_FRAMES 1024
+
+static double now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Standard normal sample (Box-Muller)
+ */
+static float noise(void)
+{
+	float u1 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+	float u2 = (rand() + 1.0f) / (RAND_MAX + 2.0f);
+	return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+static void synthetic_frame(float *temps, int n)
+{
+	float blob_x = fmodf(n * 0.25f, COLS + 8) - 4;
+	float blob_y = ROWS / 2 + 6 * sinf(n * 0.05f);
+	for (int row = 0; row < ROWS; row++)
+	{
+		for (int col = 0; col < COLS; col++)
+		{
+			float dx = col - blob_x;
+			float dy = row - blob_y;
+			float temp = 22.0f + 0.1f * row + 0.05f * col;
+			temp += 12.0f * expf(-(dx * dx + dy * dy) / 8.0f);
+			temps[row * COLS + col] = temp + 0.08f * noise();
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int frames = DEFAULT_FRAMES;
+	float *input = NULL;
+
+	if (argc > 1)
+	{
+		FILE *file = fopen(argv[1], "rb");
+		if (file == NULL)
+		{
+			perror(argv[1]);
+			return 1;
+		}
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		frames = size / (FRAME_CODEC_PIXELS * sizeof(float));
+		if (argc > 2 && atoi(argv[2]) > 0 && atoi(argv[2]) < frames)
+		{
+			frames = atoi(argv[2]);
+		}
+		input = malloc((size_t)frames * FRAME_CODEC_PIXELS * sizeof(float));
+		if (input == NULL || fread(input, FRAME_CODEC_PIXELS * sizeof(float), frames, file) != (size_t)frames)
+		{
+			fprintf(stderr, "failed to read %d frames from %s\n", frames, argv[1]);
+			fclose(file);
+			return 1;
+		}
+		fclose(file);
+	}
+	else
+	{
+		srand(1);
+		input = malloc((size_t)frames * FRAME_CODEC_PIXELS * sizeof(float));
+		if (input == NULL)
+		{
+			return 1;
+		}
+		for (int n = 0; n < frames; n++)
+		{
+			synthetic_frame(&input[n * FRAME_CODEC_PIXELS], n);
+		}
+	}
+	if (frames == 0)
+	{
+		fprintf(stderr, "no frames\n");
+		return 1;
+	}
+
+	static FrameCodec_type encoder;
+	static FrameCodec_type decoder;
+	frame_codec_init(&encoder, FRAME_CODEC_STEP, FRAME_CODEC_KEY_INTERVAL);
+	frame_codec_init(&decoder, FRAME_CODEC_STEP, FRAME_CODEC_KEY_INTERVAL);
+
+	uint8_t *payloads = malloc((size_t)frames * FRAME_CODEC_PIXELS * 2);
+	int *sizes = malloc(frames * sizeof(int));
+	float decoded[FRAME_CODEC_PIXELS];
+	size_t budget = FRAME_CODEC_PIXELS * pixel_format_size(MLX_PIXEL_INT16);
+	if (payloads == NULL || sizes == NULL)
+	{
+		return 1;
+	}
+
+	int fallbacks = 0;
+	size_t total = 0;
+	double start = now_us();
+	for (int n = 0; n < frames; n++)
+	{
+		sizes[n] = frame_codec_encode(&encoder, &input[n * FRAME_CODEC_PIXELS], &payloads[n * budget], budget);
+	}
+	double encode_us = (now_us() - start) / frames;
+
+	float max_error = 0;
+	start = now_us();
+	for (int n = 0; n < frames; n++)
+	{
+		if (sizes[n] < 0)
+		{
+			// The firmware sends these as MLX_PIXEL_INT16
+			fallbacks++;
+			total += budget;
+			continue;
+		}
+		total += sizes[n];
+		if (frame_codec_decode(&decoder, &payloads[n * budget], sizes[n], decoded) != 0)
+		{
+			fprintf(stderr, "frame %d: decode failed\n", n);
+			return 1;
+		}
+		for (int i = 0; i < FRAME_CODEC_PIXELS; i++)
+		{
+			float error = fabsf(decoded[i] - input[n * FRAME_CODEC_PIXELS + i]);
+			max_error = (error > max_error) ? error : max_error;
+		}
+	}
+	double decode_us = (now_us() - start) / (frames - fallbacks > 0 ? frames - fallbacks : 1);
+
+	double mean = (double)total / frames;
+	printf("frames            %d\n", frames);
+	printf("mean payload      %.1f B (F32 %d B, I16 %zu B)\n", mean, FRAME_CODEC_PIXELS * 4, budget);
+	printf("ratio vs F32      %.2fx\n", FRAME_CODEC_PIXELS * 4 / mean);
+	printf("ratio vs I16      %.2fx\n", budget / mean);
+	printf("I16 fallbacks     %d\n", fallbacks);
+	printf("encode            %.2f us/frame\n", encode_us);
+	printf("decode            %.2f us/frame\n", decode_us);
+	printf("max error         %.4f C (step %.2f C)\n", max_error, FRAME_CODEC_STEP);
+
+	free(input);
+	free(payloads);
+	free(sizes);
+	return (max_error <= FRAME_CODEC_STEP / 2 + 1e-4f) ? 0 : 1;
+}
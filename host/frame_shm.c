@@ -0,0 +1,156 @@
+#include "frame_shm.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/**
+ * @brief Create or reset the ring of a device
+ *
+ * @param name shared memory name, e.g. "/mlx_hall"
+ * @return FrameShm_type* mapped ring, NULL on errors
+ */
+FrameShm_type *frame_shm_create(const char *name)
+{
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	if (ftruncate(fd, sizeof(FrameShm_type)) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	FrameShm_type *shm = mmap(NULL, sizeof(FrameShm_type), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED)
+	{
+		return NULL;
+	}
+	memset(shm, 0, sizeof(FrameShm_type));
+	shm->version = FRAME_SHM_VERSION;
+	shm->slot_count = FRAME_SHM_SLOTS;
+	shm->slot_size = sizeof(FrameShmSlot_type);
+	// Readers check the magic last
+	atomic_thread_fence(memory_order_release);
+	shm->magic = FRAME_SHM_MAGIC;
+	return shm;
+}
+
+/**
+ * @brief Map the ring of a device read only
+ *
+ * @param name shared memory name
+ * @return FrameShm_type* mapped ring, NULL if missing or of another version
+ */
+FrameShm_type *frame_shm_open(const char *name)
+{
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	FrameShm_type *shm = mmap(NULL, sizeof(FrameShm_type), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shm == MAP_FAILED)
+	{
+		return NULL;
+	}
+	if (shm->magic != FRAME_SHM_MAGIC || shm->version != FRAME_SHM_VERSION || shm->slot_size != sizeof(FrameShmSlot_type))
+	{
+		munmap(shm, sizeof(FrameShm_type));
+		return NULL;
+	}
+	return shm;
+}
+
+void frame_shm_close(FrameShm_type *shm)
+{
+	munmap(shm, sizeof(FrameShm_type));
+}
+
+int frame_shm_unlink(const char *name)
+{
+	return shm_unlink(name);
+}
+
+/**
+ * @brief Start writing the next frame, readers skip the slot until frame_shm_commit
+ *
+ * @param shm ring
+ * @return FrameShmSlot_type* slot to fill
+ */
+FrameShmSlot_type *frame_shm_begin(FrameShm_type *shm)
+{
+	uint64_t frame = atomic_load_explicit(&shm->published, memory_order_relaxed);
+	FrameShmSlot_type *slot = &shm->slots[frame % FRAME_SHM_SLOTS];
+	atomic_store_explicit(&slot->sequence, 2 * frame + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	return slot;
+}
+
+/**
+ * @brief Publish the slot returned by frame_shm_begin
+ */
+void frame_shm_commit(FrameShm_type *shm, FrameShmSlot_type *slot)
+{
+	uint64_t frame = atomic_load_explicit(&shm->published, memory_order_relaxed);
+	atomic_store_explicit(&slot->sequence, 2 * frame + 2, memory_order_release);
+	atomic_store_explicit(&shm->published, frame + 1, memory_order_release);
+}
+
+/**
+ * @brief Zero-copy access to a published frame
+ *
+ * Read the slot in place, then check it with frame_shm_valid: the aggregator may have overwritten it
+ * in the meantime.
+ *
+ * @param shm ring
+ * @param frame frame index, published - 1 is the latest
+ * @param sequence slot sequence to pass to frame_shm_valid
+ * @return const FrameShmSlot_type* slot, NULL if the frame is not published or already overwritten
+ */
+const FrameShmSlot_type *frame_shm_slot(const FrameShm_type *shm, uint64_t frame, uint64_t *sequence)
+{
+	const FrameShmSlot_type *slot = &shm->slots[frame % FRAME_SHM_SLOTS];
+	*sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+	return (*sequence == 2 * frame + 2) ? slot : NULL;
+}
+
+/**
+ * @brief Check that a slot read in place was not overwritten while reading
+ *
+ * @return 1 valid
+ * @return 0 overwritten, read a newer frame
+ */
+int frame_shm_valid(const FrameShmSlot_type *slot, uint64_t sequence)
+{
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&slot->sequence, memory_order_relaxed) == sequence;
+}
+
+/**
+ * @brief Copy a published frame
+ *
+ * @param shm ring
+ * @param frame frame index, published - 1 is the latest
+ * @param copy output
+ * @return 0 OK
+ * @return -1 frame not published or overwritten
+ */
+int frame_shm_read(const FrameShm_type *shm, uint64_t frame, FrameShmSlot_type *copy)
+{
+	uint64_t sequence;
+	const FrameShmSlot_type *slot = frame_shm_slot(shm, frame, &sequence);
+	if (slot == NULL)
+	{
+		return -1;
+	}
+	memcpy(&copy->header, &slot->header, sizeof(copy->header));
+	copy->received_us = slot->received_us;
+	memcpy(copy->temps, slot->temps, sizeof(copy->temps));
+	atomic_store_explicit(&copy->sequence, sequence, memory_order_relaxed);
+	return frame_shm_valid(slot, sequence) ? 0 : -1;
+}
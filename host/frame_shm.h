@@ -0,0 +1,72 @@
+#ifndef FRAME_SHM_H
+#define FRAME_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "mlx_protocol.h"
+
+#define FRAME_SHM_MAGIC 0x52584C4D /*!< "MLXR"*/
+#define FRAME_SHM_VERSION 1
+#define FRAME_SHM_SLOTS 16
+#define FRAME_SHM_PIXELS 768
+#define FRAME_SHM_NAME_SIZE 64
+
+/**
+ * @brief One published frame
+ *
+ * sequence is odd while the aggregator writes the slot and even once it is complete (seqlock).
+ */
+typedef struct FrameShmSlot_type
+{
+	atomic_uint_fast64_t sequence;
+	MlxPacketHeader_type header;
+	int64_t received_us; // CLOCK_MONOTONIC of the aggregator
+	float temps[FRAME_SHM_PIXELS];
+} FrameShmSlot_type;
+
+/**
+ * @brief Device counters, updated with every frame and once per second
+ */
+typedef struct FrameShmStats_type
+{
+	uint64_t frames;
+	uint64_t bytes;
+	uint32_t lost;			// sequence gaps
+	uint32_t crc_errors;
+	uint32_t skipped_bytes;
+	uint32_t reconnects;
+	uint32_t connected;
+	float fps;				// frames per second over the last second
+	uint32_t latency_us;	// delay of the last frame above the fastest frame seen
+	uint32_t latency_max_us;
+} FrameShmStats_type;
+
+/**
+ * @brief Shared memory frame ring of one device, /dev/shm/<name>
+ *
+ * The aggregator is the only writer. Readers map the ring read only, read published and the slot at
+ * (published - 1) % slot_count without any system call.
+ */
+typedef struct FrameShm_type
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t slot_size;
+	atomic_uint_fast64_t published; // frames published
+	FrameShmStats_type stats;
+	FrameShmSlot_type slots[FRAME_SHM_SLOTS];
+} FrameShm_type;
+
+FrameShm_type *frame_shm_create(const char *name);
+FrameShm_type *frame_shm_open(const char *name);
+void frame_shm_close(FrameShm_type *shm);
+int frame_shm_unlink(const char *name);
+FrameShmSlot_type *frame_shm_begin(FrameShm_type *shm);
+void frame_shm_commit(FrameShm_type *shm, FrameShmSlot_type *slot);
+const FrameShmSlot_type *frame_shm_slot(const FrameShm_type *shm, uint64_t frame, uint64_t *sequence);
+int frame_shm_valid(const FrameShmSlot_type *slot, uint64_t sequence);
+int frame_shm_read(const FrameShm_type *shm, uint64_t frame, FrameShmSlot_type *copy);
+
+#endif // FRAME_SHM_H
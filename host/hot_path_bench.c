@@ -0,0 +1,270 @@
+/**
+ * Calibration hot path benchmark
+ *
+ * Times the per frame work of the firmware on the host: MLX90640_ExtractParameters, MLX90640_CalculateTo
+ * and MLX90640_GetImage of both subpages, MLX90640_BadPixelsCorrection of the broken and outlier pixels of
+ * both subpages, and mlx_merge_subpages in every pixel format. ExtractParameters runs once per EEPROM,
+ * its frame is one extraction. The fixture is an EEPROM file, or the synthetic EEPROM, and
+ * FIXTURE_FRAMES frames of the test scene made with mlx_synthetic_raw.
+ *
+ * The sources of these functions are compiled into every hot_path_bench_<variant> with the flags of the
+ * variant (host/CMakeLists.txt), the fixture code comes from mlx_host. Each sample times enough calls to
+ * last MIN_SAMPLE_NS. Mean, frames/s and percentiles of the samples are printed, and appended as one JSON
+ * object per function to the results file, with the tree version, variant and compiler.
+ *
+ * Usage: hot_path_bench_<variant> [eeprom|-] [samples] [results.jsonl]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "constants.h"
+#include "mlx_merge.h"
+#include "mlx_synthetic.h"
+
+#ifndef HOT_PATH_VARIANT
+#define HOT_PATH_VARIANT "default"
+#endif
+#ifndef HOT_PATH_VERSION
+#define HOT_PATH_VERSION "unknown"
+#endif
+
+#define DEFAULT_SAMPLES 2000
+#define FIXTURE_FRAMES 64
+#define MIN_SAMPLE_NS 20000 /*!< Calls per sample are raised until a sample takes this long*/
+#define WARMUP_NS 20000000
+
+static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+static paramsMLX90640 params;
+static paramsMLX90640 extracted;
+static uint16_t raw[FIXTURE_FRAMES][2][MLX_PACKET_RAW_WORDS];
+static float subpage_temps[FIXTURE_FRAMES][2][MLX90640_PIXEL_NUM];
+static float temps[2][MLX90640_PIXEL_NUM];
+static float frame_temps[MLX90640_PIXEL_NUM];
+static uint8_t encoded[MLX90640_PIXEL_NUM * sizeof(float)];
+static uint32_t frame;
+
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void extract_parameters(void)
+{
+	MLX90640_ExtractParameters(eeprom, &extracted);
+}
+
+static void calculate_to(void)
+{
+	for (int subpage = 0; subpage < 2; subpage++)
+	{
+		// tr as mlx_calculate_subpage_temps
+		uint16_t *words = raw[frame % FIXTURE_FRAMES][subpage];
+		MLX90640_CalculateTo(words, &params, MLX_EMISSIVITY, MLX90640_GetTa(words, &params) + MLX_TA_OFFSET, temps[subpage]);
+	}
+	frame++;
+}
+
+static void get_image(void)
+{
+	for (int subpage = 0; subpage < 2; subpage++)
+	{
+		MLX90640_GetImage(raw[frame % FIXTURE_FRAMES][subpage], &params, temps[subpage]);
+	}
+	frame++;
+}
+
+static void bad_pixels_correction(void)
+{
+	for (int subpage = 0; subpage < 2; subpage++)
+	{
+		memcpy(temps[subpage], subpage_temps[frame % FIXTURE_FRAMES][subpage], sizeof(temps[subpage]));
+		MLX90640_BadPixelsCorrection(params.brokenPixels, temps[subpage], 1, &params);
+		MLX90640_BadPixelsCorrection(params.outlierPixels, temps[subpage], 1, &params);
+	}
+	frame++;
+}
+
+static void merge(uint8_t pixel_format)
+{
+	float offset;
+	float scale;
+	float(*subpages)[MLX90640_PIXEL_NUM] = subpage_temps[frame % FIXTURE_FRAMES];
+	mlx_merge_subpages(frame_temps, subpages[0], subpages[1], pixel_format, encoded, &offset, &scale);
+	frame++;
+}
+
+static void merge_f32(void)
+{
+	merge(MLX_PIXEL_FLOAT32);
+}
+
+static void merge_f16(void)
+{
+	merge(MLX_PIXEL_FLOAT16);
+}
+
+static void merge_i16(void)
+{
+	merge(MLX_PIXEL_INT16);
+}
+
+static void merge_u8(void)
+{
+	merge(MLX_PIXEL_UINT8);
+}
+
+typedef struct HotPath_type
+{
+	const char *name;
+	void (*run)(void);
+} HotPath_type;
+
+static const HotPath_type hot_paths[] = {
+	{"MLX90640_ExtractParameters", extract_parameters},
+	{"MLX90640_CalculateTo", calculate_to},
+	{"MLX90640_GetImage", get_image},
+	{"MLX90640_BadPixelsCorrection", bad_pixels_correction},
+	{"mlx_merge_subpages F32", merge_f32},
+	{"mlx_merge_subpages F16", merge_f16},
+	{"mlx_merge_subpages I16", merge_i16},
+	{"mlx_merge_subpages U8", merge_u8},
+};
+
+static int compare_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest rank percentile of sorted samples
+ */
+static double percentile(const double *sorted, int count, double p)
+{
+	int rank = (int)(p / 100 * count + 0.5);
+	return sorted[(rank < 1) ? 0 : (rank > count) ? count - 1 : rank - 1];
+}
+
+/**
+ * @brief Fixture frames: the test scene at MLX_SYNTHETIC_TA and 3.3 V in chess mode, and its temperatures
+ */
+static int fixture_init(void)
+{
+	static float scene[MLX90640_PIXEL_NUM];
+	MlxSyntheticConditions_type conditions = {
+		.ta = MLX_SYNTHETIC_TA,
+		.vdd = 3.3f,
+		.emissivity = MLX_EMISSIVITY,
+		.tr = MLX_SYNTHETIC_TA + MLX_TA_OFFSET,
+		.chess = 1,
+	};
+	if (MLX90640_ExtractParameters(eeprom, &params) != MLX90640_NO_ERROR)
+	{
+		return -1;
+	}
+	for (int n = 0; n < FIXTURE_FRAMES; n++)
+	{
+		mlx_synthetic_scene(scene, n);
+		for (uint8_t subpage = 0; subpage < 2; subpage++)
+		{
+			if (mlx_synthetic_raw(&params, &conditions, scene, subpage, raw[n][subpage]) < 0)
+			{
+				return -1;
+			}
+			MLX90640_CalculateTo(raw[n][subpage], &params, conditions.emissivity, conditions.tr, subpage_temps[n][subpage]);
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *eeprom_path = (argc > 1) ? argv[1] : "-";
+	int samples = (argc > 2) ? atoi(argv[2]) : DEFAULT_SAMPLES;
+	const char *results_path = (argc > 3) ? argv[3] : NULL;
+	FILE *results = NULL;
+
+	if (samples < 1)
+	{
+		fprintf(stderr, "Usage: %s [eeprom|-] [samples] [results.jsonl]\n", argv[0]);
+		return 1;
+	}
+	if (mlx_synthetic_load_eeprom(eeprom_path, eeprom) != 0 || fixture_init() != 0)
+	{
+		fprintf(stderr, "Cannot use the EEPROM %s\n", eeprom_path);
+		return 1;
+	}
+	if (results_path != NULL && (results = fopen(results_path, "a")) == NULL)
+	{
+		perror(results_path);
+		return 1;
+	}
+	double *sample_ns = malloc(samples * sizeof(double));
+	if (sample_ns == NULL)
+	{
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("variant %s, %s, %s EEPROM, %d samples\n", HOT_PATH_VARIANT, __VERSION__,
+		   (strcmp(eeprom_path, "-") == 0) ? "synthetic" : eeprom_path, samples);
+	printf("%-30s %12s %12s %10s %10s %10s %10s\n", "function", "ns/frame", "frames/s", "p50", "p90", "p99", "max");
+	for (size_t h = 0; h < sizeof(hot_paths) / sizeof(hot_paths[0]); h++)
+	{
+		const HotPath_type *hot_path = &hot_paths[h];
+		int64_t start = now_ns();
+		int reps = 1;
+		frame = 0;
+		while (now_ns() - start < WARMUP_NS)
+		{
+			int64_t sample_start = now_ns();
+			for (int rep = 0; rep < reps; rep++)
+			{
+				hot_path->run();
+			}
+			if (now_ns() - sample_start < MIN_SAMPLE_NS)
+			{
+				reps *= 2;
+			}
+		}
+
+		double total_ns = 0;
+		for (int sample = 0; sample < samples; sample++)
+		{
+			int64_t sample_start = now_ns();
+			for (int rep = 0; rep < reps; rep++)
+			{
+				hot_path->run();
+			}
+			sample_ns[sample] = (double)(now_ns() - sample_start) / reps;
+			total_ns += sample_ns[sample];
+		}
+		qsort(sample_ns, samples, sizeof(double), compare_double);
+		double mean_ns = total_ns / samples;
+		double p50 = percentile(sample_ns, samples, 50);
+		double p90 = percentile(sample_ns, samples, 90);
+		double p99 = percentile(sample_ns, samples, 99);
+		printf("%-30s %12.1f %12.0f %10.1f %10.1f %10.1f %10.1f\n", hot_path->name, mean_ns, 1e9 / mean_ns, p50, p90, p99,
+			   sample_ns[samples - 1]);
+		if (results != NULL)
+		{
+			fprintf(results,
+					"{\"bench\":\"hot_path\",\"version\":\"%s\",\"variant\":\"%s\",\"compiler\":\"%s\",\"function\":\"%s\","
+					"\"samples\":%d,\"calls_per_sample\":%d,\"ns_per_frame\":%.1f,\"frames_per_s\":%.1f,"
+					"\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f}\n",
+					HOT_PATH_VERSION, HOT_PATH_VARIANT, __VERSION__, hot_path->name, samples, reps, mean_ns, 1e9 / mean_ns,
+					sample_ns[0], p50, p90, p99, sample_ns[samples - 1]);
+		}
+	}
+	free(sample_ns);
+	if (results != NULL)
+	{
+		fclose(results);
+	}
+	return 0;
+}
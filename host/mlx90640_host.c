@@ -0,0 +1,62 @@
+#include "mlx90640_api.h"
+#include "mlx_i2c_replay.h"
+
+#include <time.h>
+
+// Follows the attached replay, see mlx_i2c_replay.h
+int64_t esp_timer_get_time(void)
+{
+	if (mlx_i2c_replay_active != NULL)
+	{
+		return mlx_i2c_replay_now(mlx_i2c_replay_active);
+	}
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)(esp_timer_get_time() / 1000);
+}
+
+// The I2C bus is the attached replay, without one no sensor answers
+int MLX90640_I2CInit(void)
+{
+	return (mlx_i2c_replay_active != NULL) ? 0 : -MLX90640_I2C_NACK_ERROR;
+}
+
+int MLX90640_I2CGeneralReset(void)
+{
+	if (mlx_i2c_replay_active == NULL)
+	{
+		return -MLX90640_I2C_NACK_ERROR;
+	}
+	return mlx_i2c_replay_transaction(mlx_i2c_replay_active, MLX_I2C_TRACE_RESET, 0x0006, 0, NULL);
+}
+
+int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddressRead, uint16_t *data)
+{
+	(void)slaveAddr;
+	if (mlx_i2c_replay_active == NULL)
+	{
+		return -MLX90640_I2C_NACK_ERROR;
+	}
+	return mlx_i2c_replay_transaction(mlx_i2c_replay_active, MLX_I2C_TRACE_READ, startAddress, nMemAddressRead, data);
+}
+
+int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data)
+{
+	(void)slaveAddr;
+	(void)data; // the recorded result does not depend on it
+	if (mlx_i2c_replay_active == NULL)
+	{
+		return -MLX90640_I2C_NACK_ERROR;
+	}
+	return mlx_i2c_replay_transaction(mlx_i2c_replay_active, MLX_I2C_TRACE_WRITE, writeAddress, 1, NULL);
+}
+
+void MLX90640_I2CFreqSet(int freq)
+{
+	(void)freq;
+}
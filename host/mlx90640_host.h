@@ -0,0 +1,25 @@
+#ifndef MLX90640_HOST_H
+#define MLX90640_HOST_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Host port of the sensor driver
+ *
+ * Stands in for the ESP-IDF pieces mlx90640_api.c uses, so the EEPROM extraction and the temperature
+ * math run unchanged on the host. The I2C functions of mlx90640_i2c_driver.h are implemented in
+ * mlx90640_host.c on top of the attached I2C replay (mlx_i2c_replay.h), without one they report that no
+ * sensor is connected.
+ */
+typedef uint32_t TickType_t;
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+
+int64_t esp_timer_get_time(void);
+TickType_t xTaskGetTickCount(void);
+
+#endif // MLX90640_HOST_H
@@ -0,0 +1,445 @@
+/**
+ * Multi-device aggregator
+ *
+ * Reads the packet streams of many devices with one epoll loop and publishes every frame into a shared
+ * memory ring per device (frame_shm.h). Local consumers map the rings and read frames without system
+ * calls. The aggregator keeps every device supplied with MLX START credits and reconnects lost devices.
+ * Devices in raw output mode (MLX SET OUT RAW) are calibrated here, from the EEPROM they send.
+ *
+ * Usage:
+ *   mlx_aggregator [name=]endpoint ...
+ *   mlx_aggregator watch name
+ *
+ * endpoint is a serial port or pty path (/dev/ttyUSB0), tcp:address:port or udp:address:port. The ring
+ * of a device is /dev/shm/mlx_<name>, name defaults to mlx<index>.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#include "frame_shm.h"
+#include "mlx_receiver.h"
+#include "transport_fd.h"
+#include "transport_socket.h"
+
+#define MAX_DEVICES 64
+#define CREDIT_WINDOW 64		/*!< Frames granted ahead, topped up at half the window*/
+#define RECONNECT_US 1000000
+#define STALL_US 2000000		/*!< Re-grant credits after this long without frames, e.g. lost UDP commands*/
+#define STATS_PERIOD_US 1000000
+#define UART_BAUD B460800
+
+typedef struct AggregatorDevice_type
+{
+	char name[FRAME_SHM_NAME_SIZE];
+	char shm_name[FRAME_SHM_NAME_SIZE + 8];
+	const char *endpoint;
+	int fd;
+	Transport_type transport;
+	TransportFd_type fd_backend;
+	TransportSocket_type socket_backend;
+	MlxReceiver_type receiver;
+	FrameShm_type *shm;
+	int64_t connect_us;
+	int64_t last_frame_us;
+	int64_t delay_min_us;	// fastest frame, device and host clocks differ by an unknown offset
+	uint32_t last_sequence;
+	bool has_sequence;
+	int32_t credits;
+	uint64_t window_frames;
+} AggregatorDevice_type;
+
+static AggregatorDevice_type devices[MAX_DEVICES];
+static int device_count = 0;
+static volatile sig_atomic_t running = 1;
+
+static int64_t now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void stop(int signal)
+{
+	(void)signal;
+	running = 0;
+}
+
+/**
+ * @brief Open a serial port or pty in raw mode
+ *
+ * @return fd, -1 on errors
+ */
+static int open_serial(const char *path)
+{
+	struct termios tty;
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if (tcgetattr(fd, &tty) == 0)
+	{
+		cfmakeraw(&tty);
+		cfsetspeed(&tty, UART_BAUD);
+		tcsetattr(fd, TCSANOW, &tty);
+	}
+	return fd;
+}
+
+/**
+ * @brief Connect the transport of a device
+ *
+ * @return 0 OK
+ * @return -1 failed, retried after RECONNECT_US
+ */
+static int device_connect(AggregatorDevice_type *device, int epoll_fd)
+{
+	char host[64];
+	unsigned int port;
+
+	if (sscanf(device->endpoint, "tcp:%63[^:]:%u", host, &port) == 2 || sscanf(device->endpoint, "udp:%63[^:]:%u", host, &port) == 2)
+	{
+		uint8_t mode = (device->endpoint[0] == 'u') ? TRANSPORT_SOCKET_UDP : TRANSPORT_SOCKET_TCP;
+		if (transport_socket_connect(&device->transport, &device->socket_backend, mode, host, port) != 0)
+		{
+			return -1;
+		}
+		device->fd = device->socket_backend.fd;
+	}
+	else
+	{
+		device->fd = open_serial(device->endpoint);
+		if (device->fd < 0)
+		{
+			return -1;
+		}
+		transport_fd_init(&device->transport, &device->fd_backend, device->fd, "serial");
+	}
+
+	struct epoll_event event = {.events = EPOLLIN | EPOLLRDHUP, .data.u32 = device - devices};
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->fd, &event) != 0)
+	{
+		close(device->fd);
+		device->fd = -1;
+		return -1;
+	}
+	mlx_receiver_free(&device->receiver);
+	mlx_receiver_init(&device->receiver, &device->transport, 0);
+	device->connect_us = now_us();
+	device->last_frame_us = device->connect_us;
+	device->delay_min_us = INT64_MAX;
+	device->has_sequence = false;
+	device->credits = 0;
+	device->shm->stats.connected = 1;
+	return 0;
+}
+
+static void device_disconnect(AggregatorDevice_type *device, int epoll_fd)
+{
+	if (device->fd < 0)
+	{
+		return;
+	}
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+	close(device->fd);
+	device->fd = -1;
+	device->connect_us = now_us();
+	device->shm->stats.connected = 0;
+	device->shm->stats.reconnects++;
+	fprintf(stderr, "%s: disconnected from %s\n", device->name, device->endpoint);
+}
+
+/**
+ * @brief Keep CREDIT_WINDOW frames granted, so the device never waits for the host
+ *
+ * Forced grants also ask for the EEPROM until it arrived, raw frames cannot be converted without it.
+ */
+static void device_grant(AggregatorDevice_type *device, bool force)
+{
+	char command[48];
+	if (!force && device->credits > CREDIT_WINDOW / 2)
+	{
+		return;
+	}
+	int count = CREDIT_WINDOW - ((device->credits > 0) ? device->credits : 0);
+	const char *eeprom = (force && device->receiver.calibration == NULL) ? "++*MLX EEPROM*++" : "";
+	int size = snprintf(command, sizeof(command), "%s++*MLX START %d*++", eeprom, count);
+	if (transport_write(&device->transport, command, size) == size && transport_flush(&device->transport) == 0)
+	{
+		device->credits += count;
+	}
+}
+
+static void device_publish(AggregatorDevice_type *device, const MlxFrameView_type *view, int64_t received_us)
+{
+	FrameShmStats_type *stats = &device->shm->stats;
+	FrameShmSlot_type *slot = frame_shm_begin(device->shm);
+
+	// The sequence accounts for every frame once, including the ones that fail to decode below
+	uint32_t gap = device->has_sequence ? view->header.sequence - device->last_sequence : 1;
+	stats->lost += (gap > 1 && gap < 0x80000000u) ? gap - 1 : 0;
+	device->credits -= (gap < 0x80000000u) ? gap : 1;
+	device->last_sequence = view->header.sequence;
+	device->has_sequence = true;
+
+	if (mlx_receiver_convert(&device->receiver, view, slot->temps) != 0)
+	{
+		// Undecodable frames count as lost, the slot is reused by the next frame
+		stats->lost++;
+		return;
+	}
+	slot->header = view->header;
+	if (view->header.pixel_format == MLX_PIXEL_RAW)
+	{
+		slot->header.ta = device->receiver.raw_ta;
+	}
+	slot->received_us = received_us;
+	frame_shm_commit(device->shm, slot);
+
+	int64_t delay_us = received_us - (int64_t)view->header.timestamp_us;
+	device->delay_min_us = (delay_us < device->delay_min_us) ? delay_us : device->delay_min_us;
+	stats->latency_us = delay_us - device->delay_min_us;
+	stats->latency_max_us = (stats->latency_us > stats->latency_max_us) ? stats->latency_us : stats->latency_max_us;
+	stats->frames++;
+	device->window_frames++;
+	device->last_frame_us = received_us;
+}
+
+/**
+ * @brief Parse everything the device sent
+ *
+ * @return 0 OK
+ * @return -1 device closed
+ */
+static int device_receive(AggregatorDevice_type *device)
+{
+	MlxFrameView_type view;
+	FrameShmStats_type *stats = &device->shm->stats;
+	uint32_t crc_errors = device->receiver.crc_errors;
+	uint32_t skipped_bytes = device->receiver.skipped_bytes;
+	// A full ring is drained below, lost bytes show up as a sequence gap
+	int rx_size = mlx_receiver_fill(&device->receiver, 0);
+	if (rx_size < 0 && rx_size != MLX_RECEIVER_ERROR_FULL && rx_size != MLX_RECEIVER_ERROR_OVERFLOW)
+	{
+		return -1;
+	}
+	int64_t received_us = now_us();
+	while (mlx_receiver_next(&device->receiver, &view) == 1)
+	{
+		if (view.header.type == MLX_PACKET_FRAME)
+		{
+			device_publish(device, &view, received_us);
+		}
+		else if (view.header.type == MLX_PACKET_EEPROM && mlx_receiver_calibrate(&device->receiver, &view) != 0)
+		{
+			fprintf(stderr, "%s: invalid EEPROM\n", device->name);
+		}
+		mlx_receiver_release(&device->receiver, &view);
+	}
+	// The receiver restarts its counters on every connection, the ring keeps totals
+	stats->bytes += (rx_size > 0) ? rx_size : 0;
+	stats->crc_errors += device->receiver.crc_errors - crc_errors;
+	stats->skipped_bytes += device->receiver.skipped_bytes - skipped_bytes;
+	device_grant(device, false);
+	return 0;
+}
+
+static void print_stats(double period_s)
+{
+	printf("%-12s %8s %8s %10s %6s %6s %10s %10s\n", "device", "fps", "frames", "MB", "lost", "crc", "lat us", "max us");
+	for (int d = 0; d < device_count; d++)
+	{
+		AggregatorDevice_type *device = &devices[d];
+		FrameShmStats_type *stats = &device->shm->stats;
+		stats->fps = device->window_frames / period_s;
+		device->window_frames = 0;
+		printf("%-12s %8.1f %8lu %10.1f %6lu %6lu %10lu %10lu%s\n", device->name, stats->fps, (unsigned long)stats->frames,
+			   stats->bytes / 1e6, (unsigned long)stats->lost, (unsigned long)stats->crc_errors,
+			   (unsigned long)stats->latency_us, (unsigned long)stats->latency_max_us, stats->connected ? "" : " (down)");
+		stats->latency_max_us = 0;
+	}
+	fflush(stdout);
+}
+
+static int aggregate(void)
+{
+	struct epoll_event events[MAX_DEVICES];
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	int64_t stats_us = now_us();
+
+	if (epoll_fd < 0)
+	{
+		perror("epoll_create1");
+		return 1;
+	}
+	while (running)
+	{
+		int64_t now = now_us();
+		for (int d = 0; d < device_count; d++)
+		{
+			AggregatorDevice_type *device = &devices[d];
+			if (device->fd < 0 && now - device->connect_us >= RECONNECT_US)
+			{
+				device->connect_us = now;
+				if (device_connect(device, epoll_fd) == 0)
+				{
+					fprintf(stderr, "%s: connected to %s\n", device->name, device->endpoint);
+					device_grant(device, true);
+				}
+			}
+			else if (device->fd >= 0 && now - device->last_frame_us >= STALL_US)
+			{
+				device->last_frame_us = now;
+				device->credits = 0;
+				device_grant(device, true);
+			}
+		}
+
+		int ready = epoll_wait(epoll_fd, events, MAX_DEVICES, 100);
+		if (ready < 0 && errno != EINTR)
+		{
+			perror("epoll_wait");
+			break;
+		}
+		for (int i = 0; i < ready; i++)
+		{
+			AggregatorDevice_type *device = &devices[events[i].data.u32];
+			if (device_receive(device) != 0 || (events[i].events & (EPOLLHUP | EPOLLERR)))
+			{
+				device_disconnect(device, epoll_fd);
+			}
+		}
+
+		now = now_us();
+		if (now - stats_us >= STATS_PERIOD_US)
+		{
+			print_stats((now - stats_us) / 1e6);
+			stats_us = now;
+		}
+	}
+
+	for (int d = 0; d < device_count; d++)
+	{
+		device_disconnect(&devices[d], epoll_fd);
+		mlx_receiver_free(&devices[d].receiver);
+		frame_shm_close(devices[d].shm);
+		frame_shm_unlink(devices[d].shm_name);
+	}
+	close(epoll_fd);
+	return 0;
+}
+
+/**
+ * @brief Consumer example, follows the ring of one device
+ */
+static int watch(const char *name)
+{
+	char shm_name[FRAME_SHM_NAME_SIZE + 8];
+	FrameShmSlot_type *frame = malloc(sizeof(FrameShmSlot_type));
+	snprintf(shm_name, sizeof(shm_name), "/mlx_%s", name);
+	FrameShm_type *shm = frame_shm_open(shm_name);
+	if (shm == NULL || frame == NULL)
+	{
+		fprintf(stderr, "no ring %s\n", shm_name);
+		free(frame);
+		return 1;
+	}
+
+	uint64_t next = atomic_load(&shm->published);
+	uint64_t frames = 0;
+	uint64_t overwritten = 0;
+	int64_t delivery_us = 0;
+	int64_t report_us = now_us();
+	while (running)
+	{
+		uint64_t published = atomic_load_explicit(&shm->published, memory_order_acquire);
+		if (next == published)
+		{
+			usleep(200);
+		}
+		for (; next < published; next++)
+		{
+			if (frame_shm_read(shm, next, frame) != 0)
+			{
+				overwritten++;
+				continue;
+			}
+			delivery_us += now_us() - frame->received_us;
+			frames++;
+		}
+		if (now_us() - report_us >= STATS_PERIOD_US && frames > 0)
+		{
+			float min = frame->temps[0];
+			float max = frame->temps[0];
+			for (int i = 1; i < FRAME_SHM_PIXELS; i++)
+			{
+				min = (frame->temps[i] < min) ? frame->temps[i] : min;
+				max = (frame->temps[i] > max) ? frame->temps[i] : max;
+			}
+			printf("%s: frame %lu, %.2f .. %.2f C, %lu read, %lu overwritten, delivery %.0f us, device fps %.1f, lost %lu\n",
+				   name, (unsigned long)frame->header.sequence, min, max, (unsigned long)frames, (unsigned long)overwritten,
+				   (double)delivery_us / frames, shm->stats.fps, (unsigned long)shm->stats.lost);
+			fflush(stdout);
+			report_us = now_us();
+		}
+	}
+	frame_shm_close(shm);
+	free(frame);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+	signal(SIGPIPE, SIG_IGN);
+
+	if (argc == 3 && strcmp(argv[1], "watch") == 0)
+	{
+		return watch(argv[2]);
+	}
+	if (argc < 2 || argc - 1 > MAX_DEVICES)
+	{
+		fprintf(stderr, "usage: %s [name=]endpoint ... | watch name\n", argv[0]);
+		return 1;
+	}
+
+	for (int i = 1; i < argc; i++)
+	{
+		AggregatorDevice_type *device = &devices[device_count];
+		const char *separator = strchr(argv[i], '=');
+		if (separator != NULL && (size_t)(separator - argv[i]) < sizeof(device->name))
+		{
+			memcpy(device->name, argv[i], separator - argv[i]);
+			device->name[separator - argv[i]] = '\0';
+			device->endpoint = separator + 1;
+		}
+		else
+		{
+			snprintf(device->name, sizeof(device->name), "mlx%d", device_count);
+			device->endpoint = argv[i];
+		}
+		strcpy(device->shm_name, "/mlx_");
+		strcat(device->shm_name, device->name);
+		device->shm = frame_shm_create(device->shm_name);
+		if (device->shm == NULL)
+		{
+			perror(device->shm_name);
+			return 1;
+		}
+		device->fd = -1;
+		device->connect_us = now_us() - RECONNECT_US;
+		device_count++;
+	}
+	return aggregate();
+}
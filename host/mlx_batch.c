@@ -0,0 +1,302 @@
+#include "mlx_batch.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Per thread state, scratch buffers are reused for every frame the thread converts
+ */
+typedef struct MlxBatchWorker_type
+{
+	const MlxBatch_type *batch;
+	const MlxBatchOptions_type *options;
+	const MlxCalibration_type *calibrations; // with the options applied
+	atomic_uint *next_chunk;
+	uint32_t chunk_frames;
+	uint32_t converted;
+	uint16_t raw[MLX_PACKET_RAW_WORDS];
+	float frame[MLX90640_PIXEL_NUM];
+} __attribute__((aligned(64))) MlxBatchWorker_type;
+
+/**
+ * @brief Double the capacity of a growing array when it is full
+ *
+ * @return 0 OK
+ * @return -1 out of memory
+ */
+static int array_reserve(void **array, uint32_t count, uint32_t *capacity, size_t item_size)
+{
+	if (count < *capacity)
+	{
+		return 0;
+	}
+	uint32_t new_capacity = (*capacity == 0) ? 1024 : 2 * *capacity;
+	void *new_array = realloc(*array, (size_t)new_capacity * item_size);
+	if (new_array == NULL)
+	{
+		return -1;
+	}
+	*array = new_array;
+	*capacity = new_capacity;
+	return 0;
+}
+
+/**
+ * @brief Index the EEPROM and raw frame packets of a recording
+ *
+ * Corrupt data is skipped like mlx_receiver does, a truncated last packet is ignored.
+ *
+ * @return 0 OK
+ * @return -1 out of memory
+ */
+static int batch_index(MlxBatch_type *batch)
+{
+	uint32_t frame_capacity = 0;
+	uint32_t calibration_capacity = 0;
+	uint32_t segment_capacity = 0;
+	int64_t calibration = -1; // no valid EEPROM yet
+	size_t pos = 0;
+
+	while (batch->size - pos >= sizeof(MlxPacketHeader_type))
+	{
+		const uint8_t *data = batch->data + pos;
+		MlxPacketHeader_type header;
+
+		if (data[0] != MLX_PACKET_MAGIC_0)
+		{
+			const uint8_t *magic = memchr(data, MLX_PACKET_MAGIC_0, batch->size - pos);
+			size_t skip = (magic != NULL) ? (size_t)(magic - data) : batch->size - pos;
+			pos += skip;
+			batch->skipped_bytes += skip;
+			continue;
+		}
+		memcpy(&header, data, sizeof(header));
+		if (mlx_packet_header_validate(&header) != 0)
+		{
+			pos++;
+			batch->skipped_bytes++;
+			continue;
+		}
+		size_t packet_size = sizeof(header) + header.payload_length + MLX_PACKET_CRC_SIZE;
+		if (batch->size - pos < packet_size)
+		{
+			break;
+		}
+		const uint8_t *payload = data + sizeof(header);
+		uint32_t crc;
+		memcpy(&crc, payload + header.payload_length, sizeof(crc));
+		if (crc != mlx_packet_crc(&header, payload))
+		{
+			batch->crc_errors++;
+			pos++;
+			continue;
+		}
+		batch->packets++;
+
+		if (header.type == MLX_PACKET_EEPROM && header.payload_length == MLX_PACKET_EEPROM_WORDS * sizeof(uint16_t))
+		{
+			uint16_t eeprom[MLX_PACKET_EEPROM_WORDS];
+			if (array_reserve((void **)&batch->calibrations, batch->calibration_count, &calibration_capacity, sizeof(MlxCalibration_type)) != 0 ||
+				array_reserve((void **)&batch->segment_start, batch->calibration_count, &segment_capacity, sizeof(uint32_t)) != 0)
+			{
+				return -1;
+			}
+			memcpy(eeprom, payload, sizeof(eeprom));
+			calibration = -1;
+			if (mlx_calibration_init(&batch->calibrations[batch->calibration_count], eeprom) == 0)
+			{
+				calibration = batch->calibration_count;
+				batch->segment_start[batch->calibration_count] = batch->frame_count;
+				batch->calibration_count++;
+			}
+		}
+		else if (header.type == MLX_PACKET_FRAME && header.pixel_format == MLX_PIXEL_RAW &&
+				 header.payload_length == MLX_PACKET_RAW_WORDS * sizeof(uint16_t) && calibration >= 0)
+		{
+			if (array_reserve((void **)&batch->frames, batch->frame_count, &frame_capacity, sizeof(MlxBatchFrame_type)) != 0)
+			{
+				return -1;
+			}
+			batch->frames[batch->frame_count].offset = pos;
+			batch->frames[batch->frame_count].calibration = calibration;
+			batch->frame_count++;
+		}
+		pos += packet_size;
+	}
+	return 0;
+}
+
+/**
+ * @brief Map and index a recording
+ *
+ * @param batch output
+ * @param path recorded packet stream
+ * @return 0 OK
+ * @return -1 cannot open or map the file
+ * @return -2 out of memory
+ */
+int mlx_batch_open(MlxBatch_type *batch, const char *path)
+{
+	struct stat st;
+
+	memset(batch, 0, sizeof(MlxBatch_type));
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return -1;
+	}
+	batch->data = data;
+	batch->size = st.st_size;
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+	if (batch_index(batch) != 0)
+	{
+		mlx_batch_close(batch);
+		return -2;
+	}
+	// Chunks are read in parallel from here on
+	madvise(data, st.st_size, MADV_NORMAL);
+	return 0;
+}
+
+void mlx_batch_close(MlxBatch_type *batch)
+{
+	if (batch->data != NULL)
+	{
+		munmap((void *)batch->data, batch->size);
+	}
+	free(batch->frames);
+	free(batch->calibrations);
+	free(batch->segment_start);
+	memset(batch, 0, sizeof(MlxBatch_type));
+}
+
+/**
+ * @brief Convert the frames [start, end) into the worker frame
+ *
+ * The held pixels of the first frame come from up to MLX_BATCH_WARMUP_FRAMES frames before start, which
+ * are converted without callback. Results match a sequential conversion of the whole recording.
+ */
+static void batch_convert_chunk(MlxBatchWorker_type *worker, uint32_t start, uint32_t end)
+{
+	const MlxBatch_type *batch = worker->batch;
+	uint32_t segment_start = batch->segment_start[batch->frames[start].calibration];
+	uint32_t first = (start - segment_start > MLX_BATCH_WARMUP_FRAMES) ? start - MLX_BATCH_WARMUP_FRAMES : segment_start;
+
+	memset(worker->frame, 0, sizeof(worker->frame));
+	for (uint32_t index = first; index < end; index++)
+	{
+		const MlxBatchFrame_type *frame = &batch->frames[index];
+		// A new EEPROM starts from an empty frame, like mlx_receiver_calibrate
+		if (index > first && batch->segment_start[frame->calibration] == index)
+		{
+			memset(worker->frame, 0, sizeof(worker->frame));
+		}
+		MlxPacketHeader_type header;
+		float ta;
+		memcpy(&header, batch->data + frame->offset, sizeof(header));
+		memcpy(worker->raw, batch->data + frame->offset + sizeof(header), sizeof(worker->raw));
+		if (mlx_calibration_convert(&worker->calibrations[frame->calibration], worker->raw, worker->frame, &ta) < 0 || index < start)
+		{
+			continue;
+		}
+		worker->converted++;
+		if (worker->options->callback != NULL)
+		{
+			worker->options->callback(worker->options->context, index, &header, worker->frame, ta);
+		}
+	}
+}
+
+static void *batch_worker(void *params)
+{
+	MlxBatchWorker_type *worker = (MlxBatchWorker_type *)params;
+	uint32_t frame_count = worker->batch->frame_count;
+
+	while (1)
+	{
+		// Chunks are handed out in order, a thread that finishes early takes the next one
+		uint64_t start = (uint64_t)atomic_fetch_add(worker->next_chunk, 1) * worker->chunk_frames;
+		if (start >= frame_count)
+		{
+			break;
+		}
+		uint32_t end = (start + worker->chunk_frames < frame_count) ? start + worker->chunk_frames : frame_count;
+		batch_convert_chunk(worker, start, end);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Convert every raw frame of a recording on several threads
+ *
+ * Threads take chunks of chunk_frames frames from a shared counter until all frames are converted.
+ *
+ * @param batch indexed recording
+ * @param options threads, chunk size, calibration settings and frame callback
+ * @return number of frames converted
+ * @return -1 out of memory or thread creation failed
+ */
+int mlx_batch_run(const MlxBatch_type *batch, const MlxBatchOptions_type *options)
+{
+	pthread_t threads[MLX_BATCH_MAX_THREADS];
+	atomic_uint next_chunk = 0;
+	int thread_count = (options->threads > 0) ? options->threads : sysconf(_SC_NPROCESSORS_ONLN);
+	thread_count = (thread_count < MLX_BATCH_MAX_THREADS) ? thread_count : MLX_BATCH_MAX_THREADS;
+
+	MlxCalibration_type *calibrations = malloc((batch->calibration_count + 1) * sizeof(MlxCalibration_type));
+	MlxBatchWorker_type *workers = aligned_alloc(64, thread_count * sizeof(MlxBatchWorker_type));
+	if (calibrations == NULL || workers == NULL)
+	{
+		free(calibrations);
+		free(workers);
+		return -1;
+	}
+	for (uint32_t c = 0; c < batch->calibration_count; c++)
+	{
+		calibrations[c] = batch->calibrations[c];
+		calibrations[c].emissivity = options->emissivity;
+		calibrations[c].ambient_offset = options->ambient_offset;
+	}
+
+	int started = 0;
+	for (; started < thread_count; started++)
+	{
+		MlxBatchWorker_type *worker = &workers[started];
+		worker->batch = batch;
+		worker->options = options;
+		worker->calibrations = calibrations;
+		worker->next_chunk = &next_chunk;
+		worker->chunk_frames = (options->chunk_frames > 0) ? options->chunk_frames : MLX_BATCH_CHUNK_FRAMES;
+		worker->converted = 0;
+		if (pthread_create(&threads[started], NULL, batch_worker, worker) != 0)
+		{
+			break;
+		}
+	}
+	int converted = 0;
+	for (int t = 0; t < started; t++)
+	{
+		pthread_join(threads[t], NULL);
+		converted += workers[t].converted;
+	}
+	free(calibrations);
+	free(workers);
+	return (started > 0) ? converted : -1;
+}
@@ -0,0 +1,71 @@
+#ifndef MLX_BATCH_H
+#define MLX_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mlx_protocol.h"
+#include "mlx_calibration.h"
+
+#define MLX_BATCH_MAX_THREADS 64
+#define MLX_BATCH_CHUNK_FRAMES 256 /*!< Default frames a thread takes at a time*/
+#define MLX_BATCH_WARMUP_FRAMES 2  /*!< Subpages converted ahead of a chunk to rebuild the held frame*/
+
+/**
+ * @brief Raw frame of a recording
+ */
+typedef struct MlxBatchFrame_type
+{
+	uint64_t offset;	  // packet offset in the recording
+	uint32_t calibration; // index of the EEPROM packet that precedes the frame
+} MlxBatchFrame_type;
+
+/**
+ * @brief Recorded packet stream, mapped read only and indexed
+ *
+ * A recording is a dump of what a device sent, e.g. the bytes read from its serial port. Every EEPROM
+ * packet starts a new calibration segment, raw frames before the first EEPROM cannot be converted and
+ * are not indexed.
+ */
+typedef struct MlxBatch_type
+{
+	const uint8_t *data;
+	size_t size;
+	MlxBatchFrame_type *frames;
+	uint32_t frame_count;
+	MlxCalibration_type *calibrations;
+	uint32_t *segment_start; // first frame of every calibration
+	uint32_t calibration_count;
+	uint32_t packets;
+	uint32_t crc_errors;
+	uint32_t skipped_bytes;
+} MlxBatch_type;
+
+/**
+ * @brief Called for every converted frame, concurrently from all threads and in no particular order
+ *
+ * @param context MlxBatchOptions_type context
+ * @param index frame index in the recording
+ * @param header packet header of the raw frame
+ * @param temps full frame, the pixels of the other subpage are held from the previous frame
+ * @param ta sensor ambient temperature
+ */
+typedef void (*MlxBatchCallback_type)(void *context, uint32_t index, const MlxPacketHeader_type *header, const float *temps, float ta);
+
+/**
+ * @brief Settings of one batch run, applied to every calibration of the recording
+ */
+typedef struct MlxBatchOptions_type
+{
+	int threads;		 // 0 for one per core
+	uint32_t chunk_frames; // 0 for MLX_BATCH_CHUNK_FRAMES
+	float emissivity;
+	float ambient_offset;
+	MlxBatchCallback_type callback; // may be NULL
+	void *context;
+} MlxBatchOptions_type;
+
+int mlx_batch_open(MlxBatch_type *batch, const char *path);
+void mlx_batch_close(MlxBatch_type *batch);
+int mlx_batch_run(const MlxBatch_type *batch, const MlxBatchOptions_type *options);
+
+#endif // MLX_BATCH_H
@@ -0,0 +1,186 @@
+#include "mlx_calibration.h"
+#include "constants.h"
+
+#include <math.h>
+#include <string.h>
+
+#define KELVIN 273.15f
+
+/**
+ * @brief Collect the constants of the pixels one subpage measures
+ *
+ * Pattern and correction terms follow MLX90640_CalculateTo.
+ */
+static void calibration_pattern_init(MlxCalibration_type *calibration, uint8_t chess, uint8_t subpage)
+{
+	const paramsMLX90640 *params = &calibration->params;
+	MlxCalibrationPattern_type *pattern = &calibration->patterns[chess][subpage];
+	float kta_scale = POW2(params->ktaScale);
+	float kv_scale = POW2(params->kvScale);
+	float alpha_scale = POW2(params->alphaScale);
+	int count = 0;
+
+	for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+	{
+		int il_pattern = pixel / 32 - (pixel / 64) * 2;
+		int chess_pattern = il_pattern ^ (pixel - (pixel / 2) * 2);
+		int conversion_pattern = ((pixel + 2) / 4 - (pixel + 3) / 4 + (pixel + 1) / 4 - pixel / 4) * (1 - 2 * il_pattern);
+		if ((chess ? chess_pattern : il_pattern) != subpage)
+		{
+			continue;
+		}
+		pattern->pixel[count] = pixel;
+		pattern->offset[count] = params->offset[pixel];
+		pattern->kta[count] = params->kta[pixel] / kta_scale;
+		pattern->kv[count] = params->kv[pixel] / kv_scale;
+		pattern->alpha[count] = SCALEALPHA * alpha_scale / params->alpha[pixel];
+		pattern->il_offset[count] = params->ilChessC[2] * (2 * il_pattern - 1) - params->ilChessC[1] * conversion_pattern;
+		count++;
+	}
+}
+
+/**
+ * @brief Compile the calibration of a sensor from its EEPROM
+ *
+ * Emissivity and ambient offset start at the firmware defaults.
+ *
+ * @param calibration output
+ * @param eeprom MLX90640_EEPROM_DUMP_NUM words, as sent in MLX_PACKET_EEPROM
+ * @return 0 OK
+ * @return -1 invalid EEPROM, MLX90640_ExtractParameters failed
+ */
+int mlx_calibration_init(MlxCalibration_type *calibration, const uint16_t *eeprom)
+{
+	uint16_t eeprom_copy[MLX90640_EEPROM_DUMP_NUM];
+
+	memset(calibration, 0, sizeof(MlxCalibration_type));
+	memcpy(eeprom_copy, eeprom, sizeof(eeprom_copy));
+	if (MLX90640_ExtractParameters(eeprom_copy, &calibration->params) != MLX90640_NO_ERROR)
+	{
+		return -1;
+	}
+	for (uint8_t chess = 0; chess < 2; chess++)
+	{
+		calibration_pattern_init(calibration, chess, 0);
+		calibration_pattern_init(calibration, chess, 1);
+	}
+
+	const paramsMLX90640 *params = &calibration->params;
+	calibration->alpha_corr_r[0] = 1 / (1 + params->ksTo[0] * 40);
+	calibration->alpha_corr_r[1] = 1;
+	calibration->alpha_corr_r[2] = (1 + params->ksTo[1] * params->ct[2]);
+	calibration->alpha_corr_r[3] = calibration->alpha_corr_r[2] * (1 + params->ksTo[2] * (params->ct[3] - params->ct[2]));
+	for (int range = 0; range < 4; range++)
+	{
+		calibration->ks_to[range] = params->ksTo[range];
+		calibration->ct[range] = params->ct[range];
+	}
+	calibration->emissivity = MLX_EMISSIVITY;
+	calibration->ambient_offset = MLX_TA_OFFSET;
+	return 0;
+}
+
+/**
+ * @brief Calculate the temperatures of a raw subpage
+ *
+ * Same math as MLX90640_GetTa, MLX90640_CalculateTo and MLX90640_BadPixelsCorrection, in single
+ * precision and with the per pixel constants prepared by mlx_calibration_init. Only the pixels of the
+ * subpage are written, so temps holds the latest value of every pixel when all subpages of a stream
+ * are converted into it.
+ *
+ * @param calibration compiled calibration
+ * @param raw MLX_PACKET_RAW_WORDS words of one subpage
+ * @param temps frame, 768 temperatures in °C
+ * @param ta output, sensor ambient temperature without ambient_offset, may be NULL
+ * @return subpage number 0 or 1
+ * @return -1 invalid subpage data
+ */
+int mlx_calibration_convert(const MlxCalibration_type *calibration, const uint16_t *raw, float *temps, float *ta)
+{
+	const paramsMLX90640 *params = &calibration->params;
+	uint16_t subpage = raw[833];
+	if (subpage > 1 || (int16_t)raw[778] == 0)
+	{
+		return -1;
+	}
+
+	// The API takes mutable pointers but only reads them
+	float vdd = MLX90640_GetVdd((uint16_t *)raw, params);
+	float ambient = MLX90640_GetTa((uint16_t *)raw, params);
+	if (ta != NULL)
+	{
+		*ta = ambient;
+	}
+	float tr = ambient + calibration->ambient_offset;
+	float ta4 = (ambient + KELVIN) * (ambient + KELVIN);
+	ta4 = ta4 * ta4;
+	float tr4 = (tr + KELVIN) * (tr + KELVIN);
+	tr4 = tr4 * tr4;
+	float emissivity = calibration->emissivity;
+	float ta_tr = tr4 - (tr4 - ta4) / emissivity;
+
+	float gain = (float)params->gainEE / (int16_t)raw[778];
+	uint8_t mode = (raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> 5;
+	float delta_ta = ambient - 25;
+	float delta_vdd = vdd - 3.3f;
+	float cp_factor = (1 + params->cpKta * delta_ta) * (1 + params->cpKv * delta_vdd);
+	float ir_cp = (int16_t)raw[776 + 32 * subpage] * gain;
+	if (subpage == 0 || mode == params->calibrationModeEE)
+	{
+		ir_cp -= params->cpOffset[subpage] * cp_factor;
+	}
+	else
+	{
+		ir_cp -= (params->cpOffset[1] + params->ilChessC[0]) * cp_factor;
+	}
+	float tgc_cp = params->tgc * ir_cp;
+	float il_weight = (mode != params->calibrationModeEE) ? 1.0f : 0.0f;
+	float alpha_ta = 1 + params->KsTa * delta_ta;
+	float ks_to_kelvin = 1 - calibration->ks_to[1] * KELVIN;
+
+	const MlxCalibrationPattern_type *pattern = &calibration->patterns[mode != 0][subpage];
+	float ir[MLX_CALIBRATION_PIXELS];
+	float to[MLX_CALIBRATION_PIXELS];
+	for (int i = 0; i < MLX_CALIBRATION_PIXELS; i++)
+	{
+		ir[i] = (int16_t)raw[pattern->pixel[i]];
+	}
+
+	// Branch free, so the compiler vectorizes it
+	for (int i = 0; i < MLX_CALIBRATION_PIXELS; i++)
+	{
+		float ir_data = ir[i] * gain - pattern->offset[i] * (1 + pattern->kta[i] * delta_ta) * (1 + pattern->kv[i] * delta_vdd);
+		ir_data = (ir_data + il_weight * pattern->il_offset[i] - tgc_cp) / emissivity;
+
+		float alpha = pattern->alpha[i] * alpha_ta;
+		float sx = sqrtf(sqrtf(alpha * alpha * alpha * (ir_data + alpha * ta_tr))) * calibration->ks_to[1];
+		float to_estimate = sqrtf(sqrtf(ir_data / (alpha * ks_to_kelvin + sx) + ta_tr)) - KELVIN;
+
+		float corr_r = calibration->alpha_corr_r[0];
+		float ks_to = calibration->ks_to[0];
+		float ct = calibration->ct[0];
+		corr_r = (to_estimate >= calibration->ct[1]) ? calibration->alpha_corr_r[1] : corr_r;
+		ks_to = (to_estimate >= calibration->ct[1]) ? calibration->ks_to[1] : ks_to;
+		ct = (to_estimate >= calibration->ct[1]) ? calibration->ct[1] : ct;
+		corr_r = (to_estimate >= calibration->ct[2]) ? calibration->alpha_corr_r[2] : corr_r;
+		ks_to = (to_estimate >= calibration->ct[2]) ? calibration->ks_to[2] : ks_to;
+		ct = (to_estimate >= calibration->ct[2]) ? calibration->ct[2] : ct;
+		corr_r = (to_estimate >= calibration->ct[3]) ? calibration->alpha_corr_r[3] : corr_r;
+		ks_to = (to_estimate >= calibration->ct[3]) ? calibration->ks_to[3] : ks_to;
+		ct = (to_estimate >= calibration->ct[3]) ? calibration->ct[3] : ct;
+
+		to[i] = sqrtf(sqrtf(ir_data / (alpha * corr_r * (1 + ks_to * (to_estimate - ct))) + ta_tr)) - KELVIN;
+	}
+
+	for (int i = 0; i < MLX_CALIBRATION_PIXELS; i++)
+	{
+		temps[pattern->pixel[i]] = to[i];
+	}
+
+	// Same correction as the firmware, mode bit 0 is chess
+	paramsMLX90640 *mutable_params = (paramsMLX90640 *)params;
+	int correction_mode = (raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
+	MLX90640_BadPixelsCorrection(mutable_params->brokenPixels, temps, correction_mode, mutable_params);
+	MLX90640_BadPixelsCorrection(mutable_params->outlierPixels, temps, correction_mode, mutable_params);
+	return subpage;
+}
@@ -0,0 +1,44 @@
+#ifndef MLX_CALIBRATION_H
+#define MLX_CALIBRATION_H
+
+#include <stdint.h>
+#include "mlx90640_api.h"
+
+#define MLX_CALIBRATION_PIXELS 384 /*!< Pixels of one subpage*/
+
+/**
+ * @brief Per pixel constants of the pixels one subpage measures
+ *
+ * Arrays are indexed in subpage order, pixel holds the frame index of each entry.
+ */
+typedef struct MlxCalibrationPattern_type
+{
+	uint16_t pixel[MLX_CALIBRATION_PIXELS];
+	float offset[MLX_CALIBRATION_PIXELS];
+	float kta[MLX_CALIBRATION_PIXELS];		  // kta / 2^ktaScale
+	float kv[MLX_CALIBRATION_PIXELS];		  // kv / 2^kvScale
+	float alpha[MLX_CALIBRATION_PIXELS];	  // SCALEALPHA * 2^alphaScale / alpha
+	float il_offset[MLX_CALIBRATION_PIXELS]; // added when measured in the other pattern than calibrated
+} MlxCalibrationPattern_type;
+
+/**
+ * @brief Calibration compiled from the sensor EEPROM
+ *
+ * Everything MLX90640_CalculateTo derives from the parameters on every call is computed once,
+ * converting a raw subpage only loops over the 384 pixels it measured.
+ */
+typedef struct MlxCalibration_type
+{
+	paramsMLX90640 params;
+	MlxCalibrationPattern_type patterns[2][2]; // [chess][subpage]
+	float alpha_corr_r[4];
+	float ks_to[4];
+	float ct[4];
+	float emissivity;
+	float ambient_offset; // tr = Ta + ambient_offset, as MLX SET TAOFF
+} MlxCalibration_type;
+
+int mlx_calibration_init(MlxCalibration_type *calibration, const uint16_t *eeprom);
+int mlx_calibration_convert(const MlxCalibration_type *calibration, const uint16_t *raw, float *temps, float *ta);
+
+#endif // MLX_CALIBRATION_H
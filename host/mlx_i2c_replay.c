@@ -0,0 +1,167 @@
+#include "mlx_i2c_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mlx90640_api.h"
+
+MlxI2cReplay_type *mlx_i2c_replay_active = NULL;
+
+static int64_t monotonic_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief Read a trace file
+ *
+ * @param replay output
+ * @param path trace, the MLX_PACKET_I2C_TRACE payloads of a stream in order
+ * @param speed MLX_I2C_REPLAY_FAST or MLX_I2C_REPLAY_REALTIME
+ * @return 0 OK
+ * @return -1 cannot read the file
+ * @return -2 out of memory
+ */
+int mlx_i2c_replay_load(MlxI2cReplay_type *replay, const char *path, int speed)
+{
+	memset(replay, 0, sizeof(MlxI2cReplay_type));
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	if (fseek(file, 0, SEEK_END) != 0 || ftell(file) < 0)
+	{
+		fclose(file);
+		return -1;
+	}
+	replay->size = ftell(file);
+	rewind(file);
+	replay->data = malloc(replay->size + 1);
+	if (replay->data == NULL)
+	{
+		fclose(file);
+		return -2;
+	}
+	if (fread(replay->data, 1, replay->size, file) != replay->size)
+	{
+		fclose(file);
+		mlx_i2c_replay_free(replay);
+		return -1;
+	}
+	fclose(file);
+	replay->speed = speed;
+	return 0;
+}
+
+void mlx_i2c_replay_free(MlxI2cReplay_type *replay)
+{
+	if (mlx_i2c_replay_active == replay)
+	{
+		mlx_i2c_replay_active = NULL;
+	}
+	free(replay->data);
+	memset(replay, 0, sizeof(MlxI2cReplay_type));
+}
+
+/**
+ * @brief Start the replay over from the first entry, the clock restarts at trace time 0
+ */
+void mlx_i2c_replay_rewind(MlxI2cReplay_type *replay)
+{
+	replay->offset = 0;
+	replay->time_us = 0;
+	replay->last_time_us = 0;
+	replay->transactions = 0;
+	replay->skipped = 0;
+	replay->gaps = 0;
+	replay->max_late_us = 0;
+	// A fast replay runs on trace time alone, so every run sees the same clock
+	replay->start_us = (replay->speed == MLX_I2C_REPLAY_REALTIME) ? monotonic_us() : 0;
+}
+
+/**
+ * @brief Make a replay the I2C bus of mlx90640_i2c_driver.h and rewind it
+ *
+ * @param replay replay, NULL detaches the bus
+ */
+void mlx_i2c_replay_attach(MlxI2cReplay_type *replay)
+{
+	mlx_i2c_replay_active = replay;
+	if (replay != NULL)
+	{
+		mlx_i2c_replay_rewind(replay);
+	}
+}
+
+/**
+ * @brief Replay the next transaction matching a driver call
+ *
+ * @param replay attached replay
+ * @param op MLX_I2C_TRACE_READ, MLX_I2C_TRACE_WRITE or MLX_I2C_TRACE_RESET
+ * @param address register address
+ * @param count words to read, 1 for writes
+ * @param words output of reads, count words
+ * @return recorded result of the transaction
+ * @return -MLX90640_I2C_NACK_ERROR end of the trace
+ */
+int mlx_i2c_replay_transaction(MlxI2cReplay_type *replay, uint8_t op, uint16_t address, uint16_t count, uint16_t *words)
+{
+	MlxI2cTraceEntry_type entry;
+	const uint8_t *entry_words;
+
+	while (mlx_i2c_trace_next(replay->data, replay->size, &replay->offset, &entry, &entry_words) == 1)
+	{
+		// Unwrap the 32 bit trace time, entries never go back in time by more than a few us
+		uint32_t delta = entry.time_us - replay->last_time_us;
+		if (delta < UINT32_MAX / 2)
+		{
+			replay->time_us += delta;
+			replay->last_time_us = entry.time_us;
+		}
+		if (entry.op == MLX_I2C_TRACE_GAP)
+		{
+			replay->gaps += entry.count;
+			continue;
+		}
+		if (entry.op != op || entry.address != address || entry.count != count)
+		{
+			replay->skipped++;
+			continue;
+		}
+
+		if (op == MLX_I2C_TRACE_READ)
+		{
+			memcpy(words, entry_words, count * sizeof(uint16_t));
+		}
+		if (replay->speed == MLX_I2C_REPLAY_REALTIME)
+		{
+			int64_t due_us = replay->start_us + replay->time_us;
+			int64_t late_us = monotonic_us() - due_us;
+			if (late_us < 0)
+			{
+				struct timespec due = {.tv_sec = due_us / 1000000, .tv_nsec = (due_us % 1000000) * 1000};
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+			}
+			else if (late_us > replay->max_late_us)
+			{
+				replay->max_late_us = late_us;
+			}
+		}
+		replay->transactions++;
+		return entry.result;
+	}
+	replay->offset = replay->size;
+	return -MLX90640_I2C_NACK_ERROR;
+}
+
+/**
+ * @brief Clock of a replay in us, trace time in MLX_I2C_REPLAY_FAST
+ */
+int64_t mlx_i2c_replay_now(const MlxI2cReplay_type *replay)
+{
+	return (replay->speed == MLX_I2C_REPLAY_REALTIME) ? monotonic_us() : replay->time_us;
+}
@@ -0,0 +1,48 @@
+#ifndef MLX_I2C_REPLAY_H
+#define MLX_I2C_REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mlx_i2c_trace.h"
+
+/**
+ * I2C replay backend
+ *
+ * Feeds a trace recorded with MLX TRACE ON (mlx_i2c_trace.h) to the driver functions of
+ * mlx90640_i2c_driver.h, so MLX90640_DumpEE, MLX90640_GetFrameData and the rest of mlx90640_api.c run on
+ * the host against the recorded sensor. Every call takes the next trace entry with the same operation,
+ * address and word count and returns its words and result; entries the caller does not ask for are skipped
+ * and counted. After the last entry the driver functions fail with -MLX90640_I2C_NACK_ERROR.
+ *
+ * MLX_I2C_REPLAY_REALTIME returns every transaction at its recorded time. MLX_I2C_REPLAY_FAST returns
+ * at once and esp_timer_get_time follows the trace instead of the host clock, so the timeouts of
+ * mlx90640_api.c see the recorded timing and every run takes the same path.
+ */
+#define MLX_I2C_REPLAY_FAST 0
+#define MLX_I2C_REPLAY_REALTIME 1
+
+typedef struct MlxI2cReplay_type
+{
+	uint8_t *data;
+	size_t size;
+	size_t offset; // next entry
+	int speed;
+	int64_t start_us; // host time of trace time 0
+	int64_t time_us;  // unwrapped trace time of the last returned entry
+	uint32_t last_time_us;
+	uint64_t transactions;
+	uint64_t skipped;	 // entries the caller did not ask for
+	uint64_t gaps;		 // entries dropped by the recorder
+	int64_t max_late_us; // realtime: latest return after the recorded time
+} MlxI2cReplay_type;
+
+extern MlxI2cReplay_type *mlx_i2c_replay_active; // bus of the driver functions, NULL: no sensor
+
+int mlx_i2c_replay_load(MlxI2cReplay_type *replay, const char *path, int speed);
+void mlx_i2c_replay_free(MlxI2cReplay_type *replay);
+void mlx_i2c_replay_rewind(MlxI2cReplay_type *replay);
+void mlx_i2c_replay_attach(MlxI2cReplay_type *replay);
+int mlx_i2c_replay_transaction(MlxI2cReplay_type *replay, uint8_t op, uint16_t address, uint16_t count, uint16_t *words);
+int64_t mlx_i2c_replay_now(const MlxI2cReplay_type *replay);
+
+#endif // MLX_I2C_REPLAY_H
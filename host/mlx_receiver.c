@@ -0,0 +1,385 @@
+#define _GNU_SOURCE
+#include "mlx_receiver.h"
+#include "pixel_encoding.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Map a ring of size bytes twice back to back
+ *
+ * @return ring start, NULL on errors
+ */
+static uint8_t *ring_map(size_t size)
+{
+	int fd = memfd_create("mlx_receiver", MFD_CLOEXEC);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+	if (ftruncate(fd, size) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	uint8_t *ring = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED)
+	{
+		close(fd);
+		return NULL;
+	}
+	if (mmap(ring, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+		mmap(ring + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+	{
+		munmap(ring, 2 * size);
+		close(fd);
+		return NULL;
+	}
+	// The mappings keep the memory alive
+	close(fd);
+	return ring;
+}
+
+/**
+ * @brief Initialize a receiver
+ *
+ * @param receiver receiver
+ * @param transport host transport to read from
+ * @param ring_size ring size, rounded up to whole pages, 0 for MLX_RECEIVER_RING_SIZE
+ * @return 0 OK
+ * @return -1 ring mapping failed
+ */
+int mlx_receiver_init(MlxReceiver_type *receiver, const Transport_type *transport, size_t ring_size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	memset(receiver, 0, sizeof(MlxReceiver_type));
+	ring_size = (ring_size == 0) ? MLX_RECEIVER_RING_SIZE : ring_size;
+	receiver->size = (ring_size + page_size - 1) / page_size * page_size;
+	receiver->transport = transport;
+	receiver->ring = ring_map(receiver->size);
+	frame_codec_init(&receiver->codec, FRAME_CODEC_STEP, FRAME_CODEC_KEY_INTERVAL);
+	return (receiver->ring != NULL) ? 0 : -1;
+}
+
+void mlx_receiver_free(MlxReceiver_type *receiver)
+{
+	if (receiver->ring != NULL)
+	{
+		munmap(receiver->ring, 2 * receiver->size);
+		receiver->ring = NULL;
+	}
+	free(receiver->calibration);
+	receiver->calibration = NULL;
+}
+
+/**
+ * @brief Read from the transport into the free part of the ring
+ *
+ * @param receiver receiver
+ * @param timeout_ms max wait for data
+ * @return number of bytes read, 0 on timeout
+ * @return -1 transport closed or failed
+ * @return MLX_RECEIVER_ERROR_FULL ring full of unreleased views, or too full for a whole datagram
+ * @return MLX_RECEIVER_ERROR_OVERFLOW received bytes were lost, e.g. a truncated datagram
+ */
+int mlx_receiver_fill(MlxReceiver_type *receiver, uint32_t timeout_ms)
+{
+	size_t free_size = receiver->size - (receiver->head - receiver->tail);
+	if (free_size == 0)
+	{
+		return MLX_RECEIVER_ERROR_FULL;
+	}
+	int rx_size = transport_read(receiver->transport, receiver->ring + receiver->head % receiver->size, free_size, timeout_ms);
+	if (rx_size == TRANSPORT_ERROR_NO_SPACE)
+	{
+		return MLX_RECEIVER_ERROR_FULL;
+	}
+	if (rx_size == TRANSPORT_ERROR_OVERFLOW)
+	{
+		return MLX_RECEIVER_ERROR_OVERFLOW;
+	}
+	if (rx_size < 0)
+	{
+		return -1;
+	}
+	receiver->head += rx_size;
+	receiver->bytes += rx_size;
+	return rx_size;
+}
+
+/**
+ * @brief Take the next valid packet from the ring
+ *
+ * @param receiver receiver
+ * @param view packet view, release it with mlx_receiver_release
+ * @return 1 packet
+ * @return 0 no complete packet, fill first
+ */
+int mlx_receiver_next(MlxReceiver_type *receiver, MlxFrameView_type *view)
+{
+	while (receiver->head - receiver->parsed >= sizeof(MlxPacketHeader_type))
+	{
+		const uint8_t *data = receiver->ring + receiver->parsed % receiver->size;
+		size_t available = receiver->head - receiver->parsed;
+
+		if (data[0] != MLX_PACKET_MAGIC_0)
+		{
+			const uint8_t *magic = memchr(data, MLX_PACKET_MAGIC_0, available);
+			size_t skip = (magic != NULL) ? (size_t)(magic - data) : available;
+			receiver->parsed += skip;
+			receiver->skipped_bytes += skip;
+			continue;
+		}
+		memcpy(&view->header, data, sizeof(MlxPacketHeader_type));
+		if (mlx_packet_header_validate(&view->header) != 0)
+		{
+			receiver->parsed++;
+			receiver->skipped_bytes++;
+			continue;
+		}
+		size_t packet_size = sizeof(MlxPacketHeader_type) + view->header.payload_length + MLX_PACKET_CRC_SIZE;
+		if (available < packet_size)
+		{
+			break;
+		}
+		view->payload = data + sizeof(MlxPacketHeader_type);
+		uint32_t crc;
+		memcpy(&crc, view->payload + view->header.payload_length, sizeof(crc));
+		if (crc != mlx_packet_crc(&view->header, view->payload))
+		{
+			// The header may be corrupt too, resync from the next byte
+			receiver->crc_errors++;
+			receiver->parsed++;
+			continue;
+		}
+		receiver->parsed += packet_size;
+		receiver->packets++;
+		receiver->views++;
+		view->end = receiver->parsed;
+		return 1;
+	}
+	// Skipped bytes are free as soon as no view holds the ring before them
+	if (receiver->views == 0)
+	{
+		receiver->tail = receiver->parsed;
+	}
+	return 0;
+}
+
+/**
+ * @brief Give the ring space of a view back to the transport
+ *
+ * @param receiver receiver
+ * @param view oldest view not released yet
+ */
+void mlx_receiver_release(MlxReceiver_type *receiver, const MlxFrameView_type *view)
+{
+	receiver->tail = view->end;
+	receiver->views--;
+	if (receiver->views == 0)
+	{
+		receiver->tail = receiver->parsed;
+	}
+}
+
+/**
+ * @brief Compile the calibration of an MLX_PACKET_EEPROM view, used by the following raw frames
+ *
+ * @param receiver receiver
+ * @param view EEPROM packet
+ * @return 0 OK
+ * @return -1 not an EEPROM packet
+ * @return -2 out of memory
+ * @return -3 invalid EEPROM
+ */
+int mlx_receiver_calibrate(MlxReceiver_type *receiver, const MlxFrameView_type *view)
+{
+	uint16_t eeprom[MLX_PACKET_EEPROM_WORDS];
+
+	if (view->header.type != MLX_PACKET_EEPROM || view->header.payload_length != sizeof(eeprom))
+	{
+		return -1;
+	}
+	if (receiver->calibration == NULL && (receiver->calibration = malloc(sizeof(MlxCalibration_type))) == NULL)
+	{
+		return -2;
+	}
+	// The payload has no alignment guarantee in the ring
+	memcpy(eeprom, view->payload, sizeof(eeprom));
+	if (mlx_calibration_init(receiver->calibration, eeprom) != 0)
+	{
+		free(receiver->calibration);
+		receiver->calibration = NULL;
+		return -3;
+	}
+	memset(receiver->raw_frame, 0, sizeof(receiver->raw_frame));
+	return 0;
+}
+
+/**
+ * @brief Decode the temperatures of a frame view
+ *
+ * MLX_PIXEL_DELTA frames depend on the previous key frame and MLX_PIXEL_RAW subpages on the EEPROM
+ * and the other subpage, convert them in stream order. A raw subpage yields the full frame with the
+ * pixels of the other subpage held from its last conversion.
+ *
+ * @param receiver receiver
+ * @param view frame packet
+ * @param temps output, 768 temperatures in °C
+ * @return 0 OK
+ * @return -1 not a frame or unknown pixel format
+ * @return -2 delta frame without its key frame
+ * @return -3 raw frame without calibration
+ */
+int mlx_receiver_convert(MlxReceiver_type *receiver, const MlxFrameView_type *view, float *temps)
+{
+	if (view->header.type != MLX_PACKET_FRAME)
+	{
+		return -1;
+	}
+	if (view->header.pixel_format == MLX_PIXEL_DELTA)
+	{
+		receiver->codec.step = view->header.scale;
+		return (frame_codec_decode(&receiver->codec, view->payload, view->header.payload_length, temps) == 0) ? 0 : -2;
+	}
+	if (view->header.pixel_format == MLX_PIXEL_RAW)
+	{
+		uint16_t raw[MLX_PACKET_RAW_WORDS];
+		if (view->header.payload_length != sizeof(raw))
+		{
+			return -1;
+		}
+		if (receiver->calibration == NULL)
+		{
+			return -3;
+		}
+		memcpy(raw, view->payload, sizeof(raw));
+		if (mlx_calibration_convert(receiver->calibration, raw, receiver->raw_frame, &receiver->raw_ta) < 0)
+		{
+			return -1;
+		}
+		memcpy(temps, receiver->raw_frame, sizeof(receiver->raw_frame));
+		return 0;
+	}
+	size_t pixel_size = pixel_format_size(view->header.pixel_format);
+	if (pixel_size == 0 || view->header.payload_length != FRAME_CODEC_PIXELS * pixel_size)
+	{
+		return -1;
+	}
+	return mlx_pixels_to_float(view->payload, FRAME_CODEC_PIXELS, view->header.pixel_format, view->header.offset, view->header.scale, temps);
+}
+
+#ifdef __SSE2__
+/**
+ * @brief 4 half precision values in the low 16 bits of each lane to single precision
+ *
+ * Same results as pixel_half_to_float, including subnormals, Inf and NaN.
+ */
+static inline __m128 half_to_float_sse2(__m128i half)
+{
+	const __m128i exponent_mask = _mm_set1_epi32(0x7C00 << 13);
+	const __m128i exponent_adjust = _mm_set1_epi32((127 - 15) << 23);
+	const __m128i infnan_adjust = _mm_set1_epi32((128 - 16) << 23);
+	const __m128i subnormal_adjust = _mm_set1_epi32(1 << 23);
+	const __m128 subnormal_magic = _mm_castsi128_ps(_mm_set1_epi32(113 << 23));
+
+	__m128i exponent_mantissa = _mm_and_si128(half, _mm_set1_epi32(0x7FFF));
+	__m128i sign = _mm_slli_epi32(_mm_xor_si128(half, exponent_mantissa), 16);
+	__m128i shifted = _mm_slli_epi32(exponent_mantissa, 13);
+	__m128i exponent = _mm_and_si128(shifted, exponent_mask);
+	__m128i bits = _mm_add_epi32(shifted, exponent_adjust);
+
+	__m128i infnan = _mm_cmpeq_epi32(exponent, exponent_mask);
+	bits = _mm_add_epi32(bits, _mm_and_si128(infnan, infnan_adjust));
+
+	// Subnormal and zero: let the FPU normalize (mantissa * 2^-14 + 2^-14) - 2^-14
+	__m128i subnormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+	__m128 normalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, subnormal_adjust)), subnormal_magic);
+	bits = _mm_or_si128(_mm_andnot_si128(subnormal, bits), _mm_and_si128(subnormal, _mm_castps_si128(normalized)));
+
+	return _mm_castsi128_ps(_mm_or_si128(bits, sign));
+}
+
+static inline void store_scaled_sse2(float *temps, __m128i values, __m128 offset, __m128 scale)
+{
+	_mm_storeu_ps(temps, _mm_add_ps(offset, _mm_mul_ps(_mm_cvtepi32_ps(values), scale)));
+}
+#endif
+
+/**
+ * @brief Decode encoded pixels, SSE2 when available
+ *
+ * Results are bit identical to pixel_decode.
+ *
+ * @param encoded encoded pixels, any alignment
+ * @param count number of pixels
+ * @param pixel_format MLX_PIXEL_FLOAT32, MLX_PIXEL_FLOAT16, MLX_PIXEL_INT16 or MLX_PIXEL_UINT8
+ * @param offset decoding offset from the packet header
+ * @param scale decoding scale from the packet header
+ * @param temps output temperatures in °C
+ * @return 0 OK
+ * @return -1 unknown pixel format
+ */
+int mlx_pixels_to_float(const void *encoded, size_t count, uint8_t pixel_format, float offset, float scale, float *temps)
+{
+	size_t i = 0;
+	const uint8_t *in = (const uint8_t *)encoded;
+
+#ifdef __SSE2__
+	const __m128 offset_4 = _mm_set1_ps(offset);
+	const __m128 scale_4 = _mm_set1_ps(scale);
+	const __m128i zero = _mm_setzero_si128();
+
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_FLOAT16:
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i half = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+			_mm_storeu_ps(temps + i, half_to_float_sse2(_mm_unpacklo_epi16(half, zero)));
+			_mm_storeu_ps(temps + i + 4, half_to_float_sse2(_mm_unpackhi_epi16(half, zero)));
+		}
+		break;
+
+	case MLX_PIXEL_INT16:
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+			// Sign extend by arithmetic shift of the value in the high half
+			store_scaled_sse2(temps + i, _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16), offset_4, scale_4);
+			store_scaled_sse2(temps + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16), offset_4, scale_4);
+		}
+		break;
+
+	case MLX_PIXEL_UINT8:
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i values = _mm_loadu_si128((const __m128i *)(in + i));
+			__m128i low = _mm_unpacklo_epi8(values, zero);
+			__m128i high = _mm_unpackhi_epi8(values, zero);
+			store_scaled_sse2(temps + i, _mm_unpacklo_epi16(low, zero), offset_4, scale_4);
+			store_scaled_sse2(temps + i + 4, _mm_unpackhi_epi16(low, zero), offset_4, scale_4);
+			store_scaled_sse2(temps + i + 8, _mm_unpacklo_epi16(high, zero), offset_4, scale_4);
+			store_scaled_sse2(temps + i + 12, _mm_unpackhi_epi16(high, zero), offset_4, scale_4);
+		}
+		break;
+
+	default:
+		break;
+	}
+#endif
+
+	// Remaining pixels, and every pixel without SSE2
+	size_t pixel_size = pixel_format_size(pixel_format);
+	if (pixel_size == 0)
+	{
+		return -1;
+	}
+	return pixel_decode(in + i * pixel_size, count - i, pixel_format, offset, scale, temps + i);
+}
@@ -0,0 +1,63 @@
+#ifndef MLX_RECEIVER_H
+#define MLX_RECEIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "transport.h"
+#include "mlx_protocol.h"
+#include "frame_codec.h"
+#include "mlx_calibration.h"
+
+#define MLX_RECEIVER_RING_SIZE (256 * 1024)
+#define MLX_RECEIVER_ERROR_FULL -2 /*!< No free ring space, release views first*/
+#define MLX_RECEIVER_ERROR_OVERFLOW -3 /*!< Received bytes were lost, the stream resyncs on the next packet*/
+
+/**
+ * @brief One packet in the receive ring
+ *
+ * payload points into the ring and stays valid until the view is released.
+ */
+typedef struct MlxFrameView_type
+{
+	MlxPacketHeader_type header;
+	const uint8_t *payload;
+	uint64_t end; // ring position after the packet
+} MlxFrameView_type;
+
+/**
+ * @brief Packet receiver on a host transport
+ *
+ * The ring is mapped twice back to back, so every packet is contiguous in memory even when it wraps.
+ * The transport reads straight into the ring and packets are handed out as views, nothing is copied
+ * between the read and the pixel conversion. Views are released in the order they were taken.
+ */
+typedef struct MlxReceiver_type
+{
+	const Transport_type *transport;
+	uint8_t *ring;
+	size_t size;
+	uint64_t head;	  // bytes received
+	uint64_t parsed;  // bytes handed out or skipped
+	uint64_t tail;	  // bytes released
+	uint32_t views;	  // views not released yet
+	uint64_t bytes;
+	uint32_t packets;
+	uint32_t crc_errors;
+	uint32_t skipped_bytes; // bytes dropped while looking for a header
+	FrameCodec_type codec;	// reference frames of MLX_PIXEL_DELTA packets
+	MlxCalibration_type *calibration; // from the last MLX_PACKET_EEPROM, NULL before
+	float raw_frame[MLX90640_PIXEL_NUM]; // MLX_PIXEL_RAW subpages converted so far
+	float raw_ta;						 // ambient temperature of the last MLX_PIXEL_RAW subpage
+} MlxReceiver_type;
+
+int mlx_receiver_init(MlxReceiver_type *receiver, const Transport_type *transport, size_t ring_size);
+void mlx_receiver_free(MlxReceiver_type *receiver);
+int mlx_receiver_fill(MlxReceiver_type *receiver, uint32_t timeout_ms);
+int mlx_receiver_next(MlxReceiver_type *receiver, MlxFrameView_type *view);
+void mlx_receiver_release(MlxReceiver_type *receiver, const MlxFrameView_type *view);
+int mlx_receiver_calibrate(MlxReceiver_type *receiver, const MlxFrameView_type *view);
+int mlx_receiver_convert(MlxReceiver_type *receiver, const MlxFrameView_type *view, float *temps);
+int mlx_pixels_to_float(const void *encoded, size_t count, uint8_t pixel_format, float offset, float scale, float *temps);
+
+#endif // MLX_RECEIVER_H
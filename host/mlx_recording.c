@@ -0,0 +1,312 @@
+#include "mlx_recording.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static size_t recording_payload_size(uint8_t pixel_format)
+{
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_RAW:
+		return MLX_PACKET_RAW_WORDS * sizeof(uint16_t);
+	case MLX_PIXEL_FLOAT32:
+		return MLX90640_PIXEL_NUM * sizeof(float);
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Create a recording
+ *
+ * @param writer output
+ * @param path file to create or truncate
+ * @param pixel_format MLX_PIXEL_RAW or MLX_PIXEL_FLOAT32
+ * @param eeprom MLX90640_EEPROM_DUMP_NUM words, required for raw recordings, may be NULL otherwise
+ * @return 0 OK
+ * @return -1 unsupported pixel format or raw recording without EEPROM
+ * @return -2 invalid EEPROM
+ * @return -3 cannot create the file
+ */
+int mlx_recording_writer_open(MlxRecordingWriter_type *writer, const char *path, uint8_t pixel_format, const uint16_t *eeprom)
+{
+	static const uint8_t zero[MLX_RECORDING_HEADER_SIZE];
+	struct timespec ts;
+
+	memset(writer, 0, sizeof(MlxRecordingWriter_type));
+	size_t payload_size = recording_payload_size(pixel_format);
+	if (payload_size == 0 || (pixel_format == MLX_PIXEL_RAW && eeprom == NULL))
+	{
+		return -1;
+	}
+	if (eeprom != NULL)
+	{
+		uint16_t eeprom_copy[MLX90640_EEPROM_DUMP_NUM];
+		memcpy(eeprom_copy, eeprom, sizeof(eeprom_copy));
+		if (MLX90640_ExtractParameters(eeprom_copy, &writer->params) != MLX90640_NO_ERROR)
+		{
+			return -2;
+		}
+		memcpy(writer->header.eeprom, eeprom, sizeof(writer->header.eeprom));
+		writer->header.has_eeprom = 1;
+	}
+	writer->file = fopen(path, "wb");
+	if (writer->file == NULL)
+	{
+		return -3;
+	}
+	clock_gettime(CLOCK_REALTIME, &ts);
+	writer->header.magic = MLX_RECORDING_MAGIC;
+	writer->header.version = MLX_RECORDING_VERSION;
+	writer->header.header_size = MLX_RECORDING_HEADER_SIZE;
+	writer->header.record_size = (sizeof(MlxRecordingRecord_type) + payload_size + 7) / 8 * 8;
+	writer->header.pixel_format = pixel_format;
+	writer->header.payload_size = payload_size;
+	writer->header.created_us = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	writer->last_time_us = INT64_MIN;
+
+	if (fwrite(&writer->header, sizeof(writer->header), 1, writer->file) != 1 ||
+		fwrite(zero, MLX_RECORDING_HEADER_SIZE - sizeof(writer->header), 1, writer->file) != 1)
+	{
+		fclose(writer->file);
+		writer->file = NULL;
+		return -3;
+	}
+	return 0;
+}
+
+/**
+ * @brief Append a frame
+ *
+ * Ta and Vdd of raw frames are calculated from the EEPROM, float32 frames take Ta from the packet header.
+ *
+ * @param writer open writer
+ * @param header packet header of the frame
+ * @param payload MLX_PIXEL_RAW words or 768 float32 temperatures, as the recording pixel format
+ * @param time_us recording time, e.g. CLOCK_REALTIME at reception. Raised to the previous frame time if
+ * it went backwards, so the index stays sorted
+ * @return 0 OK
+ * @return -1 pixel format does not match the recording
+ * @return -2 write failed
+ */
+int mlx_recording_writer_append(MlxRecordingWriter_type *writer, const MlxPacketHeader_type *header, const void *payload, int64_t time_us)
+{
+	static const uint8_t zero[8];
+	MlxRecordingRecord_type record = {0};
+
+	if (header->pixel_format != writer->header.pixel_format || header->payload_length != writer->header.payload_size)
+	{
+		return -1;
+	}
+	if (writer->frame_count == writer->index_capacity)
+	{
+		uint64_t capacity = (writer->index_capacity == 0) ? 4096 : 2 * writer->index_capacity;
+		int64_t *index = realloc(writer->index, capacity * sizeof(int64_t));
+		if (index == NULL)
+		{
+			return -2;
+		}
+		writer->index = index;
+		writer->index_capacity = capacity;
+	}
+
+	record.time_us = (time_us > writer->last_time_us) ? time_us : writer->last_time_us;
+	record.timestamp_us = header->timestamp_us;
+	record.sequence = header->sequence;
+	record.subpage = header->subpage;
+	record.pixel_format = header->pixel_format;
+	record.ta = header->ta;
+	record.vdd = NAN;
+	if (header->pixel_format == MLX_PIXEL_RAW)
+	{
+		uint16_t raw[MLX_PACKET_RAW_WORDS];
+		memcpy(raw, payload, sizeof(raw));
+		record.vdd = MLX90640_GetVdd(raw, &writer->params);
+		record.ta = MLX90640_GetTa(raw, &writer->params);
+	}
+
+	size_t padding = writer->header.record_size - sizeof(record) - writer->header.payload_size;
+	if (fwrite(&record, sizeof(record), 1, writer->file) != 1 ||
+		fwrite(payload, writer->header.payload_size, 1, writer->file) != 1 ||
+		(padding > 0 && fwrite(zero, padding, 1, writer->file) != 1))
+	{
+		return -2;
+	}
+	writer->index[writer->frame_count++] = record.time_us;
+	writer->last_time_us = record.time_us;
+	return 0;
+}
+
+/**
+ * @brief Write the index and the footer, then close the file
+ *
+ * @return 0 OK
+ * @return -1 write failed, the recording is readable without index
+ */
+int mlx_recording_writer_close(MlxRecordingWriter_type *writer)
+{
+	MlxRecordingFooter_type footer = {0};
+	int result = 0;
+
+	if (writer->file == NULL)
+	{
+		return -1;
+	}
+	footer.magic = MLX_RECORDING_INDEX_MAGIC;
+	footer.frame_count = writer->frame_count;
+	footer.index_offset = MLX_RECORDING_HEADER_SIZE + writer->frame_count * writer->header.record_size;
+	footer.index_crc = mlx_crc32(0, (const uint8_t *)writer->index, writer->frame_count * sizeof(int64_t));
+	if ((writer->frame_count > 0 && fwrite(writer->index, sizeof(int64_t), writer->frame_count, writer->file) != writer->frame_count) ||
+		fwrite(&footer, sizeof(footer), 1, writer->file) != 1)
+	{
+		result = -1;
+	}
+	if (fclose(writer->file) != 0)
+	{
+		result = -1;
+	}
+	free(writer->index);
+	writer->file = NULL;
+	writer->index = NULL;
+	return result;
+}
+
+/**
+ * @brief Map a recording
+ *
+ * @param recording output
+ * @param path recording file
+ * @return 0 OK
+ * @return -1 cannot open or map the file
+ * @return -2 not a recording, unsupported version or index footer pointing outside the file
+ */
+int mlx_recording_open(MlxRecording_type *recording, const char *path)
+{
+	struct stat st;
+
+	memset(recording, 0, sizeof(MlxRecording_type));
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < MLX_RECORDING_HEADER_SIZE)
+	{
+		close(fd);
+		return -1;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return -1;
+	}
+	recording->data = data;
+	recording->size = st.st_size;
+	recording->header = data;
+
+	const MlxRecordingHeader_type *header = recording->header;
+	if (header->magic != MLX_RECORDING_MAGIC || header->version != MLX_RECORDING_VERSION ||
+		header->header_size < sizeof(MlxRecordingHeader_type) || header->header_size > recording->size ||
+		header->record_size < sizeof(MlxRecordingRecord_type) + header->payload_size)
+	{
+		mlx_recording_close(recording);
+		return -2;
+	}
+
+	// Complete recordings end with the index, recordings without footer are cut after the last whole record
+	uint64_t records_size = recording->size - header->header_size;
+	recording->frame_count = records_size / header->record_size;
+	if (recording->size >= header->header_size + sizeof(MlxRecordingFooter_type))
+	{
+		MlxRecordingFooter_type footer;
+		memcpy(&footer, recording->data + recording->size - sizeof(footer), sizeof(footer));
+		uint64_t index_size = footer.frame_count * sizeof(int64_t);
+		if (footer.magic == MLX_RECORDING_INDEX_MAGIC &&
+			footer.index_offset == header->header_size + footer.frame_count * header->record_size &&
+			footer.index_offset + index_size + sizeof(footer) == recording->size &&
+			footer.index_crc == mlx_crc32(0, recording->data + footer.index_offset, index_size))
+		{
+			recording->frame_count = footer.frame_count;
+			recording->index = (const int64_t *)(recording->data + footer.index_offset);
+		}
+		else if (footer.magic == MLX_RECORDING_INDEX_MAGIC)
+		{
+			// Damaged index, the records end where it starts
+			if (footer.index_offset < header->header_size || footer.index_offset > recording->size - sizeof(footer))
+			{
+				mlx_recording_close(recording);
+				return -2;
+			}
+			recording->frame_count = (footer.index_offset - header->header_size) / header->record_size;
+		}
+	}
+	return 0;
+}
+
+void mlx_recording_close(MlxRecording_type *recording)
+{
+	if (recording->data != NULL)
+	{
+		munmap((void *)recording->data, recording->size);
+	}
+	memset(recording, 0, sizeof(MlxRecording_type));
+}
+
+/**
+ * @brief Record of frame k, O(1)
+ *
+ * @return const MlxRecordingRecord_type* record, NULL if out of range
+ */
+const MlxRecordingRecord_type *mlx_recording_frame(const MlxRecording_type *recording, uint64_t frame)
+{
+	if (frame >= recording->frame_count)
+	{
+		return NULL;
+	}
+	return (const MlxRecordingRecord_type *)(recording->data + recording->header->header_size + frame * recording->header->record_size);
+}
+
+/**
+ * @brief Pixels of a record, header->payload_size bytes
+ */
+const void *mlx_recording_payload(const MlxRecordingRecord_type *record)
+{
+	return record + 1;
+}
+
+/**
+ * @brief First frame at or after a time, O(log n)
+ *
+ * Searches the index, or the records of a recording without index.
+ *
+ * @param recording mapped recording
+ * @param time_us recording time
+ * @return frame index, frame_count if all frames are earlier
+ */
+int64_t mlx_recording_find_time(const MlxRecording_type *recording, int64_t time_us)
+{
+	uint64_t low = 0;
+	uint64_t high = recording->frame_count;
+
+	while (low < high)
+	{
+		uint64_t middle = low + (high - low) / 2;
+		int64_t middle_us = (recording->index != NULL) ? recording->index[middle] : mlx_recording_frame(recording, middle)->time_us;
+		if (middle_us < time_us)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
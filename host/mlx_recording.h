@@ -0,0 +1,110 @@
+#ifndef MLX_RECORDING_H
+#define MLX_RECORDING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "mlx_protocol.h"
+#include "mlx90640_api.h"
+
+/**
+ * Thermal recording file
+ *
+ * | Offset | Size | Content |
+ * | 0 | MLX_RECORDING_HEADER_SIZE | MlxRecordingHeader_type, zero padded |
+ * | header_size + k * record_size | record_size | frame k: MlxRecordingRecord_type, payload, zero padding |
+ * | index_offset | 8 * frame_count | time_us of every frame, the index |
+ * | file end - 32 | 32 | MlxRecordingFooter_type |
+ *
+ * All fields are little-endian. Records have a fixed size, so frame k is found without the index. The
+ * index holds the time of every frame contiguously, a time is found with a binary search that touches
+ * a few index pages instead of one record page per step. A recording without footer, e.g. from a writer
+ * that crashed, is still readable: frames are counted from the file size and times are searched in the
+ * records.
+ */
+#define MLX_RECORDING_MAGIC 0x4345524D		  /*!< "MREC"*/
+#define MLX_RECORDING_INDEX_MAGIC 0x5849524D /*!< "MRIX"*/
+#define MLX_RECORDING_VERSION 1
+#define MLX_RECORDING_HEADER_SIZE 4096 /*!< Records start page aligned*/
+
+/**
+ * @brief File header, written once by the writer
+ */
+typedef struct MlxRecordingHeader_type
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t record_size;
+	uint8_t pixel_format; // MLX_PIXEL_RAW or MLX_PIXEL_FLOAT32
+	uint8_t has_eeprom;
+	uint16_t reserved;
+	uint32_t payload_size;
+	int64_t created_us; // CLOCK_REALTIME when the recording was created
+	uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM]; // MLX90640_DumpEE words when has_eeprom
+} MlxRecordingHeader_type;
+
+/**
+ * @brief Record header, followed by payload_size bytes of MLX_PIXEL_RAW words or float32 temperatures
+ */
+typedef struct MlxRecordingRecord_type
+{
+	int64_t time_us;	   // recording time, never decreasing within a file
+	uint64_t timestamp_us; // device time from the packet header
+	uint32_t sequence;
+	float ta;
+	float vdd; // NAN when unknown
+	int8_t subpage;
+	uint8_t pixel_format;
+	uint16_t reserved;
+} MlxRecordingRecord_type;
+
+/**
+ * @brief Trailer written when the writer closes the recording
+ */
+typedef struct MlxRecordingFooter_type
+{
+	uint32_t magic;
+	uint32_t index_crc; // CRC-32 of the index
+	uint64_t frame_count;
+	uint64_t index_offset;
+	uint64_t reserved;
+} MlxRecordingFooter_type;
+
+_Static_assert(sizeof(MlxRecordingHeader_type) <= MLX_RECORDING_HEADER_SIZE, "MlxRecordingHeader_type must fit the header");
+_Static_assert(sizeof(MlxRecordingRecord_type) == 32, "MlxRecordingRecord_type must stay 32 bytes");
+_Static_assert(sizeof(MlxRecordingFooter_type) == 32, "MlxRecordingFooter_type must stay 32 bytes");
+
+typedef struct MlxRecordingWriter_type
+{
+	FILE *file;
+	MlxRecordingHeader_type header;
+	paramsMLX90640 params; // Ta and Vdd of raw frames
+	int64_t *index;
+	uint64_t frame_count;
+	uint64_t index_capacity;
+	int64_t last_time_us;
+} MlxRecordingWriter_type;
+
+/**
+ * @brief Recording mapped read only
+ */
+typedef struct MlxRecording_type
+{
+	const uint8_t *data;
+	size_t size;
+	const MlxRecordingHeader_type *header;
+	uint64_t frame_count;
+	const int64_t *index; // NULL without a valid footer
+} MlxRecording_type;
+
+int mlx_recording_writer_open(MlxRecordingWriter_type *writer, const char *path, uint8_t pixel_format, const uint16_t *eeprom);
+int mlx_recording_writer_append(MlxRecordingWriter_type *writer, const MlxPacketHeader_type *header, const void *payload, int64_t time_us);
+int mlx_recording_writer_close(MlxRecordingWriter_type *writer);
+int mlx_recording_open(MlxRecording_type *recording, const char *path);
+void mlx_recording_close(MlxRecording_type *recording);
+const MlxRecordingRecord_type *mlx_recording_frame(const MlxRecording_type *recording, uint64_t frame);
+const void *mlx_recording_payload(const MlxRecordingRecord_type *record);
+int64_t mlx_recording_find_time(const MlxRecording_type *recording, int64_t time_us);
+
+#endif // MLX_RECORDING_H
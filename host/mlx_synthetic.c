@@ -0,0 +1,226 @@
+#include "mlx_synthetic.h"
+#include "mlx_protocol.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Plausible EEPROM, two bad pixels included
+ */
+void mlx_synthetic_eeprom(uint16_t *eeprom)
+{
+	const uint16_t header[48] = {
+		0x4210, 0xFFBA, 0x0202, 0x0202, 0xF202, 0xF1F2, 0xE1E1, 0xD1E1, // 16-23 offset rows and columns
+		0xF10F, 0xF00F, 0xE0EF, 0xE0EF, 0xE1E1, 0xF1F1, 0xF202, 0xF202, // 24-31
+		(6 << 12) | (3 << 8) | (2 << 4) | 1, 0x2F44, 0x1111, 0x2221,		 // 32-35 alpha scales and reference
+		0x3332, 0x3333, 0x3333, 0x2233, 0x1122, 0x0011, 0x1111, 0x1111,	 // 36-43
+		0x2221, 0x3322, 0x3333, 0x2233, 0x18EF, 0x2FF1, 0x5952, 0x9D68,	 // 44-51 gain, ptat, kv ptat
+		0x2233, (2 << 11) | (4 << 6) | 1, 0x5A5A, 0x5858, 0x2363,		 // 52-56 kta, kv, resolution
+		(4 << 10) | 35, (61 << 10) | 949, (4 << 8) | 10, 0xEE20, 0x9898, 0x9898, 0x2689, // 57-63 cp, ks
+	};
+	memset(eeprom, 0, MLX90640_EEPROM_DUMP_NUM * sizeof(uint16_t));
+	memcpy(&eeprom[16], header, sizeof(header));
+	uint32_t state = 12345;
+	for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+	{
+		state = state * 1664525 + 1013904223;
+		eeprom[64 + pixel] = ((state >> 16) & 0xFFFE) | 0x0010;
+	}
+	eeprom[64 + 300] = 0;	   // broken
+	eeprom[64 + 500] |= 0x0001; // outlier
+}
+
+/**
+ * @brief 20-40 °C gradient with a spot 70 °C hotter that moves one column every 4 frames
+ *
+ * The spot is above the second corner temperature of most sensors.
+ *
+ * @param scene output, 768 temperatures in °C
+ * @param frame frame number, frame 0 has the spot at row 12, column 16
+ */
+void mlx_synthetic_scene(float *scene, uint32_t frame)
+{
+	int spot_column = (16 + frame / 4) % MLX90640_COLUMN_NUM;
+	for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+	{
+		int row = pixel / 32;
+		int column = pixel % 32;
+		scene[pixel] = 20 + 20 * column / 31.0f + ((abs(row - 12) < 3 && abs(column - spot_column) < 3) ? 70 : 0);
+	}
+}
+
+/**
+ * @brief Read an EEPROM file, 832 little-endian words as sent in MLX_PACKET_EEPROM
+ *
+ * @param path EEPROM file, NULL or "-" for mlx_synthetic_eeprom
+ * @param eeprom output, MLX90640_EEPROM_DUMP_NUM words
+ * @return 0 OK
+ * @return -1 cannot read 832 words
+ */
+int mlx_synthetic_load_eeprom(const char *path, uint16_t *eeprom)
+{
+	uint8_t bytes[MLX_PACKET_EEPROM_WORDS * 2];
+
+	if (path == NULL || strcmp(path, "-") == 0)
+	{
+		mlx_synthetic_eeprom(eeprom);
+		return 0;
+	}
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+	size_t size = fread(bytes, 1, sizeof(bytes), file);
+	fclose(file);
+	if (size != sizeof(bytes))
+	{
+		return -1;
+	}
+	for (int i = 0; i < MLX_PACKET_EEPROM_WORDS; i++)
+	{
+		eeprom[i] = bytes[2 * i] | (bytes[2 * i + 1] << 8);
+	}
+	return 0;
+}
+
+static int16_t word_clamp(double value, int *clamped)
+{
+	long word = lrint(value);
+	if (word < INT16_MIN || word > INT16_MAX)
+	{
+		(*clamped)++;
+		return (word < INT16_MIN) ? INT16_MIN : INT16_MAX;
+	}
+	return (int16_t)word;
+}
+
+/**
+ * @brief Temperature range MLX90640_CalculateTo corrects a To in
+ */
+static int to_range(const paramsMLX90640 *params, double to)
+{
+	return (to < params->ct[1]) ? 0 : (to < params->ct[2]) ? 1 : (to < params->ct[3]) ? 2 : 3;
+}
+
+/**
+ * @brief Raw subpage that MLX90640_CalculateTo converts back to a temperature map
+ *
+ * Inverts the sensor model of mlx90640_api.c step by step. The aux words set Vdd and then Ta, the gain
+ * word equals the EEPROM gain and the compensation pixels read their offsets. Every pixel of the subpage
+ * gets the word whose To is the target, in the sensitivity range MLX90640_CalculateTo will pick for it.
+ * The pixels use the Ta and Vdd the words actually encode, so the rounding of the aux words does not
+ * shift the pixel temperatures. Pixel words are rounded to the nearest count, so the round trip is off by
+ * up to half a count: about 0.05 °C at -40 °C and less for warmer targets, within MLX_SYNTHETIC_TOLERANCE
+ * from -40 to 300 °C. Bad pixels are written like the others,
+ * MLX90640_BadPixelsCorrection replaces them after the conversion.
+ *
+ * @param params parameters of a real or synthetic EEPROM
+ * @param conditions measurement conditions
+ * @param to target temperatures in °C, 768 pixels, only the pixels of the subpage are used
+ * @param subpage 0 or 1
+ * @param raw output, MLX_PACKET_RAW_WORDS words as MLX90640_GetFrameData returns them
+ * @return number of pixels out of the int16 range of the sensor, they were clamped
+ * @return -1 Ta or Vdd are out of the range of the aux words, they were clamped
+ */
+int mlx_synthetic_raw(const paramsMLX90640 *params, const MlxSyntheticConditions_type *conditions, const float *to, uint8_t subpage, uint16_t *raw)
+{
+	int aux_clamped = 0;
+	int clamped = 0;
+
+	memset(raw, 0, MLX_PACKET_RAW_WORDS * sizeof(uint16_t));
+	raw[832] = (conditions->chess ? MLX90640_CTRL_MEAS_MODE_MASK : 0) | (params->resolutionEE << MLX90640_CTRL_RESOLUTION_SHIFT);
+	raw[833] = subpage;
+	raw[778] = (uint16_t)params->gainEE;
+
+	// Vdd, then Ta at the Vdd the word gives
+	raw[810] = (uint16_t)word_clamp((conditions->vdd - 3.3) * params->kVdd + params->vdd25, &aux_clamped);
+	double vdd = MLX90640_GetVdd(raw, params);
+	double ptat_art = ((conditions->ta - 25) * params->KtPTAT + params->vPTAT25) * (1 + params->KvPTAT * (vdd - 3.3));
+	raw[800] = (uint16_t)MLX_SYNTHETIC_PTAT;
+	raw[768] = (uint16_t)word_clamp(MLX_SYNTHETIC_PTAT * POW2(18) / ptat_art - MLX_SYNTHETIC_PTAT * params->alphaPTAT, &aux_clamped);
+	double ta = MLX90640_GetTa(raw, params);
+
+	// Compensation pixels at their offsets, irDataCP is only the rounding of the words
+	uint8_t mode = (raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> 5;
+	double cp_factor = (1 + params->cpKta * (ta - 25)) * (1 + params->cpKv * (vdd - 3.3));
+	double cp_offset_1 = params->cpOffset[1] + ((mode != params->calibrationModeEE) ? params->ilChessC[0] : 0);
+	raw[776] = (uint16_t)word_clamp(params->cpOffset[0] * cp_factor, &aux_clamped);
+	raw[808] = (uint16_t)word_clamp(cp_offset_1 * cp_factor, &aux_clamped);
+	double ir_cp = (subpage == 0) ? (int16_t)raw[776] - params->cpOffset[0] * cp_factor : (int16_t)raw[808] - cp_offset_1 * cp_factor;
+
+	double ta4 = pow(ta + 273.15, 4);
+	double tr4 = pow(conditions->tr + 273.15, 4);
+	double ta_tr = tr4 - (tr4 - ta4) / conditions->emissivity;
+	double alpha_corr_r[4];
+	alpha_corr_r[0] = 1 / (1 + params->ksTo[0] * 40);
+	alpha_corr_r[1] = 1;
+	alpha_corr_r[2] = 1 + params->ksTo[1] * params->ct[2];
+	alpha_corr_r[3] = alpha_corr_r[2] * (1 + params->ksTo[2] * (params->ct[3] - params->ct[2]));
+
+	for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+	{
+		int il_pattern = pixel / 32 - (pixel / 64) * 2;
+		int chess_pattern = il_pattern ^ (pixel - (pixel / 2) * 2);
+		int conversion_pattern = ((pixel + 2) / 4 - (pixel + 3) / 4 + (pixel + 1) / 4 - pixel / 4) * (1 - 2 * il_pattern);
+		if ((mode == 0 ? il_pattern : chess_pattern) != subpage)
+		{
+			continue;
+		}
+
+		double alpha = SCALEALPHA * POW2(params->alphaScale) / params->alpha[pixel] * (1 + params->KsTa * (ta - 25));
+		double target = to[pixel];
+		double t4 = pow(target + 273.15, 4);
+		// The range and its ksTo correction use the first estimate of MLX90640_CalculateTo, which depends on
+		// the word itself: iterate until the estimate settles, ksTo is small so a few rounds suffice
+		double estimate = target;
+		double ir_data = 0;
+		for (int attempt = 0; attempt < 8; attempt++)
+		{
+			int range = to_range(params, estimate);
+			ir_data = (t4 - ta_tr) * alpha * alpha_corr_r[range] * (1 + params->ksTo[range] * (estimate - params->ct[range]));
+			double sx = sqrt(sqrt(alpha * alpha * alpha * (ir_data + alpha * ta_tr))) * params->ksTo[1];
+			double next = sqrt(sqrt(ir_data / (alpha * (1 - params->ksTo[1] * 273.15) + sx) + ta_tr)) - 273.15;
+			if (fabs(next - estimate) < 1e-4)
+			{
+				break;
+			}
+			estimate = next;
+		}
+
+		double kta = params->kta[pixel] / POW2(params->ktaScale);
+		double kv = params->kv[pixel] / POW2(params->kvScale);
+		double value = ir_data * conditions->emissivity + params->tgc * ir_cp + params->offset[pixel] * (1 + kta * (ta - 25)) * (1 + kv * (vdd - 3.3));
+		if (mode != params->calibrationModeEE)
+		{
+			value -= params->ilChessC[2] * (2 * il_pattern - 1) - params->ilChessC[1] * conversion_pattern;
+		}
+		// The gain word equals gainEE, the gain is 1
+		raw[pixel] = (uint16_t)word_clamp(value, &clamped);
+	}
+	return (aux_clamped > 0) ? -1 : clamped;
+}
+
+/**
+ * @brief Raw subpage of a scene at MLX_SYNTHETIC_TA and 3.3 V, with the settings of a calibration
+ *
+ * @param calibration calibration of the synthetic or a real EEPROM, gives emissivity and ambient offset
+ * @param scene 768 temperatures in °C
+ * @param chess 1 chess pattern, 0 interleaved
+ * @param subpage 0 or 1
+ * @param raw output, MLX_PACKET_RAW_WORDS words
+ */
+void mlx_synthetic_subpage(const MlxCalibration_type *calibration, const float *scene, uint8_t chess, uint8_t subpage, uint16_t *raw)
+{
+	MlxSyntheticConditions_type conditions = {
+		.ta = MLX_SYNTHETIC_TA,
+		.vdd = 3.3f,
+		.emissivity = calibration->emissivity,
+		.chess = chess,
+	};
+	// mlx_calibration_convert reflects Ta + ambient_offset, the Ta the words encode is within a few mK
+	conditions.tr = MLX_SYNTHETIC_TA + calibration->ambient_offset;
+	mlx_synthetic_raw(&calibration->params, &conditions, scene, subpage, raw);
+}
@@ -0,0 +1,35 @@
+#ifndef MLX_SYNTHETIC_H
+#define MLX_SYNTHETIC_H
+
+#include <stdint.h>
+#include "mlx_calibration.h"
+
+/**
+ * Synthetic sensor data for the host benchmarks and fixtures
+ *
+ * A plausible EEPROM, a test scene and the inverse of MLX90640_CalculateTo: the raw words of a subpage
+ * that measure a given temperature map at a given Ta and Vdd, with any real or synthetic EEPROM.
+ */
+#define MLX_SYNTHETIC_TA 30.0f		 /*!< Ambient temperature of mlx_synthetic_subpage*/
+#define MLX_SYNTHETIC_PTAT 1700		 /*!< PTAT word of the synthetic subpages*/
+#define MLX_SYNTHETIC_TOLERANCE 0.1f	 /*!< Max round trip error in °C of mlx_synthetic_raw, -40 to 300 °C*/
+
+/**
+ * @brief Measurement conditions of a synthetic subpage
+ */
+typedef struct MlxSyntheticConditions_type
+{
+	float ta;		  // ambient temperature in °C
+	float vdd;		  // supply voltage in V
+	float emissivity; // as passed to MLX90640_CalculateTo
+	float tr;		  // reflected temperature in °C, as passed to MLX90640_CalculateTo
+	uint8_t chess;	  // 1 chess pattern, 0 interleaved
+} MlxSyntheticConditions_type;
+
+void mlx_synthetic_eeprom(uint16_t *eeprom);
+int mlx_synthetic_load_eeprom(const char *path, uint16_t *eeprom);
+void mlx_synthetic_scene(float *scene, uint32_t frame);
+int mlx_synthetic_raw(const paramsMLX90640 *params, const MlxSyntheticConditions_type *conditions, const float *to, uint8_t subpage, uint16_t *raw);
+void mlx_synthetic_subpage(const MlxCalibration_type *calibration, const float *scene, uint8_t chess, uint8_t subpage, uint16_t *raw);
+
+#endif // MLX_SYNTHETIC_H
@@ -0,0 +1,104 @@
+#include "packet_reader.h"
+
+#include <string.h>
+
+void packet_reader_init(PacketReader_type *reader, PacketReaderCallback_type callback, void *context)
+{
+	memset(reader, 0, sizeof(PacketReader_type));
+	reader->callback = callback;
+	reader->context = context;
+}
+
+/**
+ * @brief Run the callback for every complete packet in the buffer, keep the incomplete tail
+ *
+ * @return number of packets
+ */
+static int packet_reader_parse(PacketReader_type *reader)
+{
+	size_t pos = 0;
+	int packets = 0;
+
+	while (reader->filled - pos >= sizeof(MlxPacketHeader_type))
+	{
+		MlxPacketHeader_type header;
+		memcpy(&header, reader->buffer + pos, sizeof(header));
+		if (mlx_packet_header_validate(&header) != 0)
+		{
+			pos++;
+			reader->skipped_bytes++;
+			continue;
+		}
+		size_t packet_size = sizeof(header) + header.payload_length + MLX_PACKET_CRC_SIZE;
+		if (reader->filled - pos < packet_size)
+		{
+			break;
+		}
+		const uint8_t *payload = reader->buffer + pos + sizeof(header);
+		uint32_t crc;
+		memcpy(&crc, payload + header.payload_length, sizeof(crc));
+		if (crc != mlx_packet_crc(&header, payload))
+		{
+			// The header may be corrupt too, resync from the next byte
+			reader->crc_errors++;
+			pos++;
+			continue;
+		}
+		reader->packets++;
+		packets++;
+		if (reader->callback != NULL)
+		{
+			reader->callback(reader->context, &header, payload);
+		}
+		pos += packet_size;
+	}
+	memmove(reader->buffer, reader->buffer + pos, reader->filled - pos);
+	reader->filled -= pos;
+	return packets;
+}
+
+/**
+ * @brief Add received bytes
+ *
+ * @param reader packet reader
+ * @param data received bytes
+ * @param size number of bytes
+ * @return number of complete packets
+ */
+int packet_reader_feed(PacketReader_type *reader, const uint8_t *data, size_t size)
+{
+	int packets = 0;
+	while (size > 0)
+	{
+		size_t chunk = sizeof(reader->buffer) - reader->filled;
+		chunk = (size < chunk) ? size : chunk;
+		memcpy(reader->buffer + reader->filled, data, chunk);
+		reader->filled += chunk;
+		reader->bytes += chunk;
+		data += chunk;
+		size -= chunk;
+		packets += packet_reader_parse(reader);
+	}
+	return packets;
+}
+
+/**
+ * @brief Read from the transport straight into the reader buffer and parse
+ *
+ * @param reader packet reader
+ * @param transport host transport
+ * @param timeout_ms max wait for data
+ * @return number of complete packets
+ * @return -1 transport closed or failed
+ */
+int packet_reader_read(PacketReader_type *reader, const Transport_type *transport, uint32_t timeout_ms)
+{
+	int rx_size = transport_read(transport, reader->buffer + reader->filled, sizeof(reader->buffer) - reader->filled, timeout_ms);
+	if (rx_size < 0)
+	{
+		return -1;
+	}
+	reader->filled += rx_size;
+	reader->bytes += rx_size;
+	return packet_reader_parse(reader);
+}
@@ -0,0 +1,34 @@
+#ifndef PACKET_READER_H
+#define PACKET_READER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mlx_protocol.h"
+
+#define PACKET_READER_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief Called for every packet with a valid CRC, payload points into the reader buffer
+ */
+typedef void (*PacketReaderCallback_type)(void *context, const MlxPacketHeader_type *header, const uint8_t *payload);
+
+/**
+ * @brief Splits a byte stream into packets, resyncs on the magic after corrupt data
+ */
+typedef struct PacketReader_type
+{
+	uint8_t buffer[PACKET_READER_BUFFER_SIZE];
+	size_t filled;
+	uint64_t bytes;
+	uint32_t packets;
+	uint32_t crc_errors;
+	uint32_t skipped_bytes; // bytes dropped while looking for a header
+	PacketReaderCallback_type callback;
+	void *context;
+} PacketReader_type;
+
+void packet_reader_init(PacketReader_type *reader, PacketReaderCallback_type callback, void *context);
+int packet_reader_feed(PacketReader_type *reader, const uint8_t *data, size_t size);
+int packet_reader_read(PacketReader_type *reader, const Transport_type *transport, uint32_t timeout_ms);
+
+#endif // PACKET_READER_H
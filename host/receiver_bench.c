@@ -0,0 +1,324 @@
+/**
+ * Host receiver benchmark
+ *
+ * 1. Pixel conversion: mlx_pixels_to_float against the scalar pixel_decode, results must be bit identical.
+ * 2. Parsing from memory: mlx_receiver views against packet_reader, both convert every frame.
+ * 3. Devices per core: every device thread streams packets into its own socket pair as fast as it can,
+ *    one receiver thread polls all of them. The receiver CPU time per frame gives the number of
+ *    devices at DEVICE_FPS one core keeps up with.
+ *
+ * Usage: receiver_bench [F32|F16|I16|U8] [devices] [frames per device]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mlx_receiver.h"
+#include "packet_reader.h"
+#include "transport_fd.h"
+#include "pixel_encoding.h"
+
+#define PIXELS 768
+#define STREAM_FRAMES 64
+#define DEFAULT_DEVICES 32
+#define DEFAULT_FRAMES 20000
+#define DEVICE_FPS 32 /*!< Full frames per second at the 64 Hz subpage rate*/
+#define MAX_DEVICES 256
+
+typedef struct BenchStream_type
+{
+	uint8_t *data;
+	size_t size;
+	size_t pos;
+} BenchStream_type;
+
+typedef struct BenchDevice_type
+{
+	Transport_type transport;
+	TransportFd_type backend;
+	const BenchStream_type *stream;
+	int frames;
+} BenchDevice_type;
+
+static double now_s(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int parse_format(const char *name)
+{
+	const char *format_names[] = {"F32", "F16", "I16", "U8"};
+	for (int i = 0; i < 4; i++)
+	{
+		if (strcmp(name, format_names[i]) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief STREAM_FRAMES packets of a moving gradient, repeated by the readers
+ */
+static void stream_build(BenchStream_type *stream, uint8_t pixel_format)
+{
+	float temps[PIXELS];
+	static uint8_t encoded[PIXELS * 4];
+	MlxPacketHeader_type header;
+
+	stream->data = malloc(STREAM_FRAMES * (sizeof(header) + sizeof(encoded) + MLX_PACKET_CRC_SIZE));
+	stream->size = 0;
+	stream->pos = 0;
+	for (int n = 0; n < STREAM_FRAMES; n++)
+	{
+		for (int i = 0; i < PIXELS; i++)
+		{
+			temps[i] = 25.0f + 10.0f * sinf(0.01f * i + 0.1f * n);
+		}
+		float offset;
+		float scale;
+		int size = pixel_encode(temps, PIXELS, pixel_format, encoded, &offset, &scale);
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, n, n, size);
+		header.pixel_format = pixel_format;
+		header.offset = offset;
+		header.scale = scale;
+		uint32_t crc = mlx_packet_crc(&header, encoded);
+		memcpy(stream->data + stream->size, &header, sizeof(header));
+		memcpy(stream->data + stream->size + sizeof(header), encoded, size);
+		memcpy(stream->data + stream->size + sizeof(header) + size, &crc, sizeof(crc));
+		stream->size += sizeof(header) + size + sizeof(crc);
+	}
+}
+
+/**
+ * @brief Transport read from the repeating in-memory stream
+ */
+static int stream_read(void *context, void *data, size_t size, uint32_t timeout_ms)
+{
+	(void)timeout_ms;
+	BenchStream_type *stream = (BenchStream_type *)context;
+	size_t chunk = stream->size - stream->pos;
+	chunk = (size < chunk) ? size : chunk;
+	chunk = (chunk < 4096) ? chunk : 4096;
+	memcpy(data, stream->data + stream->pos, chunk);
+	stream->pos = (stream->pos + chunk) % stream->size;
+	return chunk;
+}
+
+static void bench_convert(const BenchStream_type *stream, uint8_t pixel_format)
+{
+	float scalar[PIXELS];
+	float simd[PIXELS];
+	const int rounds = 200000;
+	const MlxPacketHeader_type *header = (const MlxPacketHeader_type *)stream->data;
+	const uint8_t *payload = stream->data + sizeof(MlxPacketHeader_type);
+
+	pixel_decode(payload, PIXELS, pixel_format, header->offset, header->scale, scalar);
+	mlx_pixels_to_float(payload, PIXELS, pixel_format, header->offset, header->scale, simd);
+	int mismatches = memcmp(scalar, simd, sizeof(scalar)) != 0;
+
+	// Half precision special values
+	uint16_t halves[PIXELS];
+	for (int i = 0; i < PIXELS; i++)
+	{
+		halves[i] = (i < 64) ? (uint16_t)(i * 0x401) : (uint16_t)(rand() & 0xFFFF);
+	}
+	halves[0] = 0x7C00;
+	halves[1] = 0xFC00;
+	halves[2] = 0x7E01;
+	halves[3] = 0x8001;
+	pixel_decode(halves, PIXELS, MLX_PIXEL_FLOAT16, 0, 1, scalar);
+	mlx_pixels_to_float(halves, PIXELS, MLX_PIXEL_FLOAT16, 0, 1, simd);
+	mismatches += memcmp(scalar, simd, sizeof(scalar)) != 0;
+
+	double start = now_s(CLOCK_MONOTONIC);
+	for (int n = 0; n < rounds; n++)
+	{
+		pixel_decode(payload, PIXELS, pixel_format, header->offset, header->scale, scalar);
+		__asm__ volatile("" : : "r"(scalar) : "memory");
+	}
+	double scalar_s = now_s(CLOCK_MONOTONIC) - start;
+	start = now_s(CLOCK_MONOTONIC);
+	for (int n = 0; n < rounds; n++)
+	{
+		mlx_pixels_to_float(payload, PIXELS, pixel_format, header->offset, header->scale, simd);
+		__asm__ volatile("" : : "r"(simd) : "memory");
+	}
+	double simd_s = now_s(CLOCK_MONOTONIC) - start;
+
+	printf("convert           scalar %.0f ns, simd %.0f ns per frame (%.1fx), %s\n",
+		   scalar_s / rounds * 1e9, simd_s / rounds * 1e9, scalar_s / simd_s,
+		   (mismatches == 0) ? "bit identical" : "MISMATCH");
+}
+
+typedef struct BenchReaderContext_type
+{
+	float temps[PIXELS];
+	uint32_t frames;
+} BenchReaderContext_type;
+
+static void reader_packet(void *context, const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	BenchReaderContext_type *reader_context = (BenchReaderContext_type *)context;
+	pixel_decode(payload, PIXELS, header->pixel_format, header->offset, header->scale, reader_context->temps);
+	reader_context->frames++;
+}
+
+static void bench_parse(BenchStream_type *stream, uint32_t frames)
+{
+	Transport_type transport = {.name = "memory", .read = stream_read, .context = stream};
+	static MlxReceiver_type receiver;
+	static PacketReader_type reader;
+	BenchReaderContext_type reader_context = {0};
+	MlxFrameView_type view;
+	float temps[PIXELS];
+
+	packet_reader_init(&reader, reader_packet, &reader_context);
+	double start = now_s(CLOCK_MONOTONIC);
+	while (reader_context.frames < frames)
+	{
+		packet_reader_read(&reader, &transport, 0);
+	}
+	double reader_s = now_s(CLOCK_MONOTONIC) - start;
+
+	mlx_receiver_init(&receiver, &transport, 0);
+	uint32_t received = 0;
+	start = now_s(CLOCK_MONOTONIC);
+	while (received < frames)
+	{
+		mlx_receiver_fill(&receiver, 0);
+		while (mlx_receiver_next(&receiver, &view) == 1)
+		{
+			mlx_receiver_convert(&receiver, &view, temps);
+			mlx_receiver_release(&receiver, &view);
+			received++;
+		}
+	}
+	double receiver_s = now_s(CLOCK_MONOTONIC) - start;
+	printf("parse + convert   packet_reader %.0f, mlx_receiver %.0f frames/s, %lu crc errors\n",
+		   frames / reader_s, frames / receiver_s, (unsigned long)(receiver.crc_errors + reader.crc_errors));
+	mlx_receiver_free(&receiver);
+}
+
+static void *device_thread(void *params)
+{
+	BenchDevice_type *device = (BenchDevice_type *)params;
+	const BenchStream_type *stream = device->stream;
+	size_t total = (size_t)device->frames / STREAM_FRAMES * stream->size;
+	for (size_t sent = 0; sent < total; sent += stream->size)
+	{
+		if (transport_write(&device->transport, stream->data, stream->size) < 0)
+		{
+			break;
+		}
+	}
+	close(device->backend.fd);
+	return NULL;
+}
+
+static int bench_devices(const BenchStream_type *stream, int devices, int frames)
+{
+	static BenchDevice_type device[MAX_DEVICES];
+	static Transport_type host_transport[MAX_DEVICES];
+	static TransportFd_type host_backend[MAX_DEVICES];
+	static MlxReceiver_type receiver[MAX_DEVICES];
+	pthread_t thread[MAX_DEVICES];
+	struct pollfd fds[MAX_DEVICES];
+	MlxFrameView_type view;
+	float temps[PIXELS];
+	uint64_t received = 0;
+	uint32_t errors = 0;
+
+	frames = frames / STREAM_FRAMES * STREAM_FRAMES;
+	for (int d = 0; d < devices; d++)
+	{
+		int pair[2];
+		if (transport_fd_socketpair(pair) != 0)
+		{
+			perror("socketpair");
+			return -1;
+		}
+		transport_fd_init(&device[d].transport, &device[d].backend, pair[0], "device");
+		transport_fd_init(&host_transport[d], &host_backend[d], pair[1], "host");
+		mlx_receiver_init(&receiver[d], &host_transport[d], 0);
+		fds[d].fd = pair[1];
+		fds[d].events = POLLIN;
+		device[d].stream = stream;
+		device[d].frames = frames;
+	}
+
+	double start = now_s(CLOCK_MONOTONIC);
+	double start_cpu = now_s(CLOCK_THREAD_CPUTIME_ID);
+	for (int d = 0; d < devices; d++)
+	{
+		pthread_create(&thread[d], NULL, device_thread, &device[d]);
+	}
+	int open_devices = devices;
+	while (open_devices > 0)
+	{
+		poll(fds, devices, 1000);
+		for (int d = 0; d < devices; d++)
+		{
+			if (fds[d].revents == 0)
+			{
+				continue;
+			}
+			if (mlx_receiver_fill(&receiver[d], 0) <= 0)
+			{
+				fds[d].fd = -1;
+				open_devices--;
+				continue;
+			}
+			while (mlx_receiver_next(&receiver[d], &view) == 1)
+			{
+				errors += mlx_receiver_convert(&receiver[d], &view, temps) != 0;
+				mlx_receiver_release(&receiver[d], &view);
+				received++;
+			}
+		}
+	}
+	double cpu_s = now_s(CLOCK_THREAD_CPUTIME_ID) - start_cpu;
+	double elapsed = now_s(CLOCK_MONOTONIC) - start;
+
+	for (int d = 0; d < devices; d++)
+	{
+		pthread_join(thread[d], NULL);
+		errors += receiver[d].crc_errors;
+		close(host_backend[d].fd);
+		mlx_receiver_free(&receiver[d]);
+	}
+	printf("devices           %d, %lu of %lu frames, %lu errors\n", devices, (unsigned long)received,
+		   (unsigned long)devices * frames, (unsigned long)errors);
+	printf("receiver thread   %.0f frames/s wall, %.2f us cpu per frame\n", received / elapsed, cpu_s / received * 1e6);
+	printf("devices per core  %.0f at %d fps\n", received / cpu_s / DEVICE_FPS, DEVICE_FPS);
+	return (received == (uint64_t)devices * frames && errors == 0) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+	int format = parse_format((argc > 1) ? argv[1] : "F32");
+	int devices = (argc > 2) ? atoi(argv[2]) : DEFAULT_DEVICES;
+	int frames = (argc > 3) ? atoi(argv[3]) : DEFAULT_FRAMES;
+	BenchStream_type stream;
+
+	if (format < 0 || devices < 1 || devices > MAX_DEVICES || frames < STREAM_FRAMES)
+	{
+		fprintf(stderr, "usage: %s [F32|F16|I16|U8] [devices 1-%d] [frames >= %d]\n", argv[0], MAX_DEVICES, STREAM_FRAMES);
+		return 1;
+	}
+	stream_build(&stream, format);
+	printf("format            %s, %zu bytes per packet\n", argc > 1 ? argv[1] : "F32", stream.size / STREAM_FRAMES);
+	bench_convert(&stream, format);
+	bench_parse(&stream, frames);
+	int result = bench_devices(&stream, devices, frames);
+	free(stream.data);
+	return (result == 0) ? 0 : 1;
+}
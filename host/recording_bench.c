@@ -0,0 +1,283 @@
+/**
+ * Recording benchmark and converter
+ *
+ * bench writes the same synthetic raw frames as a packet stream dump and as a recording
+ * (mlx_recording.h), then compares the ways to reach a frame: frame k of the recording, time t through
+ * the index, time t through the records, and time t by scanning the dump from the start as an ad-hoc
+ * recording requires.
+ *
+ * convert turns a dump of a raw stream (MLX SET OUT RAW) into a recording. Recording times are the device
+ * timestamps, frames after a second, different EEPROM are dropped.
+ *
+ * Usage:
+ *   recording_bench bench [frames] [directory]
+ *   recording_bench convert stream.bin recording.mlxr
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mlx_recording.h"
+#include "mlx_synthetic.h"
+#include "packet_reader.h"
+
+#define DEFAULT_FRAMES 100000
+#define LOOKUPS 100000
+#define DUMP_SEEKS 10
+#define SUBPAGE_US 15625 /*!< 64 Hz subpage period*/
+#define SYNTHETIC_SUBPAGES 64
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t random_next(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/**
+ * @brief Seek state of a dump scan: stop at the first raw frame at or after time_us
+ */
+typedef struct DumpSeek_type
+{
+	uint64_t time_us;
+	int64_t frame;
+	int64_t found;
+} DumpSeek_type;
+
+static void dump_seek_packet(void *context, const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	(void)payload;
+	DumpSeek_type *seek = (DumpSeek_type *)context;
+	if (header->type != MLX_PACKET_FRAME)
+	{
+		return;
+	}
+	if (seek->found < 0 && header->timestamp_us >= seek->time_us)
+	{
+		seek->found = seek->frame;
+	}
+	seek->frame++;
+}
+
+static int64_t dump_seek(FILE *file, uint64_t time_us)
+{
+	static PacketReader_type reader;
+	static uint8_t chunk[64 * 1024];
+	DumpSeek_type seek = {.time_us = time_us, .found = -1};
+	size_t size;
+
+	packet_reader_init(&reader, dump_seek_packet, &seek);
+	rewind(file);
+	while (seek.found < 0 && (size = fread(chunk, 1, sizeof(chunk), file)) > 0)
+	{
+		packet_reader_feed(&reader, chunk, size);
+	}
+	return seek.found;
+}
+
+static int bench(uint32_t frames, const char *directory)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static MlxCalibration_type calibration;
+	static uint16_t raw[SYNTHETIC_SUBPAGES][MLX_PACKET_RAW_WORDS];
+	static float scene[MLX90640_PIXEL_NUM];
+	char dump_path[256];
+	char recording_path[256];
+	MlxRecordingWriter_type writer;
+	MlxRecording_type recording;
+	MlxPacketHeader_type header;
+
+	snprintf(dump_path, sizeof(dump_path), "%s/recording_bench.bin", directory);
+	snprintf(recording_path, sizeof(recording_path), "%s/recording_bench.mlxr", directory);
+	mlx_synthetic_eeprom(eeprom);
+	mlx_calibration_init(&calibration, eeprom);
+	for (int n = 0; n < SYNTHETIC_SUBPAGES; n++)
+	{
+		mlx_synthetic_scene(scene, n / 2);
+		mlx_synthetic_subpage(&calibration, scene, 1, n % 2, raw[n]);
+	}
+
+	// The same frames as a dump and as a recording
+	FILE *dump = fopen(dump_path, "w+b");
+	if (dump == NULL || mlx_recording_writer_open(&writer, recording_path, MLX_PIXEL_RAW, eeprom) != 0)
+	{
+		fprintf(stderr, "Cannot create the files in %s\n", directory);
+		return 1;
+	}
+	double write_s = 0;
+	for (uint32_t n = 0; n < frames; n++)
+	{
+		const uint16_t *payload = raw[n % SYNTHETIC_SUBPAGES];
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, n, (uint64_t)n * SUBPAGE_US, MLX_PACKET_RAW_WORDS * sizeof(uint16_t));
+		header.pixel_format = MLX_PIXEL_RAW;
+		header.subpage = n % 2;
+		uint32_t crc = mlx_packet_crc(&header, (const uint8_t *)payload);
+		fwrite(&header, sizeof(header), 1, dump);
+		fwrite(payload, header.payload_length, 1, dump);
+		fwrite(&crc, sizeof(crc), 1, dump);
+
+		double start = now_s();
+		mlx_recording_writer_append(&writer, &header, payload, header.timestamp_us);
+		write_s += now_s() - start;
+	}
+	double start = now_s();
+	mlx_recording_writer_close(&writer);
+	write_s += now_s() - start;
+	fflush(dump);
+
+	start = now_s();
+	if (mlx_recording_open(&recording, recording_path) != 0 || recording.index == NULL)
+	{
+		fprintf(stderr, "Cannot open %s\n", recording_path);
+		return 1;
+	}
+	double open_s = now_s() - start;
+	printf("%u frames, record %u B, dump %.1f MB, recording %.1f MB\n", frames, recording.header->record_size,
+		   ftell(dump) / 1e6, recording.size / 1e6);
+	printf("write     %8.1f MB/s, Ta and Vdd per frame included\n", recording.size / 1e6 / write_s);
+	printf("open      %8.1f us\n", open_s * 1e6);
+
+	// Frame k, checked against its sequence number
+	uint64_t state = 88172645463325252ull;
+	uint32_t errors = 0;
+	start = now_s();
+	for (int n = 0; n < LOOKUPS; n++)
+	{
+		uint64_t frame = random_next(&state) % frames;
+		errors += (mlx_recording_frame(&recording, frame)->sequence != frame);
+	}
+	printf("frame k   %8.1f ns\n", (now_s() - start) / LOOKUPS * 1e9);
+
+	// Time t, the frame at t must be found exactly
+	start = now_s();
+	for (int n = 0; n < LOOKUPS; n++)
+	{
+		uint64_t frame = random_next(&state) % frames;
+		errors += (mlx_recording_find_time(&recording, frame * SUBPAGE_US) != (int64_t)frame);
+	}
+	printf("time t    %8.1f ns with the index\n", (now_s() - start) / LOOKUPS * 1e9);
+	const int64_t *index = recording.index;
+	recording.index = NULL;
+	start = now_s();
+	for (int n = 0; n < LOOKUPS; n++)
+	{
+		uint64_t frame = random_next(&state) % frames;
+		errors += (mlx_recording_find_time(&recording, frame * SUBPAGE_US) != (int64_t)frame);
+	}
+	printf("time t    %8.1f ns through the records\n", (now_s() - start) / LOOKUPS * 1e9);
+	recording.index = index;
+
+	start = now_s();
+	for (int n = 0; n < DUMP_SEEKS; n++)
+	{
+		uint64_t frame = random_next(&state) % frames;
+		errors += (dump_seek(dump, frame * SUBPAGE_US) != (int64_t)frame);
+	}
+	printf("time t    %8.1f us scanning the dump\n", (now_s() - start) / DUMP_SEEKS * 1e6);
+	printf("%u lookup errors\n", errors);
+
+	mlx_recording_close(&recording);
+	fclose(dump);
+	remove(dump_path);
+	remove(recording_path);
+	return (errors == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Conversion state, the writer opens with the first EEPROM
+ */
+typedef struct Convert_type
+{
+	const char *path;
+	MlxRecordingWriter_type writer;
+	int open; // 0 before the first EEPROM, 1 recording, -1 failed
+	uint32_t frames;
+	uint32_t dropped;
+} Convert_type;
+
+static void convert_packet(void *context, const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	Convert_type *convert = (Convert_type *)context;
+	uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+
+	if (header->type == MLX_PACKET_EEPROM && header->payload_length == sizeof(eeprom))
+	{
+		memcpy(eeprom, payload, sizeof(eeprom));
+		if (convert->open == 0)
+		{
+			convert->open = (mlx_recording_writer_open(&convert->writer, convert->path, MLX_PIXEL_RAW, eeprom) == 0) ? 1 : -1;
+		}
+		else if (convert->open == 1 && memcmp(eeprom, convert->writer.header.eeprom, sizeof(eeprom)) != 0)
+		{
+			// Another sensor, its frames need their own recording
+			convert->open = 2;
+		}
+		return;
+	}
+	if (header->type != MLX_PACKET_FRAME || header->pixel_format != MLX_PIXEL_RAW)
+	{
+		return;
+	}
+	if (convert->open == 1 && mlx_recording_writer_append(&convert->writer, header, payload, header->timestamp_us) == 0)
+	{
+		convert->frames++;
+	}
+	else
+	{
+		convert->dropped++;
+	}
+}
+
+static int convert(const char *stream_path, const char *recording_path)
+{
+	static PacketReader_type reader;
+	static uint8_t chunk[64 * 1024];
+	Convert_type state = {.path = recording_path};
+	size_t size;
+
+	FILE *stream = fopen(stream_path, "rb");
+	if (stream == NULL)
+	{
+		perror(stream_path);
+		return 1;
+	}
+	packet_reader_init(&reader, convert_packet, &state);
+	while ((size = fread(chunk, 1, sizeof(chunk), stream)) > 0)
+	{
+		packet_reader_feed(&reader, chunk, size);
+	}
+	fclose(stream);
+	if (state.open == 0 || state.open == -1)
+	{
+		fprintf(stderr, "%s: no valid EEPROM packet, nothing converted\n", stream_path);
+		return 1;
+	}
+	int result = mlx_recording_writer_close(&state.writer);
+	printf("%s: %u frames, %u dropped, %u crc errors\n", recording_path, state.frames, state.dropped, reader.crc_errors);
+	return (result == 0) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+	{
+		return bench((argc > 2) ? strtoul(argv[2], NULL, 10) : DEFAULT_FRAMES, (argc > 3) ? argv[3] : "/tmp");
+	}
+	if (argc >= 4 && strcmp(argv[1], "convert") == 0)
+	{
+		return convert(argv[2], argv[3]);
+	}
+	fprintf(stderr, "Usage: %s bench [frames] [directory]\n"
+					"       %s convert stream.bin recording.mlxr\n",
+			argv[0], argv[0]);
+	return 1;
+}
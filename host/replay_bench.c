@@ -0,0 +1,380 @@
+/**
+ * Acquisition pipeline benchmark on a recorded I2C trace
+ *
+ * run replays a trace (mlx_i2c_replay.h) through the path of task_mlx_get_subpages to the link:
+ * MLX90640_GetFrameData, then in raw mode the MLX_PIXEL_RAW packet, in full mode MLX90640_CalculateTo and
+ * bad pixel correction of both subpages, the merge and the float32 frame packet. The FreeRTOS hand-offs
+ * between the tasks are left out. Every run starts from the same trace, so fast runs must give the same
+ * packet stream: its CRC is printed per run.
+ *
+ * synth writes a trace of the synthetic sensor at MLX_REFRESH_RATE as the raw output mode reads it:
+ * status polls until the data is ready, status reset, pixel, aux and control reads, timed at I2C_FREQ_HZ.
+ * extract takes the trace out of a device stream recorded with MLX TRACE ON.
+ *
+ * Usage:
+ *   replay_bench synth trace.bin [subpages]
+ *   replay_bench extract stream.bin trace.bin
+ *   replay_bench run trace.bin [raw|full] [fast|realtime] [runs] [output stream]
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "constants.h"
+#include "mlx90640_api.h"
+#include "mlx_i2c_replay.h"
+#include "mlx_synthetic.h"
+#include "packet_reader.h"
+
+#define DEFAULT_SUBPAGES 1000
+#define DEFAULT_RUNS 5
+#define SYNTHETIC_REFRESH MLX_REFRESH_RATE
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Duration of a transaction of bytes on the bus, 9 clocks per byte
+ */
+static uint32_t i2c_us(uint32_t bytes)
+{
+	return (uint32_t)(((uint64_t)bytes * 9 * 1000000 + I2C_FREQ_HZ - 1) / I2C_FREQ_HZ);
+}
+
+typedef struct TraceWriter_type
+{
+	FILE *file;
+	MlxI2cTraceChunk_type chunk;
+	uint32_t time_us;
+	uint64_t entries;
+} TraceWriter_type;
+
+static int trace_flush(TraceWriter_type *writer)
+{
+	size_t size = writer->chunk.size;
+	writer->chunk.size = 0;
+	return (fwrite(writer->chunk.data, 1, size, writer->file) == size) ? 0 : -1;
+}
+
+/**
+ * @brief Append a transaction that completes after the bus time of its bytes
+ */
+static int trace_write(TraceWriter_type *writer, uint8_t op, uint16_t address, uint16_t count, const uint16_t *words)
+{
+	// Device address, register address, device address again for reads, 2 bytes per word
+	writer->time_us += i2c_us((op == MLX_I2C_TRACE_READ) ? 4 + 2 * count : 3 + 2 * count);
+	MlxI2cTraceEntry_type entry = {.time_us = writer->time_us, .op = op, .address = address, .count = count};
+	if (mlx_i2c_trace_append(&writer->chunk, &entry, words) != 0)
+	{
+		if (trace_flush(writer) != 0)
+		{
+			return -1;
+		}
+		mlx_i2c_trace_append(&writer->chunk, &entry, words);
+	}
+	writer->entries++;
+	return 0;
+}
+
+static int synth(const char *path, uint32_t subpages)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static MlxCalibration_type calibration;
+	static uint16_t raw[MLX_PACKET_RAW_WORDS];
+	static float scene[MLX90640_PIXEL_NUM];
+	static TraceWriter_type writer;
+
+	writer.file = fopen(path, "wb");
+	if (writer.file == NULL)
+	{
+		perror(path);
+		return 1;
+	}
+	mlx_synthetic_eeprom(eeprom);
+	mlx_calibration_init(&calibration, eeprom);
+	int error = trace_write(&writer, MLX_I2C_TRACE_READ, MLX90640_EEPROM_START_ADDRESS, MLX90640_EEPROM_DUMP_NUM, eeprom);
+
+	uint32_t period_us = MLX_REFRESH_MILLIS_LUT[SYNTHETIC_REFRESH] * 1000;
+	uint32_t ready_us = period_us;
+	for (uint32_t n = 0; n < subpages && error == 0; n++)
+	{
+		uint16_t subpage = n % 2;
+		mlx_synthetic_scene(scene, n / 2);
+		mlx_synthetic_subpage(&calibration, scene, 1, subpage, raw);
+		raw[832] |= SYNTHETIC_REFRESH << MLX90640_CTRL_REFRESH_SHIFT;
+
+		// Poll the status register until the subpage is ready
+		uint16_t status;
+		do
+		{
+			bool ready = writer.time_us + i2c_us(6) >= ready_us;
+			status = MLX90640_INIT_STATUS_VALUE | (ready ? MLX90640_STAT_DATA_READY_MASK | subpage : 1u - subpage);
+			error |= trace_write(&writer, MLX_I2C_TRACE_READ, MLX90640_STATUS_REG, 1, &status);
+		} while (!MLX90640_GET_DATA_READY(status));
+		uint16_t reset = MLX90640_INIT_STATUS_VALUE;
+		error |= trace_write(&writer, MLX_I2C_TRACE_WRITE, MLX90640_STATUS_REG, 1, &reset);
+		error |= trace_write(&writer, MLX_I2C_TRACE_READ, MLX90640_PIXEL_DATA_START_ADDRESS, MLX90640_PIXEL_NUM, raw);
+		error |= trace_write(&writer, MLX_I2C_TRACE_READ, MLX90640_AUX_DATA_START_ADDRESS, MLX90640_AUX_NUM, &raw[MLX90640_PIXEL_NUM]);
+		error |= trace_write(&writer, MLX_I2C_TRACE_READ, MLX90640_CTRL_REG, 1, &raw[832]);
+		ready_us += period_us;
+	}
+	error |= trace_flush(&writer);
+	long size = ftell(writer.file);
+	if (fclose(writer.file) != 0 || error != 0)
+	{
+		perror(path);
+		return 1;
+	}
+	printf("%s: %u subpages, %llu transactions, %.1f MB, %.1f s of sensor time\n", path, subpages,
+		   (unsigned long long)writer.entries, size / 1e6, writer.time_us / 1e6);
+	return 0;
+}
+
+static void extract_packet(void *context, const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	if (header->type == MLX_PACKET_I2C_TRACE)
+	{
+		fwrite(payload, 1, header->payload_length, (FILE *)context);
+	}
+}
+
+static int extract(const char *stream_path, const char *trace_path)
+{
+	static PacketReader_type reader;
+	static uint8_t chunk[64 * 1024];
+	size_t size;
+
+	FILE *stream = fopen(stream_path, "rb");
+	if (stream == NULL)
+	{
+		perror(stream_path);
+		return 1;
+	}
+	FILE *trace = fopen(trace_path, "wb");
+	if (trace == NULL)
+	{
+		perror(trace_path);
+		fclose(stream);
+		return 1;
+	}
+	packet_reader_init(&reader, extract_packet, trace);
+	while ((size = fread(chunk, 1, sizeof(chunk), stream)) > 0)
+	{
+		packet_reader_feed(&reader, chunk, size);
+	}
+	fclose(stream);
+	long trace_size = ftell(trace);
+	if (fclose(trace) != 0)
+	{
+		perror(trace_path);
+		return 1;
+	}
+	printf("%s: %.1f kB of trace, %u crc errors\n", trace_path, trace_size / 1e3, reader.crc_errors);
+	return 0;
+}
+
+/**
+ * @brief Link of the benchmark: the CRC of everything written, optionally a copy in a file
+ */
+typedef struct BenchLink_type
+{
+	uint32_t crc;
+	uint64_t bytes;
+	FILE *file;
+} BenchLink_type;
+
+static int bench_link_write(void *context, const void *data, size_t size)
+{
+	BenchLink_type *link = (BenchLink_type *)context;
+	link->crc = mlx_crc32(link->crc, data, size);
+	link->bytes += size;
+	if (link->file != NULL && fwrite(data, 1, size, link->file) != size)
+	{
+		return -1;
+	}
+	return size;
+}
+
+typedef struct RunStats_type
+{
+	uint32_t subpages;
+	uint32_t frames;
+	uint32_t failed; // recorded failures of MLX90640_GetFrameData
+	double acquire_s;
+	double compute_s;
+	double send_s;
+} RunStats_type;
+
+/**
+ * @brief Calculate the pixels of one subpage as mlx_calculate_subpage_temps does
+ */
+static void subpage_temps(uint16_t *raw, paramsMLX90640 *params, float *temps)
+{
+	float ta = MLX90640_GetTa(raw, params) + MLX_TA_OFFSET;
+	MLX90640_CalculateTo(raw, params, MLX_EMISSIVITY, ta, temps);
+	int mode = (raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
+	MLX90640_BadPixelsCorrection(params->brokenPixels, temps, mode, params);
+	MLX90640_BadPixelsCorrection(params->outlierPixels, temps, mode, params);
+}
+
+static int run_once(const MlxI2cReplay_type *replay, int full, const Transport_type *link, RunStats_type *stats)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static paramsMLX90640 params;
+	static uint16_t raw[MLX_PACKET_RAW_WORDS];
+	static float temps[2][MLX90640_PIXEL_NUM];
+	static float frame[MLX90640_PIXEL_NUM];
+	MlxPacketHeader_type header;
+	TickType_t last_wake_time = 0;
+	bool have_subpage_0 = false;
+	uint32_t sequence = 0;
+
+	memset(stats, 0, sizeof(RunStats_type));
+	if (MLX90640_DumpEE(MLX90640_SLAVE_ADR, eeprom) != 0 || MLX90640_ExtractParameters(eeprom, &params) != MLX90640_NO_ERROR)
+	{
+		fprintf(stderr, "The trace does not start with a valid EEPROM read\n");
+		return -1;
+	}
+
+	while (1)
+	{
+		double start = now_s();
+		int subpage = MLX90640_GetFrameData(MLX90640_SLAVE_ADR, raw, &last_wake_time);
+		double acquired = now_s();
+		stats->acquire_s += acquired - start;
+		if (subpage < 0)
+		{
+			if (replay->offset >= replay->size)
+			{
+				break;
+			}
+			stats->failed++;
+			continue;
+		}
+		stats->subpages++;
+
+		if (!full)
+		{
+			mlx_packet_header_init(&header, MLX_PACKET_FRAME, sequence++, esp_timer_get_time(), sizeof(raw));
+			header.pixel_format = MLX_PIXEL_RAW;
+			header.subpage = subpage;
+			mlx_packet_write(link, &header, (const uint8_t *)raw);
+			stats->frames++;
+			stats->send_s += now_s() - acquired;
+			continue;
+		}
+
+		// Full frames start with subpage 0, a second subpage 0 restarts the frame
+		if (subpage == 0)
+		{
+			memset(temps, 0, sizeof(temps));
+			have_subpage_0 = true;
+		}
+		else if (!have_subpage_0)
+		{
+			continue;
+		}
+		subpage_temps(raw, &params, temps[subpage]);
+		double computed = now_s();
+		stats->compute_s += computed - acquired;
+		if (subpage == 1)
+		{
+			for (int i = 0; i < MLX90640_PIXEL_NUM; i++)
+			{
+				frame[i] = temps[0][i] + temps[1][i];
+			}
+			mlx_packet_header_init(&header, MLX_PACKET_FRAME, sequence++, esp_timer_get_time(), sizeof(frame));
+			header.pixel_format = MLX_PIXEL_FLOAT32;
+			header.subpage = MLX_SUBPAGE_FULL_FRAME;
+			header.ta = MLX90640_GetTa(raw, &params);
+			header.scale = 1;
+			mlx_packet_write(link, &header, (const uint8_t *)frame);
+			stats->frames++;
+			have_subpage_0 = false;
+			stats->send_s += now_s() - computed;
+		}
+	}
+	return 0;
+}
+
+static int run(const char *path, int full, int speed, int runs, const char *output_path)
+{
+	MlxI2cReplay_type replay;
+	if (mlx_i2c_replay_load(&replay, path, speed) != 0)
+	{
+		fprintf(stderr, "Cannot read %s\n", path);
+		return 1;
+	}
+	printf("%s: %.1f MB, %s path, %s\n", path, replay.size / 1e6, full ? "full frame" : "raw",
+		   (speed == MLX_I2C_REPLAY_FAST) ? "as fast as possible" : "at the recorded speed");
+	printf("run  subpages  frames  failed     wall ms  subpages/s  acquire us  compute us  send us  skipped  late us  stream crc\n");
+
+	uint32_t first_crc = 0;
+	int differing = 0;
+	for (int n = 0; n < runs; n++)
+	{
+		BenchLink_type link_state = {.file = (n == 0 && output_path != NULL) ? fopen(output_path, "wb") : NULL};
+		Transport_type link = {.name = "bench", .write = bench_link_write, .context = &link_state};
+		RunStats_type stats;
+
+		mlx_i2c_replay_attach(&replay);
+		double start = now_s();
+		int error = run_once(&replay, full, &link, &stats);
+		double wall_s = now_s() - start;
+		mlx_i2c_replay_attach(NULL);
+		if (link_state.file != NULL)
+		{
+			fclose(link_state.file);
+		}
+		if (error != 0)
+		{
+			mlx_i2c_replay_free(&replay);
+			return 1;
+		}
+
+		uint32_t count = (stats.subpages > 0) ? stats.subpages : 1;
+		printf("%3d %9u %7u %7u %11.1f %11.0f %11.2f %11.2f %8.2f %8llu %8lld  %08x\n", n, stats.subpages, stats.frames,
+			   stats.failed, wall_s * 1e3, stats.subpages / wall_s, stats.acquire_s / count * 1e6,
+			   stats.compute_s / count * 1e6, stats.send_s / count * 1e6, (unsigned long long)replay.skipped,
+			   (long long)replay.max_late_us, link_state.crc);
+		first_crc = (n == 0) ? link_state.crc : first_crc;
+		differing += (link_state.crc != first_crc);
+	}
+	if (replay.gaps > 0)
+	{
+		printf("%llu transactions were dropped while recording\n", (unsigned long long)replay.gaps);
+	}
+	printf("%d of %d runs gave a different stream\n", differing, runs);
+	mlx_i2c_replay_free(&replay);
+	return (speed == MLX_I2C_REPLAY_FAST && differing > 0) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "synth") == 0)
+	{
+		return synth(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 10) : DEFAULT_SUBPAGES);
+	}
+	if (argc >= 4 && strcmp(argv[1], "extract") == 0)
+	{
+		return extract(argv[2], argv[3]);
+	}
+	if (argc >= 3 && strcmp(argv[1], "run") == 0)
+	{
+		int full = (argc > 3 && strcmp(argv[3], "full") == 0);
+		int speed = (argc > 4 && strcmp(argv[4], "realtime") == 0) ? MLX_I2C_REPLAY_REALTIME : MLX_I2C_REPLAY_FAST;
+		int runs = (argc > 5) ? atoi(argv[5]) : (speed == MLX_I2C_REPLAY_FAST) ? DEFAULT_RUNS : 1;
+		return run(argv[2], full, speed, (runs > 0) ? runs : 1, (argc > 6) ? argv[6] : NULL);
+	}
+	fprintf(stderr, "Usage: %s synth trace.bin [subpages]\n"
+					"       %s extract stream.bin trace.bin\n"
+					"       %s run trace.bin [raw|full] [fast|realtime] [runs] [output stream]\n",
+			argv[0], argv[0], argv[0]);
+	return 1;
+}
@@ -0,0 +1,283 @@
+/**
+ * Synthetic raw frames of known temperature maps
+ *
+ * fixture writes a raw packet stream (MLX SET OUT RAW) that measures the given temperature maps: the EEPROM
+ * packet, then both subpages of every frame made with mlx_synthetic_raw. The maps are raw little-endian
+ * float32 frames, the batch_reprocess and frame_codec_bench format, frame k uses map k modulo their number.
+ * Without maps the moving spot of mlx_synthetic_scene is used. The stream is read by batch_reprocess,
+ * recording_bench convert and the receivers; converted with MLX_EMISSIVITY and MLX_TA_OFFSET it gives
+ * back the maps.
+ *
+ * check converts maps from -40 to 300 °C at several Ta, Vdd, emissivities and both patterns back with
+ * MLX90640_CalculateTo and mlx_calibration_convert and fails if any pixel is off by more than
+ * MLX_SYNTHETIC_TOLERANCE.
+ *
+ * Usage:
+ *   scene_synth fixture eeprom|- maps.f32|- stream.bin [frames] [Ta] [Vdd]
+ *   scene_synth check [eeprom|-]
+ */
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "mlx_protocol.h"
+#include "mlx_synthetic.h"
+#include "transport_fd.h"
+
+#define DEFAULT_FRAMES 1000
+#define SUBPAGE_US 15625 /*!< 64 Hz subpage period*/
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static float *maps_load(const char *path, uint32_t *count)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	rewind(file);
+	*count = size / (MLX90640_PIXEL_NUM * sizeof(float));
+	float *maps = (*count > 0) ? malloc(*count * MLX90640_PIXEL_NUM * sizeof(float)) : NULL;
+	if (maps != NULL && fread(maps, MLX90640_PIXEL_NUM * sizeof(float), *count, file) != *count)
+	{
+		free(maps);
+		maps = NULL;
+	}
+	fclose(file);
+	return maps;
+}
+
+static int fixture(const char *eeprom_path, const char *maps_path, const char *path, uint32_t frames, float ta, float vdd)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static paramsMLX90640 params;
+	static uint16_t raw[MLX_PACKET_RAW_WORDS];
+	static float scene[MLX90640_PIXEL_NUM];
+	Transport_type transport;
+	TransportFd_type backend;
+	MlxPacketHeader_type header;
+	uint32_t map_count = 0;
+	float *maps = NULL;
+
+	if (mlx_synthetic_load_eeprom(eeprom_path, eeprom) != 0 || MLX90640_ExtractParameters(eeprom, &params) != MLX90640_NO_ERROR)
+	{
+		fprintf(stderr, "Cannot use the EEPROM %s\n", eeprom_path);
+		return 1;
+	}
+	if (strcmp(maps_path, "-") != 0 && (maps = maps_load(maps_path, &map_count)) == NULL)
+	{
+		fprintf(stderr, "Cannot read float32 frames from %s\n", maps_path);
+		return 1;
+	}
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+	{
+		perror(path);
+		free(maps);
+		return 1;
+	}
+	transport_fd_init(&transport, &backend, fd, "fixture");
+	mlx_packet_header_init(&header, MLX_PACKET_EEPROM, 0, 0, sizeof(eeprom));
+	mlx_packet_write(&transport, &header, (const uint8_t *)eeprom);
+
+	MlxSyntheticConditions_type conditions = {
+		.ta = ta,
+		.vdd = vdd,
+		.emissivity = MLX_EMISSIVITY,
+		.tr = ta + MLX_TA_OFFSET,
+		.chess = 1,
+	};
+	uint64_t clamped = 0;
+	int error = 0;
+	double start = now_s();
+	for (uint32_t n = 0; n < 2 * frames && error == 0; n++)
+	{
+		const float *map = scene;
+		if (maps != NULL)
+		{
+			map = &maps[(n / 2) % map_count * MLX90640_PIXEL_NUM];
+		}
+		else
+		{
+			mlx_synthetic_scene(scene, n / 2);
+		}
+		int result = mlx_synthetic_raw(&params, &conditions, map, n % 2, raw);
+		if (result < 0)
+		{
+			fprintf(stderr, "Ta %.2f or Vdd %.2f cannot be encoded with this EEPROM\n", ta, vdd);
+			error = 1;
+			break;
+		}
+		clamped += result;
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, n, (uint64_t)n * SUBPAGE_US, sizeof(raw));
+		header.pixel_format = MLX_PIXEL_RAW;
+		header.subpage = n % 2;
+		if (mlx_packet_write(&transport, &header, (const uint8_t *)raw) != 0)
+		{
+			perror(path);
+			error = 1;
+		}
+	}
+	double elapsed = now_s() - start;
+	close(fd);
+	free(maps);
+	if (error != 0)
+	{
+		return 1;
+	}
+	printf("%s: %u frames of %s at Ta %.2f Vdd %.2f, %.1f us per subpage, %llu pixels clamped\n", path, frames,
+		   (map_count > 0) ? maps_path : "the synthetic scene", ta, vdd, elapsed / (2 * frames) * 1e6, (unsigned long long)clamped);
+	return 0;
+}
+
+static int bad_pixel(const paramsMLX90640 *params, int pixel)
+{
+	for (int i = 0; i < 5; i++)
+	{
+		if (params->brokenPixels[i] == pixel || params->outlierPixels[i] == pixel)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int check(const char *eeprom_path)
+{
+	static uint16_t eeprom[MLX90640_EEPROM_DUMP_NUM];
+	static MlxCalibration_type calibration;
+	static uint16_t raw[MLX_PACKET_RAW_WORDS];
+	static float maps[9][MLX90640_PIXEL_NUM];
+	static float reference[MLX90640_PIXEL_NUM];
+	static float prepared[MLX90640_PIXEL_NUM];
+	const float uniform[] = {-40, 0, 25, 100, 200, 300};
+	const float tas[] = {0, 25, 30, 60};
+	const float vdds[] = {3.0f, 3.3f, 3.6f};
+	const float emissivities[] = {1.0f, 0.95f};
+	paramsMLX90640 *params = &calibration.params;
+
+	if (mlx_synthetic_load_eeprom(eeprom_path, eeprom) != 0 || mlx_calibration_init(&calibration, eeprom) != 0)
+	{
+		fprintf(stderr, "Cannot use the EEPROM %s\n", eeprom_path);
+		return 1;
+	}
+	// Uniform maps, the test scene and random pixels over the whole range
+	uint32_t state = 2463534242u;
+	for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+	{
+		for (size_t m = 0; m < sizeof(uniform) / sizeof(uniform[0]); m++)
+		{
+			maps[m][pixel] = uniform[m];
+		}
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		maps[7][pixel] = -40 + 340 * (state / 4294967296.0f);
+		maps[8][pixel] = -40 + 340 * (pixel / 767.0f);
+	}
+	mlx_synthetic_scene(maps[6], 0);
+
+	printf("   Ta   Vdd  emissivity  pattern   max error CalculateTo   max error prepared   Ta error   Vdd error\n");
+	float worst = 0;
+	uint64_t clamped = 0;
+	uint32_t subpages = 0;
+	double raw_s = 0;
+	for (size_t t = 0; t < sizeof(tas) / sizeof(tas[0]); t++)
+	{
+		for (size_t v = 0; v < sizeof(vdds) / sizeof(vdds[0]); v++)
+		{
+			for (size_t e = 0; e < sizeof(emissivities) / sizeof(emissivities[0]); e++)
+			{
+				for (uint8_t chess = 0; chess < 2; chess++)
+				{
+					MlxSyntheticConditions_type conditions = {
+						.ta = tas[t],
+						.vdd = vdds[v],
+						.emissivity = emissivities[e],
+						.tr = tas[t] + MLX_TA_OFFSET,
+						.chess = chess,
+					};
+					calibration.emissivity = conditions.emissivity;
+					calibration.ambient_offset = MLX_TA_OFFSET;
+					float error_reference = 0;
+					float error_prepared = 0;
+					float error_ta = 0;
+					float error_vdd = 0;
+					for (size_t m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+					{
+						for (uint8_t subpage = 0; subpage < 2; subpage++)
+						{
+							double start = now_s();
+							int result = mlx_synthetic_raw(params, &conditions, maps[m], subpage, raw);
+							raw_s += now_s() - start;
+							subpages++;
+							if (result < 0)
+							{
+								fprintf(stderr, "Ta %.2f or Vdd %.2f cannot be encoded with this EEPROM\n", conditions.ta, conditions.vdd);
+								return 1;
+							}
+							clamped += result;
+							float ta = MLX90640_GetTa(raw, params);
+							error_ta = fmaxf(error_ta, fabsf(ta - conditions.ta));
+							error_vdd = fmaxf(error_vdd, fabsf(MLX90640_GetVdd(raw, params) - conditions.vdd));
+
+							// The firmware math, Ta + offset reflected as mlx_calculate_subpage_temps does
+							memset(reference, 0, sizeof(reference));
+							MLX90640_CalculateTo(raw, params, conditions.emissivity, ta + MLX_TA_OFFSET, reference);
+							mlx_calibration_convert(&calibration, raw, prepared, &ta);
+							int mode = chess;
+							for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+							{
+								int il_pattern = pixel / 32 - (pixel / 64) * 2;
+								int pattern = mode ? il_pattern ^ (pixel % 2) : il_pattern;
+								if (pattern != subpage || bad_pixel(params, pixel))
+								{
+									continue;
+								}
+								error_reference = fmaxf(error_reference, fabsf(reference[pixel] - maps[m][pixel]));
+								error_prepared = fmaxf(error_prepared, fabsf(prepared[pixel] - maps[m][pixel]));
+							}
+						}
+					}
+					printf("%5.1f %5.2f %11.2f %8s %23.4f %20.4f %10.4f %11.4f\n", conditions.ta, conditions.vdd, conditions.emissivity,
+						   chess ? "chess" : "il", error_reference, error_prepared, error_ta, error_vdd);
+					worst = fmaxf(worst, fmaxf(error_reference, error_prepared));
+				}
+			}
+		}
+	}
+	int passed = (worst <= MLX_SYNTHETIC_TOLERANCE && clamped == 0);
+	printf("%u subpages, %.1f us per subpage, %llu pixels clamped, max error %.4f °C: %s (tolerance %.2f °C)\n", subpages,
+		   raw_s / subpages * 1e6, (unsigned long long)clamped, worst, passed ? "PASS" : "FAIL", MLX_SYNTHETIC_TOLERANCE);
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 5 && strcmp(argv[1], "fixture") == 0)
+	{
+		return fixture(argv[2], argv[3], argv[4], (argc > 5) ? strtoul(argv[5], NULL, 10) : DEFAULT_FRAMES,
+					   (argc > 6) ? strtof(argv[6], NULL) : MLX_SYNTHETIC_TA, (argc > 7) ? strtof(argv[7], NULL) : 3.3f);
+	}
+	if (argc >= 2 && strcmp(argv[1], "check") == 0)
+	{
+		return check((argc > 2) ? argv[2] : "-");
+	}
+	fprintf(stderr, "Usage: %s fixture eeprom|- maps.f32|- stream.bin [frames] [Ta] [Vdd]\n"
+					"       %s check [eeprom|-]\n",
+			argv[0], argv[0]);
+	return 1;
+}
@@ -0,0 +1,336 @@
+/**
+ * Socket frame stream server, client and loopback benchmark
+ *
+ * The server streams the packets task_mlx_uart_frame_data sends, over TCP or as one UDP datagram per
+ * packet, one frame per MLX START credit like the firmware, so it also stands in for a device. The
+ * client starts the stream with ++*MLX START N*++, checks every packet and reports
+ * throughput, lost packets and latency from the header timestamp (same machine clock only).
+ *
+ * Usage:
+ *   socket_bench loopback [tcp|udp] [F32|F16|I16|U8] [frames] [fps]
+ *   socket_bench server [tcp|udp] [port] [F32|F16|I16|U8] [fps]
+ *   socket_bench client [tcp|udp] [address] [port] [frames]
+ *
+ * fps 0 streams as fast as the link accepts.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "transport_socket.h"
+#include "packet_reader.h"
+#include "pixel_encoding.h"
+
+#define PIXELS 768
+#define DEFAULT_PORT 9640
+#define DEFAULT_FRAMES 20000
+#define IDLE_TIMEOUT_MS 1000
+#define MAX_CREDITS 65535 /*!< Same limit as frame_credits on the device*/
+
+typedef struct BenchServer_type
+{
+	int listen_fd;
+	uint8_t mode;
+	uint8_t pixel_format;
+	uint32_t fps;
+} BenchServer_type;
+
+typedef struct BenchClient_type
+{
+	uint32_t expected;
+	uint32_t received;
+	uint32_t reordered;
+	int64_t last_sequence;
+	uint32_t *latency_us;
+} BenchClient_type;
+
+static int64_t now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int parse_format(const char *name)
+{
+	const char *format_names[] = {"F32", "F16", "I16", "U8"};
+	for (int i = 0; i < 4; i++)
+	{
+		if (strcmp(name, format_names[i]) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Count the frame credits in received commands
+ *
+ * @return credits granted, -1 on MLX STOP
+ */
+static int server_commands(const char *commands)
+{
+	int credits = 0;
+	for (const char *command = strstr(commands, "++*MLX "); command != NULL; command = strstr(command + 1, "++*MLX "))
+	{
+		int count = 1;
+		if (strncmp(command, "++*MLX STOP", 11) == 0)
+		{
+			return -1;
+		}
+		if (strncmp(command, "++*MLX START", 12) == 0)
+		{
+			sscanf(command, "++*MLX START %d", &count);
+			credits += (count > 0) ? count : 0;
+		}
+	}
+	return credits;
+}
+
+/**
+ * @brief Stream frames like the firmware, one frame per MLX START credit until MLX STOP or disconnect
+ *
+ * @return number of frames sent, -1 on errors
+ */
+static int server_run(BenchServer_type *server)
+{
+	Transport_type transport;
+	TransportSocket_type backend;
+	char commands[256];
+	float temps[PIXELS];
+	static uint8_t encoded[PIXELS * 4];
+	MlxPacketHeader_type header;
+	int credits = 0;
+	int frames = 0;
+
+	if (transport_socket_accept(&transport, &backend, server->listen_fd, server->mode) != 0)
+	{
+		return -1;
+	}
+
+	int64_t period_us = (server->fps > 0) ? 1000000 / server->fps : 0;
+	int64_t next_us = now_us();
+	while (1)
+	{
+		int size = transport_read(&transport, commands, sizeof(commands) - 1, (credits > 0) ? 0 : TRANSPORT_WAIT_FOREVER);
+		if (size < 0)
+		{
+			break;
+		}
+		commands[size] = '\0';
+		int granted = (size > 0) ? server_commands(commands) : 0;
+		if (granted < 0)
+		{
+			break;
+		}
+		if (credits == 0 && granted > 0)
+		{
+			next_us = now_us();
+		}
+		credits = (credits + granted > MAX_CREDITS) ? MAX_CREDITS : credits + granted;
+		if (credits == 0)
+		{
+			continue;
+		}
+
+		if (period_us > 0)
+		{
+			while (now_us() < next_us)
+			{
+			}
+			next_us += period_us;
+		}
+		for (int i = 0; i < PIXELS; i++)
+		{
+			temps[i] = 25.0f + 5.0f * sinf(0.01f * (i + frames));
+		}
+		float offset = 0;
+		float scale = 1;
+		size_t payload_size = PIXELS * 4;
+		const uint8_t *payload = (const uint8_t *)temps;
+		if (server->pixel_format != MLX_PIXEL_FLOAT32)
+		{
+			payload_size = pixel_encode(temps, PIXELS, server->pixel_format, encoded, &offset, &scale);
+			payload = encoded;
+		}
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, frames, now_us(), payload_size);
+		header.pixel_format = server->pixel_format;
+		header.offset = offset;
+		header.scale = scale;
+		if (mlx_packet_write(&transport, &header, payload) != 0)
+		{
+			fprintf(stderr, "server: write failed after %d frames\n", frames);
+			break;
+		}
+		credits--;
+		frames++;
+	}
+	if (server->mode == TRANSPORT_SOCKET_TCP)
+	{
+		transport_socket_close(&backend);
+	}
+	return frames;
+}
+
+static void *server_thread(void *params)
+{
+	server_run((BenchServer_type *)params);
+	return NULL;
+}
+
+static void client_packet(void *context, const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	BenchClient_type *client = (BenchClient_type *)context;
+	(void)payload;
+	if (header->type != MLX_PACKET_FRAME)
+	{
+		return;
+	}
+	if ((int64_t)header->sequence < client->last_sequence)
+	{
+		client->reordered++;
+	}
+	client->last_sequence = header->sequence;
+	if (client->received < client->expected)
+	{
+		client->latency_us[client->received] = (uint32_t)(now_us() - (int64_t)header->timestamp_us);
+	}
+	client->received++;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Request frames and receive them until all arrived or the link is idle
+ *
+ * @return 0 all frames received
+ * @return 1 frames lost
+ * @return -1 connection failed
+ */
+static int client_run(uint8_t mode, const char *address, uint16_t port, uint32_t frames)
+{
+	Transport_type transport;
+	TransportSocket_type backend;
+	static PacketReader_type reader;
+	BenchClient_type client = {.expected = frames, .last_sequence = -1};
+	char command[64];
+
+	if (transport_socket_connect(&transport, &backend, mode, address, port) != 0)
+	{
+		fprintf(stderr, "client: failed to connect to %s:%u\n", address, port);
+		return -1;
+	}
+	client.latency_us = calloc(frames, sizeof(uint32_t));
+	packet_reader_init(&reader, client_packet, &client);
+
+	int command_size = snprintf(command, sizeof(command), "++*MLX START %lu*++", (unsigned long)frames);
+	int64_t start = now_us();
+	transport_write(&transport, command, command_size);
+	transport_flush(&transport);
+
+	int64_t last_rx = now_us();
+	while (client.received < frames)
+	{
+		int packets = packet_reader_read(&reader, &transport, IDLE_TIMEOUT_MS);
+		if (packets < 0 || (packets == 0 && now_us() - last_rx > IDLE_TIMEOUT_MS * 1000))
+		{
+			break;
+		}
+		if (packets > 0)
+		{
+			last_rx = now_us();
+		}
+	}
+	double elapsed = (last_rx - start) / 1e6;
+	command_size = snprintf(command, sizeof(command), "++*MLX STOP*++");
+	transport_write(&transport, command, command_size);
+	transport_flush(&transport);
+	transport_socket_close(&backend);
+
+	uint32_t measured = (client.received < frames) ? client.received : frames;
+	qsort(client.latency_us, measured, sizeof(uint32_t), compare_u32);
+	printf("link              %s %s:%u\n", transport.name, address, port);
+	printf("frames            %lu of %lu, lost %lu, reordered %lu, crc errors %lu\n",
+		   (unsigned long)client.received, (unsigned long)frames, (unsigned long)(frames - measured),
+		   (unsigned long)client.reordered, (unsigned long)reader.crc_errors);
+	printf("throughput        %.1f MB/s, %.0f frames/s\n", reader.bytes / elapsed / 1e6, client.received / elapsed);
+	if (measured > 0)
+	{
+		printf("latency           p50 %lu us, p99 %lu us, max %lu us\n",
+			   (unsigned long)client.latency_us[measured / 2],
+			   (unsigned long)client.latency_us[(uint32_t)(measured * 0.99)],
+			   (unsigned long)client.latency_us[measured - 1]);
+	}
+	free(client.latency_us);
+	return (client.received == frames && reader.crc_errors == 0) ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *command = (argc > 1) ? argv[1] : "loopback";
+	uint8_t mode = (argc > 2 && strcmp(argv[2], "udp") == 0) ? TRANSPORT_SOCKET_UDP : TRANSPORT_SOCKET_TCP;
+
+	if (strcmp(command, "server") == 0)
+	{
+		BenchServer_type server = {.mode = mode};
+		int format = parse_format((argc > 4) ? argv[4] : "F32");
+		server.pixel_format = (format < 0) ? MLX_PIXEL_FLOAT32 : format;
+		server.fps = (argc > 5) ? atoi(argv[5]) : 0;
+		server.listen_fd = transport_socket_listen(mode, "0.0.0.0", (argc > 3) ? atoi(argv[3]) : DEFAULT_PORT);
+		if (server.listen_fd < 0)
+		{
+			perror("listen");
+			return 1;
+		}
+		while (1)
+		{
+			printf("sent %d frames\n", server_run(&server));
+		}
+	}
+	if (strcmp(command, "client") == 0)
+	{
+		const char *address = (argc > 3) ? argv[3] : "127.0.0.1";
+		uint16_t port = (argc > 4) ? atoi(argv[4]) : DEFAULT_PORT;
+		uint32_t frames = (argc > 5) ? atoi(argv[5]) : DEFAULT_FRAMES;
+		return (client_run(mode, address, port, frames) == 0) ? 0 : 1;
+	}
+	if (strcmp(command, "loopback") == 0)
+	{
+		BenchServer_type server = {.mode = mode};
+		int format = parse_format((argc > 3) ? argv[3] : "F32");
+		uint32_t frames = (argc > 4) ? atoi(argv[4]) : DEFAULT_FRAMES;
+		server.pixel_format = (format < 0) ? MLX_PIXEL_FLOAT32 : format;
+		server.fps = (argc > 5) ? atoi(argv[5]) : 0;
+		server.listen_fd = transport_socket_listen(mode, "127.0.0.1", 0);
+		if (server.listen_fd < 0 || frames == 0)
+		{
+			perror("listen");
+			return 1;
+		}
+		struct sockaddr_in bound;
+		socklen_t bound_size = sizeof(bound);
+		getsockname(server.listen_fd, (struct sockaddr *)&bound, &bound_size);
+
+		pthread_t thread;
+		pthread_create(&thread, NULL, server_thread, &server);
+		int result = client_run(mode, "127.0.0.1", ntohs(bound.sin_port), frames);
+		pthread_join(thread, NULL);
+		close(server.listen_fd);
+		// UDP may lose datagrams when unpaced, only TCP has to deliver everything
+		return (result < 0 || (mode == TRANSPORT_SOCKET_TCP && result != 0)) ? 1 : 0;
+	}
+	fprintf(stderr, "usage: %s loopback|server|client ...\n", argv[0]);
+	return 1;
+}
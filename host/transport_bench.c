@@ -0,0 +1,191 @@
+/**
+ * Transport throughput benchmark
+ *
+ * A device thread writes frame packets through a Transport_type with the firmware packet writer, the
+ * host side reads the stream, checks every header and CRC and reports the sustained throughput.
+ *
+ * Usage: transport_bench [socketpair|pty] [F32|F16|I16|U8] [frames]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "transport_fd.h"
+#include "mlx_protocol.h"
+#include "pixel_encoding.h"
+
+#define PIXELS 768
+#define DEFAULT_FRAMES 20000
+#define RX_BUFFER_SIZE (64 * 1024)
+#define UART_BAUD 460800
+
+typedef struct BenchDevice_type
+{
+	Transport_type transport;
+	uint8_t pixel_format;
+	int frames;
+} BenchDevice_type;
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Device side, the same packets task_mlx_uart_frame_data sends
+ */
+static void *device_thread(void *params)
+{
+	BenchDevice_type *device = (BenchDevice_type *)params;
+	float temps[PIXELS];
+	static uint8_t encoded[PIXELS * 4];
+	MlxPacketHeader_type header;
+
+	for (int n = 0; n < device->frames; n++)
+	{
+		for (int i = 0; i < PIXELS; i++)
+		{
+			temps[i] = 25.0f + 5.0f * sinf(0.01f * (i + n));
+		}
+		float offset = 0;
+		float scale = 1;
+		size_t size = PIXELS * 4;
+		const uint8_t *payload = (const uint8_t *)temps;
+		if (device->pixel_format != MLX_PIXEL_FLOAT32)
+		{
+			size = pixel_encode(temps, PIXELS, device->pixel_format, encoded, &offset, &scale);
+			payload = encoded;
+		}
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, n, (uint64_t)(now_s() * 1e6), size);
+		header.pixel_format = device->pixel_format;
+		header.offset = offset;
+		header.scale = scale;
+		if (mlx_packet_write(&device->transport, &header, payload) != 0)
+		{
+			fprintf(stderr, "device write failed\n");
+			break;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	const char *link = (argc > 1) ? argv[1] : "socketpair";
+	const char *format = (argc > 2) ? argv[2] : "F32";
+	const char *format_names[] = {"F32", "F16", "I16", "U8"};
+	BenchDevice_type device = {.pixel_format = 0xFF, .frames = (argc > 3) ? atoi(argv[3]) : DEFAULT_FRAMES};
+	TransportFd_type device_backend;
+	TransportFd_type host_backend;
+	Transport_type host;
+	int device_fd = -1;
+	int host_fd = -1;
+
+	for (uint8_t i = 0; i < sizeof(format_names) / sizeof(format_names[0]); i++)
+	{
+		if (strcmp(format, format_names[i]) == 0)
+		{
+			device.pixel_format = i;
+		}
+	}
+	if (device.pixel_format == 0xFF || device.frames <= 0)
+	{
+		fprintf(stderr, "usage: %s [socketpair|pty] [F32|F16|I16|U8] [frames]\n", argv[0]);
+		return 1;
+	}
+	if (strcmp(link, "pty") == 0)
+	{
+		if (transport_fd_openpty(&host_fd, &device_fd) != 0)
+		{
+			perror("openpty");
+			return 1;
+		}
+	}
+	else
+	{
+		int fds[2];
+		if (transport_fd_socketpair(fds) != 0)
+		{
+			perror("socketpair");
+			return 1;
+		}
+		device_fd = fds[0];
+		host_fd = fds[1];
+	}
+	transport_fd_init(&device.transport, &device_backend, device_fd, link);
+	transport_fd_init(&host, &host_backend, host_fd, link);
+
+	static uint8_t buffer[RX_BUFFER_SIZE];
+	size_t filled = 0;
+	uint64_t bytes = 0;
+	int frames = 0;
+	int crc_errors = 0;
+	int sequence_errors = 0;
+
+	pthread_t thread;
+	double start = now_s();
+	pthread_create(&thread, NULL, device_thread, &device);
+	while (frames + crc_errors < device.frames)
+	{
+		int rx_size = transport_read(&host, buffer + filled, sizeof(buffer) - filled, 1000);
+		if (rx_size <= 0)
+		{
+			fprintf(stderr, "link stalled after %d frames\n", frames);
+			break;
+		}
+		filled += rx_size;
+		bytes += rx_size;
+
+		// Parse complete packets, keep the tail
+		size_t pos = 0;
+		while (filled - pos >= sizeof(MlxPacketHeader_type))
+		{
+			MlxPacketHeader_type header;
+			memcpy(&header, buffer + pos, sizeof(header));
+			if (mlx_packet_header_validate(&header) != 0)
+			{
+				pos++; // resync on the next magic
+				continue;
+			}
+			size_t packet_size = sizeof(header) + header.payload_length + MLX_PACKET_CRC_SIZE;
+			if (filled - pos < packet_size)
+			{
+				break;
+			}
+			uint32_t crc;
+			memcpy(&crc, buffer + pos + sizeof(header) + header.payload_length, sizeof(crc));
+			if (crc != mlx_packet_crc(&header, buffer + pos + sizeof(header)))
+			{
+				crc_errors++;
+			}
+			else
+			{
+				sequence_errors += (header.sequence != (uint32_t)frames);
+				frames++;
+			}
+			pos += packet_size;
+		}
+		memmove(buffer, buffer + pos, filled - pos);
+		filled -= pos;
+	}
+	double elapsed = now_s() - start;
+	pthread_join(thread, NULL);
+
+	double packet_bytes = frames > 0 ? (double)bytes / frames : 0;
+	double uart_fps = UART_BAUD / 10.0 / packet_bytes;
+	printf("link              %s\n", link);
+	printf("format            %s (%.0f B/packet)\n", format, packet_bytes);
+	printf("frames            %d, crc errors %d, sequence errors %d\n", frames, crc_errors, sequence_errors);
+	printf("throughput        %.1f MB/s, %.0f frames/s\n", bytes / elapsed / 1e6, frames / elapsed);
+	printf("uart %d baud   %.1f frames/s\n", UART_BAUD, uart_fps);
+
+	close(device_fd);
+	close(host_fd);
+	return (frames == device.frames && crc_errors == 0 && sequence_errors == 0) ? 0 : 1;
+}
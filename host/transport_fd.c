@@ -0,0 +1,150 @@
+#define _GNU_SOURCE
+#include "transport_fd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+static int transport_fd_write(void *context, const void *data, size_t size)
+{
+	TransportFd_type *backend = (TransportFd_type *)context;
+	const uint8_t *bytes = (const uint8_t *)data;
+	size_t written = 0;
+
+	while (written < size)
+	{
+		ssize_t result = write(backend->fd, bytes + written, size - written);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == EAGAIN)
+			{
+				struct pollfd pfd = {.fd = backend->fd, .events = POLLOUT};
+				poll(&pfd, 1, -1);
+				continue;
+			}
+			return -1;
+		}
+		written += result;
+	}
+	return (int)written;
+}
+
+static int transport_fd_read(void *context, void *data, size_t size, uint32_t timeout_ms)
+{
+	TransportFd_type *backend = (TransportFd_type *)context;
+	struct pollfd pfd = {.fd = backend->fd, .events = POLLIN};
+	int timeout = (timeout_ms == TRANSPORT_WAIT_FOREVER) ? -1 : (int)timeout_ms;
+
+	int ready = poll(&pfd, 1, timeout);
+	if (ready <= 0)
+	{
+		return (ready == 0 || errno == EINTR) ? 0 : -1;
+	}
+	ssize_t result = read(backend->fd, data, size);
+	if (result < 0)
+	{
+		return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+	}
+	if (result == 0 && (pfd.revents & POLLHUP))
+	{
+		return -1;
+	}
+	return (int)result;
+}
+
+/**
+ * @brief Unsent bytes, TIOCOUTQ works on ttys and unix sockets
+ */
+static int transport_fd_tx_queued(void *context, size_t *queued)
+{
+	TransportFd_type *backend = (TransportFd_type *)context;
+	int count = 0;
+	if (ioctl(backend->fd, TIOCOUTQ, &count) != 0)
+	{
+		return -1;
+	}
+	*queued = (size_t)count;
+	return 0;
+}
+
+/**
+ * @brief Fill a transport that reads and writes fd
+ *
+ * @param transport transport to fill
+ * @param backend backend state, must outlive the transport
+ * @param fd open file descriptor
+ * @param name transport name
+ * @return 0 OK
+ * @return -1 invalid fd
+ */
+int transport_fd_init(Transport_type *transport, TransportFd_type *backend, int fd, const char *name)
+{
+	if (fd < 0)
+	{
+		return -1;
+	}
+	backend->fd = fd;
+	transport->name = name;
+	transport->write = transport_fd_write;
+	transport->read = transport_fd_read;
+	transport->tx_queued = transport_fd_tx_queued;
+	transport->flush = NULL;
+	transport->tx_buffer_size = 0;
+	transport->context = backend;
+	return 0;
+}
+
+/**
+ * @brief Connected pair of stream sockets, device on fds[0], host on fds[1]
+ *
+ * @return 0 OK
+ * @return -1 socketpair failed
+ */
+int transport_fd_socketpair(int fds[2])
+{
+	return socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Pseudo-terminal in raw mode, the slave behaves like the device serial port
+ *
+ * @param master_fd host side
+ * @param slave_fd device side, ptsname(master_fd) for other processes
+ * @return 0 OK
+ * @return -1 failed to open the pty
+ * @return -2 failed to set raw mode
+ */
+int transport_fd_openpty(int *master_fd, int *slave_fd)
+{
+	struct termios attributes;
+
+	*master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (*master_fd < 0 || grantpt(*master_fd) != 0 || unlockpt(*master_fd) != 0)
+	{
+		return -1;
+	}
+	*slave_fd = open(ptsname(*master_fd), O_RDWR | O_NOCTTY);
+	if (*slave_fd < 0)
+	{
+		return -1;
+	}
+	if (tcgetattr(*slave_fd, &attributes) != 0)
+	{
+		return -2;
+	}
+	cfmakeraw(&attributes);
+	if (tcsetattr(*slave_fd, TCSANOW, &attributes) != 0)
+	{
+		return -2;
+	}
+	return 0;
+}
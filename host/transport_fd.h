@@ -0,0 +1,18 @@
+#ifndef TRANSPORT_FD_H
+#define TRANSPORT_FD_H
+
+#include "transport.h"
+
+/**
+ * @brief Host transport backend on a POSIX file descriptor: pty, socket or serial port
+ */
+typedef struct TransportFd_type
+{
+	int fd;
+} TransportFd_type;
+
+int transport_fd_init(Transport_type *transport, TransportFd_type *backend, int fd, const char *name);
+int transport_fd_socketpair(int fds[2]);
+int transport_fd_openpty(int *master_fd, int *slave_fd);
+
+#endif // TRANSPORT_FD_H
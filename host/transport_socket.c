@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+#include "transport_socket.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+static int transport_socket_write(void *context, const void *data, size_t size)
+{
+	TransportSocket_type *backend = (TransportSocket_type *)context;
+	const uint8_t *bytes = (const uint8_t *)data;
+
+	// UDP collects the packet until flush
+	if (backend->mode == TRANSPORT_SOCKET_UDP)
+	{
+		if (backend->datagram_size + size > sizeof(backend->datagram))
+		{
+			backend->datagram_overflows++;
+			return -1;
+		}
+		memcpy(backend->datagram + backend->datagram_size, data, size);
+		backend->datagram_size += size;
+		return (int)size;
+	}
+
+	size_t written = 0;
+	while (written < size)
+	{
+		ssize_t result = send(backend->fd, bytes + written, size - written, MSG_NOSIGNAL);
+		if (result < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return -1;
+		}
+		written += result;
+	}
+	return (int)written;
+}
+
+static int transport_socket_flush(void *context)
+{
+	TransportSocket_type *backend = (TransportSocket_type *)context;
+	if (backend->mode != TRANSPORT_SOCKET_UDP || backend->datagram_size == 0)
+	{
+		return 0;
+	}
+	size_t size = backend->datagram_size;
+	backend->datagram_size = 0;
+	if (!backend->has_peer)
+	{
+		return -1;
+	}
+	ssize_t result = sendto(backend->fd, backend->datagram, size, 0, (const struct sockaddr *)&backend->peer, sizeof(backend->peer));
+	return (result == (ssize_t)size) ? 0 : -1;
+}
+
+static int transport_socket_read(void *context, void *data, size_t size, uint32_t timeout_ms)
+{
+	TransportSocket_type *backend = (TransportSocket_type *)context;
+	struct pollfd pfd = {.fd = backend->fd, .events = POLLIN};
+	int timeout = (timeout_ms == TRANSPORT_WAIT_FOREVER) ? -1 : (int)timeout_ms;
+
+	// A datagram is read whole or not at all, recvfrom would silently cut it to the buffer
+	if (backend->mode == TRANSPORT_SOCKET_UDP && size < sizeof(backend->datagram))
+	{
+		return TRANSPORT_ERROR_NO_SPACE;
+	}
+	int ready = poll(&pfd, 1, timeout);
+	if (ready <= 0)
+	{
+		return (ready == 0 || errno == EINTR) ? 0 : -1;
+	}
+	if (backend->mode == TRANSPORT_SOCKET_UDP)
+	{
+		struct sockaddr_in peer;
+		socklen_t peer_size = sizeof(peer);
+		ssize_t result = recvfrom(backend->fd, data, size, MSG_TRUNC, (struct sockaddr *)&peer, &peer_size);
+		if (result < 0)
+		{
+			return (errno == EINTR) ? 0 : -1;
+		}
+		if ((size_t)result > size)
+		{
+			// MSG_TRUNC returns the real datagram size, the packet in it is lost
+			backend->datagram_truncated++;
+			return TRANSPORT_ERROR_OVERFLOW;
+		}
+		backend->peer = peer;
+		backend->has_peer = 1;
+		return (int)result;
+	}
+	ssize_t result = recv(backend->fd, data, size, 0);
+	if (result == 0)
+	{
+		return -1; // closed by the peer
+	}
+	if (result < 0)
+	{
+		return (errno == EINTR) ? 0 : -1;
+	}
+	return (int)result;
+}
+
+/**
+ * @brief Unsent bytes of a TCP socket, UDP datagrams leave immediately
+ */
+static int transport_socket_tx_queued(void *context, size_t *queued)
+{
+	TransportSocket_type *backend = (TransportSocket_type *)context;
+	int count = 0;
+	if (backend->mode == TRANSPORT_SOCKET_UDP)
+	{
+		*queued = 0;
+		return 0;
+	}
+	if (ioctl(backend->fd, TIOCOUTQ, &count) != 0)
+	{
+		return -1;
+	}
+	*queued = (size_t)count;
+	return 0;
+}
+
+static int transport_socket_fill(Transport_type *transport, TransportSocket_type *backend, int fd, uint8_t mode)
+{
+	int send_buffer = 0;
+	socklen_t option_size = sizeof(send_buffer);
+
+	memset(backend, 0, sizeof(TransportSocket_type));
+	backend->fd = fd;
+	backend->mode = mode;
+	if (mode == TRANSPORT_SOCKET_TCP)
+	{
+		int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, &option_size);
+	}
+	transport->name = (mode == TRANSPORT_SOCKET_UDP) ? "UDP" : "TCP";
+	transport->write = transport_socket_write;
+	transport->read = transport_socket_read;
+	transport->tx_queued = transport_socket_tx_queued;
+	transport->flush = transport_socket_flush;
+	transport->tx_buffer_size = (send_buffer > 0) ? (size_t)send_buffer : 0;
+	transport->context = backend;
+	return 0;
+}
+
+static int transport_socket_address(struct sockaddr_in *socket_address, const char *address, uint16_t port)
+{
+	memset(socket_address, 0, sizeof(struct sockaddr_in));
+	socket_address->sin_family = AF_INET;
+	socket_address->sin_port = htons(port);
+	return (inet_pton(AF_INET, address, &socket_address->sin_addr) == 1) ? 0 : -1;
+}
+
+/**
+ * @brief Open the server socket
+ *
+ * @param mode TRANSPORT_SOCKET_TCP or TRANSPORT_SOCKET_UDP
+ * @param address IPv4 address to bind, e.g. 127.0.0.1
+ * @param port port to bind, 0 picks a free port
+ * @return socket fd, pass to transport_socket_accept
+ * @return -1 bad address
+ * @return -2 failed to create, bind or listen
+ */
+int transport_socket_listen(uint8_t mode, const char *address, uint16_t port)
+{
+	struct sockaddr_in socket_address;
+	int enable = 1;
+
+	if (transport_socket_address(&socket_address, address, port) != 0)
+	{
+		return -1;
+	}
+	int fd = socket(AF_INET, (mode == TRANSPORT_SOCKET_UDP) ? SOCK_DGRAM : SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return -2;
+	}
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	if (bind(fd, (const struct sockaddr *)&socket_address, sizeof(socket_address)) != 0 ||
+		(mode == TRANSPORT_SOCKET_TCP && listen(fd, 1) != 0))
+	{
+		close(fd);
+		return -2;
+	}
+	return fd;
+}
+
+/**
+ * @brief Wait for a TCP client, UDP uses the bound socket directly
+ *
+ * @return 0 OK
+ * @return -1 accept failed
+ */
+int transport_socket_accept(Transport_type *transport, TransportSocket_type *backend, int listen_fd, uint8_t mode)
+{
+	int fd = listen_fd;
+	if (mode == TRANSPORT_SOCKET_TCP && (fd = accept(listen_fd, NULL, NULL)) < 0)
+	{
+		return -1;
+	}
+	return transport_socket_fill(transport, backend, fd, mode);
+}
+
+/**
+ * @brief Connect a client to the server
+ *
+ * @return 0 OK
+ * @return -1 bad address
+ * @return -2 failed to create or connect the socket
+ */
+int transport_socket_connect(Transport_type *transport, TransportSocket_type *backend, uint8_t mode, const char *address, uint16_t port)
+{
+	struct sockaddr_in socket_address;
+	if (transport_socket_address(&socket_address, address, port) != 0)
+	{
+		return -1;
+	}
+	int fd = socket(AF_INET, (mode == TRANSPORT_SOCKET_UDP) ? SOCK_DGRAM : SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		return -2;
+	}
+	if (mode == TRANSPORT_SOCKET_UDP)
+	{
+		// Unconnected, the first flush sends to the server and replies come back on the same socket
+		int receive_buffer = 4 * 1024 * 1024;
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+	}
+	else if (connect(fd, (const struct sockaddr *)&socket_address, sizeof(socket_address)) != 0)
+	{
+		close(fd);
+		return -2;
+	}
+	transport_socket_fill(transport, backend, fd, mode);
+	backend->peer = socket_address;
+	backend->has_peer = 1;
+	return 0;
+}
+
+void transport_socket_close(TransportSocket_type *backend)
+{
+	if (backend->fd >= 0)
+	{
+		close(backend->fd);
+		backend->fd = -1;
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef TRANSPORT_SOCKET_H
+#define TRANSPORT_SOCKET_H
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include "transport.h"
+#include "mlx_protocol.h"
+
+#define TRANSPORT_SOCKET_TCP 0
+#define TRANSPORT_SOCKET_UDP 1
+#define TRANSPORT_SOCKET_DATAGRAM_SIZE (sizeof(MlxPacketHeader_type) + MLX_PACKET_MAX_PAYLOAD + MLX_PACKET_CRC_SIZE)
+
+/**
+ * @brief Socket transport
+ *
+ * TCP carries the same byte stream as the uart. UDP sends every packet as one datagram, the packet
+ * sequence numbers show lost and reordered datagrams. The server answers the address of the last
+ * datagram it received, so a UDP client starts the stream by sending a command.
+ */
+typedef struct TransportSocket_type
+{
+	int fd;
+	uint8_t mode;
+	struct sockaddr_in peer;
+	int has_peer;
+	uint8_t datagram[TRANSPORT_SOCKET_DATAGRAM_SIZE];
+	size_t datagram_size;
+	uint32_t datagram_overflows;
+	uint32_t datagram_truncated; // received datagrams larger than TRANSPORT_SOCKET_DATAGRAM_SIZE
+} TransportSocket_type;
+
+int transport_socket_listen(uint8_t mode, const char *address, uint16_t port);
+int transport_socket_accept(Transport_type *transport, TransportSocket_type *backend, int listen_fd, uint8_t mode);
+int transport_socket_connect(Transport_type *transport, TransportSocket_type *backend, uint8_t mode, const char *address, uint16_t port);
+void transport_socket_close(TransportSocket_type *backend);
+
+#endif // TRANSPORT_SOCKET_H
@@ -7,11 +7,35 @@ TaskHandle_t handl_mlx_init;
 
 SemaphoreHandle_t semphr_request_image;
 
-QueueHandle_t queue_uart_isr_event_queue; // UART ISR queue
 QueueHandle_t queue_enqueued_msg_processing;
 
+Transport_type link_transport; // command and packet stream to the host
+static TransportUart_type link_transport_uart;
+
 float *subpage_0;
 float *subpage_1;
+uint16_t *raw_subpage; // last subpage read in raw output mode
+
+FrameBusSubscriber_type *subscriber_uart_frame_data;
+
+static int8_t deinterlaced_subpage_number = FRAME_BUS_FULL_FRAME; // last subpage read in subpage or raw output mode
+static volatile bool eeprom_pending = false;						 // send the EEPROM before the next frame
+static volatile bool eeprom_sent = false;							 // EEPROM sent since the last switch to raw output
+static volatile TickType_t last_packet_ticks = 0;					 // last EEPROM or frame written by the TX task
+static MlxI2cTraceChunk_type i2c_trace_chunk;						 // I2C trace chunk being sent by the TX task
+static MlxLatencyRecord_type latency_record;							 // latency record being sent by the TX task
+
+/**
+ * @brief Record the link latency of sent frames
+ */
+static void uart_tx_complete(uint8_t type, uint32_t sequence, uint32_t link_us)
+{
+	if (type == MLX_PACKET_FRAME)
+	{
+		frame_governor_record_link(link_us);
+		frame_latency_complete(sequence);
+	}
+}
 
 void task_initialization(void *params)
 {
@@ -20,29 +44,55 @@ void task_initialization(void *params)
 
 	subpage_0 = (float *)calloc(MLX_FRAME_SIZE, sizeof(float));
 	subpage_1 = (float *)calloc(MLX_FRAME_SIZE, sizeof(float));
-	if (subpage_0 == NULL || subpage_1 == NULL)
+	raw_subpage = (uint16_t *)calloc(MLX_RAW_SUBPAGE_SIZE, sizeof(uint16_t));
+	if (subpage_0 == NULL || subpage_1 == NULL || raw_subpage == NULL)
+	{
+		ESP_LOGE(TAG, "Failed to allocate memory for subpage 0, 1 or raw");
+		vTaskDelete(NULL);
+	}
+
+	// Frame pool shared by all frame consumers
+	if ((error_code = frame_bus_init()) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to init frame bus. Error: %d", error_code);
+		vTaskDelete(NULL);
+	}
+	if ((error_code = frame_bus_subscribe("uart", 1, FRAME_BUS_DROP_NEWEST, &subscriber_uart_frame_data)) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to subscribe uart to frame bus. Error: %d", error_code);
+		vTaskDelete(NULL);
+	}
+	// Link shared by command responses and frames, the transport is opened below
+	if ((error_code = uart_tx_init(&link_transport, subscriber_uart_frame_data)) != 0)
 	{
-		ESP_LOGE(TAG, "Failed to allocate memory for subpage 0 and or 1");
+		ESP_LOGE(TAG, "Failed to init uart tx channels. Error: %d", error_code);
 		vTaskDelete(NULL);
 	}
+	uart_tx_set_complete_callback(uart_tx_complete);
 
 	// Create semaphore binaries
 	semphr_request_image = xSemaphoreCreateBinary();
 
 	// Create queues
-	queue_uart_isr_event_queue = xQueueCreate(8, sizeof(TaskQueueMessage_type));
-	queue_enqueued_msg_processing = xQueueCreate(4, sizeof(TaskQueueMessage_type));
+	queue_enqueued_msg_processing = xQueueCreate(UART_MSG_SLOT_COUNT, sizeof(TaskQueueMessage_type));
 
-	// Init MLX I2C
-	if ((error_code = MLX90640_I2CInit()) != 0)
+	if ((error_code = app_commands_register()) != 0)
 	{
-		ESP_LOGE(TAG, "Failed to init i2c. Error: %d", error_code);
+		ESP_LOGE(TAG, "Failed to register commands. Error: %d", error_code);
+		vTaskDelete(NULL);
+	}
+
+	// Received messages are stored in fixed slots
+	if ((error_code = myuart_message_pool_init()) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to init uart message pool. Error: %d", error_code);
 		vTaskDelete(NULL);
 	}
-	// Set camera refresh rate
-	if ((error_code = MLX90640_SetRefreshRate(MLX90640_SLAVE_ADR, MLX_REFRESH_RATE)) != 0)
+
+	// Init MLX I2C
+	if ((error_code = MLX90640_I2CInit()) != 0)
 	{
-		ESP_LOGE(TAG, "Failed to set mlx frame refresh. Error: %d", error_code);
+		ESP_LOGE(TAG, "Failed to init i2c. Error: %d", error_code);
 		vTaskDelete(NULL);
 	}
 	// General reset MLX
@@ -54,11 +104,17 @@ void task_initialization(void *params)
 	// Initial MLX delay after power-on reset
 	mlx_delay_after_por();
 	// Read frame
-	if (mlx_read_extract_eeprom(&mlx90640_params) != 0)
+	if (mlx_read_extract_eeprom() != 0)
 	{
 		ESP_LOGE(TAG, "Failed to read and extract EEPROM data");
 		vTaskDelete(NULL);
 	}
+	// Set camera refresh rate, resolution and pattern
+	if ((error_code = mlx_config_apply(&mlx_config, true)) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to configure the sensor. Error: %d", error_code);
+		vTaskDelete(NULL);
+	}
 
 	if (xTaskCreatePinnedToCore(task_mlx_get_subpages, "MLX get subpage task", TASK_GET_SUBPAGES_STACK_SIZE, NULL, 10, &handl_get_subpages, tskNO_AFFINITY) != pdPASS)
 	{
@@ -75,11 +131,24 @@ void task_initialization(void *params)
 		ESP_LOGE(TAG, "Failed to create mlx mlx merge subpages task");
 		vTaskDelete(NULL);
 	}
+	if (FRAME_LOGGER == 1 && xTaskCreatePinnedToCore(task_frame_logger, "Frame logger task", TASK_FRAME_LOGGER_STACK_SIZE, NULL, 5, NULL, tskNO_AFFINITY) != pdPASS)
+	{
+		ESP_LOGE(TAG, "Failed to create frame logger task");
+		vTaskDelete(NULL);
+	}
 
-	// Init UART with ISR queue
-	if ((error_code = myuart_init_with_isr_queue(&uart_config, UART_NUM, UART_TXD, UART_RXD, UART_TX_BUFF_SIZE, UART_RX_BUFF_SIZE, &queue_uart_isr_event_queue, UART_EVENT_QUEUE_SIZE, 0)) != 0)
+	// Open the link to the host
+	if (MLX_TRANSPORT == MLX_TRANSPORT_USB_SERIAL_JTAG)
+	{
+		error_code = transport_usb_init(&link_transport);
+	}
+	else
+	{
+		error_code = transport_uart_init(&link_transport, &link_transport_uart, UART_NUM, UART_TXD, UART_RXD, UART_TX_BUFF_SIZE, UART_RX_BUFF_SIZE, UART_EVENT_QUEUE_SIZE);
+	}
+	if (error_code != 0)
 	{
-		ESP_LOGE(TAG, "Failed to init uart with isr queue. Error code %d", error_code);
+		ESP_LOGE(TAG, "Failed to open the host link. Error code %d", error_code);
 		vTaskDelete(NULL);
 	}
 
@@ -94,18 +163,6 @@ void task_initialization(void *params)
 		ESP_LOGE(TAG, "Failed to create receive queue msg task");
 		vTaskDelete(NULL);
 	}
-	// Enable pattern detection and reset the pattern queue
-	if ((error_code = uart_enable_pattern_det_baud_intr(UART_NUM, '+', UART_PATTERN_SIZE, 8, 0, 0)) != 0)
-	{
-		ESP_LOGE(TAG, "Failed to enable pattern detection baud interrupt");
-		vTaskDelete(NULL);
-	}
-	if ((error_code = uart_pattern_queue_reset(UART_NUM, UART_PAT_QUEUE_SIZE)) != 0)
-	{
-		ESP_LOGE(TAG, "Failed to reset uart pattern queue");
-		vTaskDelete(NULL);
-	}
-
 	// Initial semaphore give
 	xSemaphoreGive(semphr_request_image);
 
@@ -120,7 +177,23 @@ void task_initialization(void *params)
 }
 
 /**
- * @brief
+ * @brief Hand back the credit and the frame token of a frame that was not published
+ *
+ * @param failed true for errors, false for frames skipped on purpose
+ */
+static void frame_not_published(bool failed)
+{
+	if (frame_credits_refund(failed) != 0)
+	{
+		uart_tx_send_text("MLX CANCELLED");
+	}
+	xSemaphoreGive(semphr_request_image);
+}
+
+/**
+ * @brief Produce one frame per credit
+ *
+ * Frames are started back-to-back while credits are available, one frame at a time.
  *
  * @param params
  */
@@ -133,7 +206,46 @@ void task_mlx_get_subpages(void *params)
 	int error_code = 0;
 	while (1)
 	{
-		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		// Credits are granted before the notification, so no grant is missed between take and wait
+		if (!frame_credits_take())
+		{
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			continue;
+		}
+		int64_t request_us = frame_latency_take_request();
+		// Wait until the previous frame was queued for transmission
+		xSemaphoreTake(semphr_request_image, portMAX_DELAY);
+		frame_latency_begin(request_us);
+		failed_attempts = 0;
+		error_code = 0;
+
+		// Raw output, every subpage is sent as read and calibrated by the host
+		if (mlx_config.output_mode == MLX_OUTPUT_RAW)
+		{
+			if ((error_code = mlx_read_subpage_raw(raw_subpage, MLX_ANY_SUBPAGE, &last_wake_time)) < 0)
+			{
+				ESP_LOGW(TAG, "Failed reading raw subpage. Error: %d", error_code);
+				frame_not_published(true);
+				continue;
+			}
+			deinterlaced_subpage_number = error_code;
+			xTaskNotifyGive(handl_merge_subpages);
+			continue;
+		}
+
+		// Subpage rate output, subpage_0 holds the frame that gets deinterlaced on every subpage
+		if (mlx_config.output_mode == MLX_OUTPUT_SUBPAGE)
+		{
+			if ((error_code = mlx_read_deinterlaced_frame(subpage_0, mlx_config.emissivity, mlx_config.ambient_offset, mlx_config.deinterlace_method, &last_wake_time)) < 0)
+			{
+				ESP_LOGW(TAG, "Failed reading deinterlaced frame. Error: %d", error_code);
+				frame_not_published(true);
+				continue;
+			}
+			deinterlaced_subpage_number = error_code;
+			xTaskNotifyGive(handl_merge_subpages);
+			continue;
+		}
 
 		// Zero write subpages
 		memset(subpage_0, 0, MLX_FRAME_SIZE * sizeof(float));
@@ -143,12 +255,13 @@ void task_mlx_get_subpages(void *params)
 		if (MLX90640_SynchFrame(MLX90640_SLAVE_ADR) != 0)
 		{
 			ESP_LOGW(TAG, "Failed syncing subpages. Error: %d", error_code);
-			xSemaphoreGive(semphr_request_image);
+			frame_not_published(true);
 			continue;
 		}
+		frame_latency_mark(MLX_LATENCY_SYNC);
 
 		while ((failed_attempts < 2) &&
-			   (error_code = mlx_read_full_picture(subpage_0, subpage_1, .97, -8, &last_wake_time)) != 0)
+			   (error_code = mlx_read_full_picture(subpage_0, subpage_1, mlx_config.emissivity, mlx_config.ambient_offset, &last_wake_time)) != 0)
 		{
 			// If reading picture failed give it another try
 			failed_attempts++;
@@ -158,7 +271,7 @@ void task_mlx_get_subpages(void *params)
 		if (error_code != 0)
 		{
 			ESP_LOGW(TAG, "Failed reading subpages. Error: %d", error_code);
-			xSemaphoreGive(semphr_request_image);
+			frame_not_published(true);
 			continue;
 		}
 
@@ -169,12 +282,19 @@ void task_mlx_get_subpages(void *params)
 			ESP_LOGD(TAG, "Stack in use: %u of %u B", (TASK_GET_SUBPAGES_STACK_SIZE - stack_hwm), TASK_GET_SUBPAGES_STACK_SIZE);
 		}
 
-		failed_attempts = 0;
-		error_code = 0;
 		xTaskNotifyGive(handl_merge_subpages);
 	}
 }
 
+/**
+ * @brief Assemble the output frame and publish it on the frame bus
+ *
+ * Full frame mode merges both subpages, subpage mode publishes the deinterlaced frame from subpage_0,
+ * raw mode publishes the words of raw_subpage. Under link backpressure frames are sent as int16 or skipped,
+ * raw frames are only skipped.
+ *
+ * @param params
+ */
 void task_mlx_merge_subpages(void *params)
 {
 	const char *TAG = "TSK MERGE SUBPAGES";
@@ -182,13 +302,65 @@ void task_mlx_merge_subpages(void *params)
 	{
 		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-		if (mlx_merge_subpages(subpage_0, subpage_1) != 0)
+		// Skip the frame instead of stalling acquisition when the link is behind
+		uint8_t backpressure = uart_tx_backpressure();
+		if (backpressure == UART_TX_BACKPRESSURE_FULL)
+		{
+			uart_tx_stats.skipped++;
+			frame_governor_record_skip();
+			frame_not_published(false);
+			continue;
+		}
+
+		FrameBuffer_type *frame = frame_bus_acquire(pdMS_TO_TICKS(mlx_config.refresh_millis));
+		if (frame == NULL)
+		{
+			ESP_LOGW(TAG, "No free frame buffer");
+			frame_not_published(true);
+			continue;
+		}
+
+		// Raw words are copied as read, the temperatures are calculated by the host
+		if (mlx_config.output_mode == MLX_OUTPUT_RAW)
+		{
+			memcpy(frame->encoded.raw, raw_subpage, sizeof(frame->encoded.raw));
+			frame->subpage = deinterlaced_subpage_number;
+			frame->pixel_format = MLX_PIXEL_RAW;
+			frame->encoded_size = sizeof(frame->encoded.raw);
+			frame->ta = 0;
+			frame->offset = 0;
+			frame->scale = 0;
+			frame_latency_handoff(&frame->latency);
+			frame_bus_publish(frame);
+			frame_credits_published();
+			continue;
+		}
+
+		// Deinterlaced frames are only copied, full frames are merged from both subpages
+		const float *second_subpage = (mlx_config.output_mode == MLX_OUTPUT_SUBPAGE) ? NULL : subpage_1;
+		frame->subpage = (mlx_config.output_mode == MLX_OUTPUT_SUBPAGE) ? deinterlaced_subpage_number : FRAME_BUS_FULL_FRAME;
+		frame->pixel_format = mlx_config.pixel_format;
+		if (backpressure == UART_TX_BACKPRESSURE_HIGH && (frame->pixel_format == MLX_PIXEL_FLOAT32 || frame->pixel_format == MLX_PIXEL_FLOAT16))
+		{
+			frame->pixel_format = MLX_PIXEL_INT16;
+			uart_tx_stats.compacted++;
+		}
+		uint8_t merge_format = (frame->pixel_format == MLX_PIXEL_DELTA) ? MLX_PIXEL_FLOAT32 : frame->pixel_format;
+		int encoded_size = mlx_merge_subpages(frame->temps, subpage_0, second_subpage, merge_format, frame->encoded.u8, &frame->offset, &frame->scale);
+		if (encoded_size >= 0 && frame->pixel_format == MLX_PIXEL_DELTA)
+		{
+			encoded_size = mlx_delta_encode_frame(frame->temps, &frame->pixel_format, frame->encoded.u8, sizeof(frame->encoded), &frame->offset, &frame->scale);
+		}
+		if (encoded_size < 0)
 		{
 			ESP_LOGW(TAG, "Failed to merge subpages");
-			uart_write_bytes(UART_NUM, "Error reading subpages", strlen("Error reading subpages"));
-			xSemaphoreGive(semphr_request_image);
+			uart_tx_send_text("Error reading subpages");
+			frame_bus_release(frame);
+			frame_not_published(true);
 			continue;
 		}
+		frame->encoded_size = encoded_size;
+		frame->ta = mlx_ambient_temperature;
 
 		if (DEBUG_STACKS == 1)
 		{
@@ -197,24 +369,67 @@ void task_mlx_merge_subpages(void *params)
 			ESP_LOGD(TAG, "Stack in use: %u of %u B", (TASK_MERGE_SUBPAGES_STACK_SIZE - stack_hwm), TASK_MERGE_SUBPAGES_STACK_SIZE);
 		}
 
-		xTaskNotifyGive(handl_uart_frame_data);
+		frame_latency_handoff(&frame->latency);
+		frame_bus_publish(frame);
+		frame_credits_published();
 	}
 }
 
+/**
+ * @brief Uart transmit task, the only writer of the uart link
+ *
+ * Multiplexes the control channel (command responses) and the data channel (frames) at packet
+ * granularity, in the order they were queued. See mlx_protocol.h for the packet layout.
+ *
+ * @param params
+ */
 void task_mlx_uart_frame_data(void *params)
 {
 	const char *TAG = "TSK UART FRAME DATA";
-	size_t buffer_size = MLX_FRAME_SIZE * sizeof(float);
-	uint8_t *buffer = (uint8_t *)malloc(buffer_size);
 	while (1)
 	{
-		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-		// copy new frame bytes to uint8_t buffer
-		memcpy(buffer, subpage_0, MLX_FRAME_SIZE * sizeof(float));
-		// Start flag, data, stop flag
-		uart_write_bytes(UART_NUM, "\xff\xff\xff\xff\xfa", 5);
-		uart_write_bytes(UART_NUM, buffer, buffer_size);
-		uart_write_bytes(UART_NUM, "\xfa\xff\xff\xff\xff", 5);
+		FrameBuffer_type *frame = uart_tx_wait(portMAX_DELAY);
+		// Hosts calibrate raw frames with the EEPROM, it goes out ahead of the next frame
+		if (eeprom_pending)
+		{
+			eeprom_pending = false;
+			uart_tx_write_eeprom(mlx_eeprom_dump);
+			eeprom_sent = true;
+			last_packet_ticks = xTaskGetTickCount();
+		}
+		// The I2C trace goes out in whole chunks while MLX TRACE ON
+		while (mlx_i2c_recorder_take(&i2c_trace_chunk) > 0)
+		{
+			uart_tx_write_i2c_trace(i2c_trace_chunk.data, i2c_trace_chunk.size);
+		}
+		// Latency records of the frames that left the TX buffer while MLX LATENCY TRACE ON
+		while (frame_latency_take_record(&latency_record))
+		{
+			uart_tx_write_latency(&latency_record);
+		}
+		if (frame == NULL)
+		{
+			continue;
+		}
+		int64_t tx_start = esp_timer_get_time();
+		uart_tx_write_frame(frame);
+		last_packet_ticks = xTaskGetTickCount();
+		frame_latency_sent(&frame->latency, frame->sequence, tx_start);
+		frame_bus_release(frame);
+		frame_governor_record_tx(esp_timer_get_time() - tx_start);
+
+		// No frame is in flight until the semaphore is given, safe to change the refresh rate
+		uint8_t subpages_per_frame = (mlx_config.output_mode == MLX_OUTPUT_FULL_FRAME) ? 2 : 1;
+		uint8_t new_rate = mlx_config.refresh_rate;
+		if (frame_governor_update(mlx_config.refresh_rate, subpages_per_frame, mlx_config.governor, &new_rate) != GOVERNOR_HOLD)
+		{
+			MlxConfig_type new_config = mlx_config;
+			new_config.refresh_rate = new_rate;
+			if (mlx_config_apply(&new_config, false) != 0)
+			{
+				ESP_LOGW(TAG, "Governor failed to set refresh rate 0x%02x", new_rate);
+			}
+		}
 
 		if (DEBUG_STACKS == 1)
 		{
@@ -227,12 +442,63 @@ void task_mlx_uart_frame_data(void *params)
 	}
 }
 
+/**
+ * @brief Log frame statistics
+ *
+ * Example of an additional frame bus consumer, enabled with FRAME_LOGGER.
+ *
+ * @param params
+ */
+void task_frame_logger(void *params)
+{
+	const char *TAG = "TSK FRAME LOGGER";
+	FrameBusSubscriber_type *subscriber = NULL;
+	if (frame_bus_subscribe("logger", 2, FRAME_BUS_DROP_OLDEST, &subscriber) != 0)
+	{
+		ESP_LOGE(TAG, "Failed to subscribe to frame bus");
+		vTaskDelete(NULL);
+	}
+
+	while (1)
+	{
+		FrameBuffer_type *frame = frame_bus_receive(subscriber, portMAX_DELAY);
+		if (frame == NULL)
+		{
+			continue;
+		}
+		if (frame->pixel_format == MLX_PIXEL_RAW)
+		{
+			ESP_LOGI(TAG, "Frame %lu raw subpage %d (dropped %lu)", (unsigned long)frame->sequence, frame->subpage, (unsigned long)subscriber->dropped);
+			frame_bus_release(frame);
+			continue;
+		}
+		float min = frame->temps[0];
+		float max = frame->temps[0];
+		float sum = 0;
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			min = (frame->temps[i] < min) ? frame->temps[i] : min;
+			max = (frame->temps[i] > max) ? frame->temps[i] : max;
+			sum += frame->temps[i];
+		}
+		ESP_LOGI(TAG, "Frame %lu subpage %d: min %.2f mean %.2f max %.2f (dropped %lu)", (unsigned long)frame->sequence, frame->subpage, min, sum / MLX_FRAME_SIZE, max, (unsigned long)subscriber->dropped);
+		frame_bus_release(frame);
+
+		if (DEBUG_STACKS == 1)
+		{
+			UBaseType_t stack_hwm = uxTaskGetStackHighWaterMark(NULL);
+			ESP_LOGD(TAG, "Free stack size: %u B", stack_hwm);
+			ESP_LOGD(TAG, "Stack in use: %u of %u B", (TASK_FRAME_LOGGER_STACK_SIZE - stack_hwm), TASK_FRAME_LOGGER_STACK_SIZE);
+		}
+	}
+}
+
 // ---------- UART ISR TASKS ----------
 
 /**
- * @brief Uart ISR event monitoring
+ * @brief Link receive task
  *
- * Catch encapsulated uart messages and send them to the message processing task
+ * Catch encapsulated messages from the host link and send them to the message processing task
  *
  * @param params
  */
@@ -240,39 +506,22 @@ void task_uart_isr_monitoring(void *params)
 {
 	const char *TAG = "UART ISR TASK";
 
-	uart_event_t uart_event;
-	int error_flag = 0;
-	int encapsulation_counter = 0;
+	uint8_t rx_chunk[UART_RX_CHUNK_SIZE];
+	UartParser_type parser = {0};
+	myuart_parser_reset(&parser);
 
 	while (1)
 	{
-		// Receive the entire uart_event_t structure from the queue
-		if (xQueueReceive(queue_uart_isr_event_queue, (void *)&uart_event, portMAX_DELAY) == pdTRUE)
+		int rx_size = transport_read(&link_transport, rx_chunk, sizeof(rx_chunk), TRANSPORT_WAIT_FOREVER);
+		if (rx_size > 0)
 		{
-			switch (uart_event.type)
-			{
-			/**
-			 * @brief Pattern detection case
-			 *
-			 * Multiple identical characters of specific type detected in a row.
-			 * Number of chars is defined with macro UART_PATTERN_SIZE
-			 */
-			case UART_PATTERN_DET:
-				int pattern_index = uart_pattern_pop_pos(UART_NUM);
-				if (pattern_index == -1)
-				{
-					ESP_LOGW(TAG, "Pattern index -1");
-					break;
-				}
-				if ((error_flag = myuart_encapsulation_handler(UART_NUM, &encapsulation_counter, &pattern_index)) < 0)
-				{
-					ESP_LOGE(TAG, "Uart encapsulation handler error %d", error_flag);
-				}
-				break;
-
-			default:
-				break;
-			}
+			myuart_parser_feed(&parser, rx_chunk, rx_size);
+		}
+		// Received bytes were lost, drop the partial message and resync on the next start flag
+		else if (rx_size == TRANSPORT_ERROR_OVERFLOW)
+		{
+			ESP_LOGW(TAG, "RX overflow");
+			myuart_parser_reset(&parser);
 		}
 
 		if (DEBUG_STACKS == 1)
@@ -286,11 +535,313 @@ void task_uart_isr_monitoring(void *params)
 	vTaskDelete(NULL);
 }
 
+// ---------- COMMANDS ----------
+
+static const char *MLX_BUSY = "MLX BUSY";
+static const char *MLX_OK = "MLX OK";
+static const char *MLX_FAIL = "MLX FAIL";
+
+/**
+ * @brief Write a formatted status text, truncated to the buffer size
+ */
+static void respond_formatted(CommandResponse_type *response, const char *text, int text_size, size_t buf_size)
+{
+	if (text_size > 0)
+	{
+		command_respond(response, text, ((size_t)text_size < buf_size) ? (size_t)text_size : buf_size - 1);
+	}
+}
+
+static int cmd_whoami(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	command_respond_text(response, "MLX90640");
+	return 0;
+}
+
+/**
+ * @brief MLX START [N], grant N frames (default 1)
+ *
+ * Replies with the sequence numbers of the first and the last granted frame. In raw mode every subpage
+ * uses one credit, and the EEPROM goes out ahead of the first frame if it was not sent since the switch
+ * to raw output, or if nothing was sent for EEPROM_STALL_PERIODS subpage periods.
+ */
+static int cmd_mlx_start(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[48];
+	uint32_t first_sequence = 0;
+	uint32_t last_sequence = 0;
+	int32_t count = (arg_count > 0) ? args[0].integer : 1;
+	bool idle = (frame_credits.available == 0);
+
+	if (count < 1)
+	{
+		command_respond_text(response, MLX_FAIL);
+		return 0;
+	}
+	if (idle)
+	{
+		// The first frame is timed from this command, later ones from their credit
+		frame_latency_request();
+	}
+	if (frame_credits_grant(count, &first_sequence, &last_sequence) != 0)
+	{
+		command_respond_text(response, MLX_BUSY);
+		return 0;
+	}
+	if (mlx_config.output_mode == MLX_OUTPUT_RAW &&
+		(!eeprom_sent || xTaskGetTickCount() - last_packet_ticks > pdMS_TO_TICKS(EEPROM_STALL_PERIODS * mlx_config.refresh_millis)))
+	{
+		// A host that reconnects after a stall needs the EEPROM again, once
+		last_packet_ticks = xTaskGetTickCount();
+		eeprom_pending = true;
+	}
+	xTaskNotifyGive(handl_get_subpages);
+	respond_formatted(response, text, snprintf(text, sizeof(text), "%s %lu %lu", MLX_OK, (unsigned long)first_sequence, (unsigned long)last_sequence), sizeof(text));
+	return 0;
+}
+
+/**
+ * @brief MLX STOP, cancel the frames that were not started yet
+ */
+static int cmd_mlx_stop(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[32];
+	respond_formatted(response, text, snprintf(text, sizeof(text), "%s %lu", MLX_OK, (unsigned long)frame_credits_cancel()), sizeof(text));
+	return 0;
+}
+
+static int cmd_mlx_credits(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[128];
+	respond_formatted(response, text, frame_credits_format(text, sizeof(text)), sizeof(text));
+	return 0;
+}
+
+/**
+ * @brief MLX SET <KEY> <VALUE>, change a setting
+ *
+ * Sensor settings may only change while no frame is being read.
+ */
+static int cmd_mlx_set(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	const char *TAG = "CMD MLX SET";
+
+	MlxConfig_type new_config = mlx_config;
+	if (mlx_config_set(&new_config, args[0].word, args[1].word) != 0)
+	{
+		command_respond_text(response, MLX_FAIL);
+		return 0;
+	}
+	if (xSemaphoreTake(semphr_request_image, pdMS_TO_TICKS(4 * mlx_config.refresh_millis)) != pdTRUE)
+	{
+		command_respond_text(response, MLX_BUSY);
+		return 0;
+	}
+	bool raw_started = (new_config.output_mode == MLX_OUTPUT_RAW && mlx_config.output_mode != MLX_OUTPUT_RAW);
+	int error_code = mlx_config_apply(&new_config, false);
+	if (error_code == 0 && raw_started)
+	{
+		eeprom_sent = false;
+		eeprom_pending = true;
+	}
+	xSemaphoreGive(semphr_request_image);
+	if (error_code != 0)
+	{
+		ESP_LOGW(TAG, "Failed to apply %s %s. Error: %d", args[0].word, args[1].word, error_code);
+		command_respond_text(response, MLX_FAIL);
+		return 0;
+	}
+	command_respond_text(response, MLX_OK);
+	return 0;
+}
+
+static int cmd_mlx_config(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[128];
+	respond_formatted(response, text, mlx_config_format(&mlx_config, text, sizeof(text)), sizeof(text));
+	return 0;
+}
+
+static int cmd_mlx_gov(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[128];
+	respond_formatted(response, text, frame_governor_format(text, sizeof(text)), sizeof(text));
+	return 0;
+}
+
+static int cmd_mlx_deadline(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[128];
+	respond_formatted(response, text, mlx_deadline_format(text, sizeof(text)), sizeof(text));
+	return 0;
+}
+
+static int cmd_mlx_tx(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[128];
+	respond_formatted(response, text, uart_tx_format(text, sizeof(text)), sizeof(text));
+	return 0;
+}
+
+static int cmd_mlx_key(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	mlx_delta_force_key();
+	command_respond_text(response, MLX_OK);
+	return 0;
+}
+
+/**
+ * @brief MLX EEPROM, send the EEPROM packet, e.g. to a host that connected to a running raw stream
+ */
+static int cmd_mlx_eeprom(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	eeprom_pending = true;
+	command_respond_text(response, MLX_OK);
+	return 0;
+}
+
+/**
+ * @brief MLX TRACE [ON|OFF], record every I2C transaction and send it as MLX_PACKET_I2C_TRACE packets
+ *
+ * Without argument the trace status is printed. OFF answers the number of recorded and dropped entries.
+ */
+static int cmd_mlx_trace(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[64];
+	if (arg_count == 0)
+	{
+		respond_formatted(response, text, mlx_i2c_recorder_format(text, sizeof(text)), sizeof(text));
+		return 0;
+	}
+	if (strcmp(args[0].word, "ON") == 0)
+	{
+		command_respond_text(response, (mlx_i2c_recorder_start(mlx_eeprom_dump) == 0) ? MLX_OK : MLX_FAIL);
+		return 0;
+	}
+	if (strcmp(args[0].word, "OFF") == 0)
+	{
+		mlx_i2c_recorder_stop();
+		respond_formatted(response, text, snprintf(text, sizeof(text), "%s %lu %lu", MLX_OK, (unsigned long)mlx_i2c_recorder.entries, (unsigned long)mlx_i2c_recorder.dropped), sizeof(text));
+		return 0;
+	}
+	command_respond_text(response, MLX_FAIL);
+	return 0;
+}
+
+/**
+ * @brief MLX BENCH [N], time N iterations (default MLX_BENCH_DEFAULT_ITERATIONS) of every pipeline stage
+ *
+ * Runs between frames like MLX SET. Every stage is answered with its own BENCH line of min, median,
+ * p99 and max CPU cycles, then MLX OK with the iterations and the CPU clock in Hz.
+ */
+static int cmd_mlx_bench(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	const char *TAG = "CMD MLX BENCH";
+	static MlxBench_type bench;
+	char text[UART_TX_CONTROL_MAX_SIZE];
+	int32_t iterations = (arg_count > 0) ? args[0].integer : MLX_BENCH_DEFAULT_ITERATIONS;
+
+	if (iterations < 1 || iterations > MLX_BENCH_MAX_ITERATIONS)
+	{
+		command_respond_text(response, MLX_FAIL);
+		return 0;
+	}
+	if (xSemaphoreTake(semphr_request_image, pdMS_TO_TICKS(4 * mlx_config.refresh_millis)) != pdTRUE)
+	{
+		command_respond_text(response, MLX_BUSY);
+		return 0;
+	}
+	int error_code = mlx_bench_run(iterations, &bench);
+	xSemaphoreGive(semphr_request_image);
+	if (error_code != 0)
+	{
+		ESP_LOGW(TAG, "Benchmark failed. Error: %d", error_code);
+		command_respond_text(response, MLX_FAIL);
+		return 0;
+	}
+	for (uint8_t stage = 0; stage < MLX_BENCH_STAGES; stage++)
+	{
+		if (mlx_bench_format_stage(&bench, stage, text, sizeof(text)) > 0)
+		{
+			uart_tx_send_text(text);
+		}
+	}
+	respond_formatted(response, text, snprintf(text, sizeof(text), "%s %u %lu", MLX_OK, bench.iterations, (unsigned long)bench.cpu_hz), sizeof(text));
+	return 0;
+}
+
+/**
+ * @brief MLX LATENCY [STAGE|RESET|TRACE ON|OFF], per frame pipeline latency
+ *
+ * Without argument the number of frames and the median of every stage in us are printed, in the
+ * order TOTAL SYNC READ0 CALC0 READ1 CALC1 MERGE QUEUE LINK. A stage name prints its percentiles,
+ * maximum and log2 histogram. TRACE ON sends an MLX_PACKET_LATENCY record after every frame.
+ */
+static int cmd_mlx_latency(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response)
+{
+	char text[UART_TX_CONTROL_MAX_SIZE];
+	if (arg_count == 0)
+	{
+		respond_formatted(response, text, frame_latency_format(text, sizeof(text)), sizeof(text));
+		return 0;
+	}
+	if (strcmp(args[0].word, "RESET") == 0)
+	{
+		frame_latency_reset();
+		command_respond_text(response, MLX_OK);
+		return 0;
+	}
+	if (strcmp(args[0].word, "TRACE") == 0 && arg_count == 2 && (strcmp(args[1].word, "ON") == 0 || strcmp(args[1].word, "OFF") == 0))
+	{
+		frame_latency_set_trace(strcmp(args[1].word, "ON") == 0);
+		command_respond_text(response, MLX_OK);
+		return 0;
+	}
+	int stage = frame_latency_stage(args[0].word);
+	if (arg_count == 1 && stage >= 0)
+	{
+		respond_formatted(response, text, frame_latency_format_stage(stage, text, sizeof(text)), sizeof(text));
+		return 0;
+	}
+	command_respond_text(response, MLX_FAIL);
+	return 0;
+}
+
+// Commands handled by task_queue_msg_handler
+static const Command_type app_commands[] = {
+	{.name = "WHOAMI", .handler = cmd_whoami},
+	{.name = "MLX START", .args = {COMMAND_ARG_INT}, .handler = cmd_mlx_start},
+	{.name = "MLX STOP", .handler = cmd_mlx_stop},
+	{.name = "MLX CREDITS", .handler = cmd_mlx_credits},
+	{.name = "MLX SET", .args = {COMMAND_ARG_WORD, COMMAND_ARG_WORD}, .min_args = 2, .handler = cmd_mlx_set},
+	{.name = "MLX CONFIG", .handler = cmd_mlx_config},
+	{.name = "MLX GOV", .handler = cmd_mlx_gov},
+	{.name = "MLX DEADLINE", .handler = cmd_mlx_deadline},
+	{.name = "MLX TX", .handler = cmd_mlx_tx},
+	{.name = "MLX KEY", .handler = cmd_mlx_key},
+	{.name = "MLX EEPROM", .handler = cmd_mlx_eeprom},
+	{.name = "MLX TRACE", .args = {COMMAND_ARG_WORD}, .handler = cmd_mlx_trace},
+	{.name = "MLX BENCH", .args = {COMMAND_ARG_INT}, .handler = cmd_mlx_bench},
+	{.name = "MLX LATENCY", .args = {COMMAND_ARG_WORD, COMMAND_ARG_WORD}, .handler = cmd_mlx_latency},
+};
+
+/**
+ * @brief Register the application commands
+ *
+ * @return 0 OK
+ * @return command_register error code
+ */
+int app_commands_register(void)
+{
+	return command_register_table(app_commands, sizeof(app_commands) / sizeof(app_commands[0]));
+}
+
 /**
  * @brief Encapsulated message handler
  *
  * Process encapsulated messages received from the uart isr monitoring task.
- * Trigger MLX90640 measuring with character sequence.
+ * Messages are dispatched through the command registry, unknown commands are echoed back after ??.
+ * The response is queued on the uart control channel.
  *
  * @param params
  */
@@ -299,16 +850,10 @@ void task_queue_msg_handler(void *params)
 	const char *TAG = "TSK QUEUE MSG HANDL";
 
 	TaskQueueMessage_type enqueued_message;
-
-	// START SAMPLING
-	const char *MLX_START = "MLX START";
-	// RESPONSES
-	const char *MLX_BUSY = "MLX BUSY";
-	const char *MLX_OK = "MLX OK";
-	// const char *MLX_FAIL = "MLX FAIL";
-	// GENERIC
-	const char *WHOAMI = "WHOAMI";
-	const char *DEVID = "MLX90640";
+	UartTxControl_type control;
+	CommandResponse_type response = {
+		.write = uart_tx_control_append,
+		.context = &control};
 
 	while (1)
 	{
@@ -316,34 +861,31 @@ void task_queue_msg_handler(void *params)
 		{
 			if (enqueued_message.msg_ptr != NULL)
 			{
-				// WHOAMI
-				if (memcmp(enqueued_message.msg_ptr, WHOAMI, (strlen(WHOAMI))) == 0)
+				// Collect the whole response, it is sent as one packet
+				control.size = 0;
+				int error_code = command_dispatch(enqueued_message.msg_ptr, enqueued_message.msg_size, &response);
+				if (error_code == COMMAND_ERR_UNKNOWN || error_code == COMMAND_ERR_TOO_LONG)
+				{
+					command_respond_text(&response, "??");
+					command_respond(&response, enqueued_message.msg_ptr, enqueued_message.msg_size);
+				}
+				else if (error_code == COMMAND_ERR_ARG_COUNT || error_code == COMMAND_ERR_ARG_TYPE)
 				{
-					uart_write_bytes(UART_NUM, DEVID, strlen(DEVID));
+					command_respond_text(&response, MLX_FAIL);
 				}
-				// A START
-				else if (memcmp(enqueued_message.msg_ptr, MLX_START, (strlen(MLX_START))) == 0)
+				else if (error_code != 0)
 				{
-					if (xSemaphoreTake(semphr_request_image, pdMS_TO_TICKS(10)) == pdTRUE)
-					{
-						uart_write_bytes(UART_NUM, MLX_OK, strlen(MLX_OK));
-						xTaskNotifyGive(handl_get_subpages);
-					}
-					else
-					{
-						uart_write_bytes(UART_NUM, MLX_BUSY, strlen(MLX_BUSY));
-					}
+					ESP_LOGW(TAG, "Command failed. Error: %d", error_code);
 				}
-				else
+				myuart_message_release(enqueued_message.msg_ptr);
+				if (control.size > 0 && uart_tx_send_control(&control) != 0)
 				{
-					uart_write_bytes(UART_NUM, "??", strlen("??"));
-					uart_write_bytes(UART_NUM, enqueued_message.msg_ptr, enqueued_message.msg_size);
+					ESP_LOGW(TAG, "Control channel full, response dropped");
 				}
-				free(enqueued_message.msg_ptr);
 			}
 			else
 			{
-				uart_write_bytes(UART_NUM, "Null pointer passed", strlen("Null pointer passed"));
+				uart_tx_send_text("Null pointer passed");
 				ESP_LOGW(TAG, "Null pointer passed");
 			}
 		}
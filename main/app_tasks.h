@@ -14,12 +14,25 @@
 #include "mlx90640_i2c_driver.h"
 #include "custom_mlx_functions.h"
 #include "uart_isr_handler.h"
+#include "uart_tx.h"
+#include "transport.h"
+#include "transport_uart.h"
+#include "transport_usb.h"
+#include "frame_bus.h"
+#include "mlx_protocol.h"
+#include "command_registry.h"
+#include "frame_credits.h"
+#include "mlx_i2c_recorder.h"
+#include "mlx_bench.h"
+
+#define EEPROM_STALL_PERIODS 8 /*!< Subpage periods without a packet after which MLX START in raw mode resends the EEPROM*/
 
 extern SemaphoreHandle_t semphr_request_image;
 
-extern QueueHandle_t queue_uart_isr_event_queue; // UART ISR queue
 extern QueueHandle_t queue_enqueued_msg_processing;
 
+extern Transport_type link_transport;
+
 typedef struct TaskQueueMessage_type
 {
 	size_t msg_size;
@@ -30,12 +43,19 @@ typedef struct TaskQueueMessage_type
 
 extern float *subpage_0;
 extern float *subpage_1;
+extern uint16_t *raw_subpage;
+
+extern FrameBusSubscriber_type *subscriber_uart_frame_data;
 
 // MLX tasks
 void task_initialization(void *params);
 void task_mlx_get_subpages(void *params);
 void task_mlx_merge_subpages(void *params);
 void task_mlx_uart_frame_data(void *params);
+void task_frame_logger(void *params);
+
+// COMMANDS
+int app_commands_register(void);
 
 // UART ISR MONITORING
 void task_uart_isr_monitoring(void *);
@@ -0,0 +1,261 @@
+#include "command_registry.h"
+
+static const Command_type *command_table[COMMAND_MAX_COMMANDS];
+static uint8_t command_count = 0;
+static int8_t command_hash_table[COMMAND_HASH_SIZE]; // command_table index + 1, 0 empty
+
+/**
+ * @brief FNV-1a hash of a command name
+ */
+static uint32_t command_hash(const char *name, size_t name_size)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < name_size; i++)
+	{
+		hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief Find the command with the exact name
+ *
+ * @param name command name, not null terminated
+ * @param name_size name length
+ * @return const Command_type* registered command
+ * @return NULL unknown command
+ */
+const Command_type *command_find(const char *name, size_t name_size)
+{
+	uint32_t slot = command_hash(name, name_size) & (COMMAND_HASH_SIZE - 1);
+	for (int probe = 0; probe < COMMAND_HASH_SIZE; probe++)
+	{
+		int8_t entry = command_hash_table[slot];
+		if (entry == 0)
+		{
+			return NULL;
+		}
+		const Command_type *command = command_table[entry - 1];
+		if (strlen(command->name) == name_size && memcmp(command->name, name, name_size) == 0)
+		{
+			return command;
+		}
+		slot = (slot + 1) & (COMMAND_HASH_SIZE - 1);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Add a command to the registry
+ *
+ * Register commands before the message handler task starts, the registry is not locked.
+ *
+ * @param command command definition, must stay valid while registered
+ * @return 0 OK
+ * @return -1 null pointer, empty name or no handler
+ * @return -2 registry full
+ * @return -3 name already registered
+ * @return -4 bad argument schema
+ */
+int command_register(const Command_type *command)
+{
+	if (command == NULL || command->name == NULL || command->name[0] == '\0' || command->handler == NULL)
+	{
+		return -1;
+	}
+	if (command_count >= COMMAND_MAX_COMMANDS)
+	{
+		return -2;
+	}
+	size_t name_size = strlen(command->name);
+	if (command_find(command->name, name_size) != NULL)
+	{
+		return -3;
+	}
+	uint8_t arg_count = 0;
+	while (arg_count < COMMAND_MAX_ARGS && command->args[arg_count] != COMMAND_ARG_NONE)
+	{
+		if (command->args[arg_count] > COMMAND_ARG_FLOAT)
+		{
+			return -4;
+		}
+		arg_count++;
+	}
+	if (command->min_args > arg_count)
+	{
+		return -4;
+	}
+
+	uint32_t slot = command_hash(command->name, name_size) & (COMMAND_HASH_SIZE - 1);
+	while (command_hash_table[slot] != 0)
+	{
+		slot = (slot + 1) & (COMMAND_HASH_SIZE - 1);
+	}
+	command_table[command_count] = command;
+	command_hash_table[slot] = ++command_count;
+	return 0;
+}
+
+/**
+ * @brief Register an array of commands
+ *
+ * @return 0 OK
+ * @return command_register error of the first failed command
+ */
+int command_register_table(const Command_type *commands, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		int error_code = command_register(&commands[i]);
+		if (error_code != 0)
+		{
+			return error_code;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Parse a word according to its schema type
+ *
+ * @return 0 OK
+ * @return -1 not a valid number
+ */
+static int command_parse_arg(CommandArg_type *arg, uint8_t type, const char *word)
+{
+	char *end = NULL;
+
+	arg->type = type;
+	arg->word = word;
+	arg->integer = 0;
+	arg->number = 0;
+	switch (type)
+	{
+	case COMMAND_ARG_INT:
+		arg->integer = (int32_t)strtol(word, &end, 0);
+		return (end != word && *end == '\0') ? 0 : -1;
+	case COMMAND_ARG_FLOAT:
+		arg->number = strtof(word, &end);
+		return (end != word && *end == '\0') ? 0 : -1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Look up the command of a message, parse its arguments and run its handler
+ *
+ * Words are separated by one or more spaces. The longest registered name made of the first words wins,
+ * the remaining words are the arguments.
+ *
+ * @param message received message, not null terminated
+ * @param message_size message length
+ * @param response response writer passed to the handler
+ * @return handler return value, 0 OK
+ * @return COMMAND_ERR_TOO_LONG message too long or empty
+ * @return COMMAND_ERR_UNKNOWN unknown command
+ * @return COMMAND_ERR_ARG_COUNT wrong number of arguments
+ * @return COMMAND_ERR_ARG_TYPE argument does not match its type
+ */
+int command_dispatch(const uint8_t *message, size_t message_size, CommandResponse_type *response)
+{
+	char text[COMMAND_MAX_LENGTH + 1];
+	char *words[COMMAND_MAX_NAME_WORDS + COMMAND_MAX_ARGS + 1];
+	uint8_t word_count = 0;
+
+	if (message == NULL || message_size == 0 || message_size > COMMAND_MAX_LENGTH)
+	{
+		return COMMAND_ERR_TOO_LONG;
+	}
+	memcpy(text, message, message_size);
+	text[message_size] = '\0';
+
+	// Split into null terminated words
+	char *cursor = text;
+	while (*cursor != '\0' && word_count < sizeof(words) / sizeof(words[0]))
+	{
+		while (*cursor == ' ')
+		{
+			*cursor++ = '\0';
+		}
+		if (*cursor == '\0')
+		{
+			break;
+		}
+		words[word_count++] = cursor;
+		while (*cursor != ' ' && *cursor != '\0')
+		{
+			cursor++;
+		}
+	}
+	if (word_count == 0)
+	{
+		return COMMAND_ERR_TOO_LONG;
+	}
+	if (*cursor != '\0')
+	{
+		return COMMAND_ERR_ARG_COUNT;
+	}
+
+	// Try the longest name first, name words are joined by single spaces
+	const Command_type *command = NULL;
+	uint8_t name_words = (word_count < COMMAND_MAX_NAME_WORDS) ? word_count : COMMAND_MAX_NAME_WORDS;
+	while (name_words > 0)
+	{
+		char name[COMMAND_MAX_LENGTH + 1];
+		size_t name_size = 0;
+		for (uint8_t i = 0; i < name_words; i++)
+		{
+			size_t word_size = strlen(words[i]);
+			if (i > 0)
+			{
+				name[name_size++] = ' ';
+			}
+			memcpy(&name[name_size], words[i], word_size);
+			name_size += word_size;
+		}
+		if ((command = command_find(name, name_size)) != NULL)
+		{
+			break;
+		}
+		name_words--;
+	}
+	if (command == NULL)
+	{
+		return COMMAND_ERR_UNKNOWN;
+	}
+
+	CommandArg_type args[COMMAND_MAX_ARGS];
+	uint8_t arg_count = word_count - name_words;
+	if (arg_count < command->min_args || arg_count > COMMAND_MAX_ARGS || (arg_count > 0 && command->args[arg_count - 1] == COMMAND_ARG_NONE))
+	{
+		return COMMAND_ERR_ARG_COUNT;
+	}
+	for (uint8_t i = 0; i < arg_count; i++)
+	{
+		if (command_parse_arg(&args[i], command->args[i], words[name_words + i]) != 0)
+		{
+			return COMMAND_ERR_ARG_TYPE;
+		}
+	}
+	return command->handler(args, arg_count, response);
+}
+
+/**
+ * @brief Write response bytes
+ */
+void command_respond(CommandResponse_type *response, const void *data, size_t size)
+{
+	if (response != NULL && response->write != NULL && size > 0)
+	{
+		response->write(response->context, data, size);
+	}
+}
+
+/**
+ * @brief Write a null terminated response
+ */
+void command_respond_text(CommandResponse_type *response, const char *text)
+{
+	command_respond(response, text, strlen(text));
+}
@@ -0,0 +1,68 @@
+#ifndef COMMAND_REGISTRY_H
+#define COMMAND_REGISTRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMMAND_MAX_COMMANDS 24	 /*!< Registered commands*/
+#define COMMAND_HASH_SIZE 64	 /*!< Hash table slots, power of two, more than COMMAND_MAX_COMMANDS*/
+#define COMMAND_MAX_ARGS 4		 /*!< Arguments per command*/
+#define COMMAND_MAX_NAME_WORDS 2 /*!< Command names are one or two words, e.g. WHOAMI, MLX START*/
+#define COMMAND_MAX_LENGTH 127	 /*!< Longest accepted command line*/
+
+#define COMMAND_ARG_NONE 0	/*!< Unused schema entry*/
+#define COMMAND_ARG_WORD 1	/*!< Any word*/
+#define COMMAND_ARG_INT 2	/*!< Decimal or 0x hex integer*/
+#define COMMAND_ARG_FLOAT 3 /*!< Decimal number*/
+
+// command_dispatch errors, below any handler error code
+#define COMMAND_ERR_TOO_LONG (-100)  /*!< Message too long or empty*/
+#define COMMAND_ERR_UNKNOWN (-101)   /*!< No registered command matches*/
+#define COMMAND_ERR_ARG_COUNT (-102) /*!< Wrong number of arguments*/
+#define COMMAND_ERR_ARG_TYPE (-103)  /*!< Argument does not match its type*/
+
+/**
+ * @brief Parsed argument, word is always set, integer / number for the matching schema types
+ */
+typedef struct CommandArg_type
+{
+	uint8_t type;
+	const char *word;
+	int32_t integer;
+	float number;
+} CommandArg_type;
+
+/**
+ * @brief Destination of command responses, e.g. a uart port
+ */
+typedef struct CommandResponse_type
+{
+	void (*write)(void *context, const void *data, size_t size);
+	void *context;
+} CommandResponse_type;
+
+typedef int (*CommandHandler_type)(const CommandArg_type *args, uint8_t arg_count, CommandResponse_type *response);
+
+/**
+ * @brief Command definition
+ *
+ * args lists the argument types, the first min_args of them are required.
+ */
+typedef struct Command_type
+{
+	const char *name;
+	uint8_t args[COMMAND_MAX_ARGS];
+	uint8_t min_args;
+	CommandHandler_type handler;
+} Command_type;
+
+int command_register(const Command_type *command);
+int command_register_table(const Command_type *commands, size_t count);
+const Command_type *command_find(const char *name, size_t name_size);
+int command_dispatch(const uint8_t *message, size_t message_size, CommandResponse_type *response);
+void command_respond(CommandResponse_type *response, const void *data, size_t size);
+void command_respond_text(CommandResponse_type *response, const char *text);
+
+#endif // COMMAND_REGISTRY_H
@@ -1,3 +1,13 @@
 #include "constants.h"
 
-const int DELAY_BETWEEN_SUBPAGES = MLX_REFRESH_MILLIS * 0.9;
\ No newline at end of file
+// Subpage period in milliseconds, indexed by the refresh rate control register value
+const uint16_t MLX_REFRESH_MILLIS_LUT[8] = {
+    MLX_0_5_HZ_MILLIS,
+    MLX_1_HZ_MILLIS,
+    MLX_2_HZ_MILLIS,
+    MLX_4_HZ_MILLIS,
+    MLX_8_HZ_MILLIS,
+    MLX_16_HZ_MILLIS,
+    MLX_32_HZ_MILLIS,
+    MLX_64_HZ_MILLIS,
+};
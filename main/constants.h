@@ -1,7 +1,9 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
+#include <stdint.h>
+
 // ----------------- Constants -----------------
-extern const int DELAY_BETWEEN_SUBPAGES;
+extern const uint16_t MLX_REFRESH_MILLIS_LUT[8];
 
 #define I2C_SCL_IO CONFIG_I2C_MASTER_SCL // GPIO number used for I2C master clock
 #define I2C_SDA_IO CONFIG_I2C_MASTER_SDA // GPIO number used for I2C master data
@@ -10,18 +12,22 @@ extern const int DELAY_BETWEEN_SUBPAGES;
 #define I2C_TIMEOUT_MS 1000				 // I2C timeout in milliseconds
 #define MLX90640_SLAVE_ADR 0x33
 #define MLX_FRAME_SIZE 768
+#define MLX_RAW_SUBPAGE_SIZE 834 // words of MLX90640_GetFrameData: pixels, aux, control register, subpage
 
 // Stack sizes
 #define TASK_INIT_STACK_SIZE (1024*5)
 #define TASK_GET_SUBPAGES_STACK_SIZE (1024*4)
-#define TASK_UART_FRAME_DATA_STACK_SIZE (1024*2)
+#define TASK_UART_FRAME_DATA_STACK_SIZE (1024*4)
 #define TASK_MERGE_SUBPAGES_STACK_SIZE (1024*2)
 #define TASK_ISRUART_STACK_SIZE (1024*2)
-#define TASK_MSG_Q_STACK_SIZE (1024*2)
+#define TASK_MSG_Q_STACK_SIZE (1024*3)
+#define TASK_FRAME_LOGGER_STACK_SIZE (1024*2)
 #define DEBUG_STACKS 0
+#define FRAME_LOGGER 0 // 1 to log min/mean/max of every published frame
 
 // ############################# REFRESH CONFIGURATION #############################
 // --------- UNCOMMENT ONE OF THE FOLLOWING LINES TO SET THE REFRESH RATE ---------
+// --------- (startup value, can be changed at runtime with MLX SET RATE) ---------
 // #define MLX_REFRESH_1_HZ 0x01
 // #define MLX_REFRESH_2_HZ 0x02
 // #define MLX_REFRESH_4_HZ 0x03
@@ -31,9 +37,52 @@ extern const int DELAY_BETWEEN_SUBPAGES;
 // #define MLX_REFRESH_64_HZ 0x07
 // #################################################################################
 
+// ########################### MEASUREMENT CONFIGURATION ###########################
+// Startup values, all of them can be changed at runtime with the MLX SET command
+#define MLX_RESOLUTION MLX_RESOLUTION_18_BIT
+#define MLX_PATTERN MLX_PATTERN_CHESS
+#define MLX_EMISSIVITY 0.97f
+#define MLX_TA_OFFSET -8 // ambient temperature offset in °C
+// #################################################################################
+
+// ############################# OUTPUT CONFIGURATION ##############################
+// MLX_OUTPUT_FULL_FRAME: a frame is published after both subpages are read
+// MLX_OUTPUT_SUBPAGE: a deinterlaced frame is published after every subpage
+// MLX_OUTPUT_RAW: the raw words of every subpage are published, the host calibrates them
+#define MLX_OUTPUT_MODE MLX_OUTPUT_FULL_FRAME // MLX SET OUT FULL|HOLD|INTERP|RAW at runtime
+// MLX_DEINTERLACE_HOLD: missing pixels keep the values of the previous subpage
+// MLX_DEINTERLACE_INTERPOLATE: missing pixels are averaged from their neighbours
+#define MLX_DEINTERLACE_METHOD MLX_DEINTERLACE_HOLD
+// 1: step the refresh rate to the highest rate the pipeline sustains (MLX SET GOV ON|OFF at runtime)
+#define MLX_GOVERNOR 0
+// MLX_PIXEL_FLOAT32, MLX_PIXEL_FLOAT16, MLX_PIXEL_INT16 or MLX_PIXEL_UINT8 (MLX SET FORMAT F32|F16|I16|U8 at runtime)
+#define MLX_PIXEL_FORMAT MLX_PIXEL_FLOAT32
+// MLX_TRANSPORT_UART: UART_NUM at UART_BAUD
+// MLX_TRANSPORT_USB_SERIAL_JTAG: built-in USB port at USB full speed, no link backpressure
+#define MLX_TRANSPORT MLX_TRANSPORT_UART
+// #################################################################################
+
 // DONT COMMENT OR CHANGE THESE VALUES
 #define MLX_REFRESH_0_5_HZ 0x00 // default refresh rate mask.
 
+#define MLX_RESOLUTION_16_BIT 0x00
+#define MLX_RESOLUTION_17_BIT 0x01
+#define MLX_RESOLUTION_18_BIT 0x02
+#define MLX_RESOLUTION_19_BIT 0x03
+#define MLX_PATTERN_INTERLEAVED 0
+#define MLX_PATTERN_CHESS 1
+#define MLX_SUBPAGE_DELAY_PERCENT 90 // share of the refresh period to sleep between subpages
+
+#define MLX_OUTPUT_FULL_FRAME 0
+#define MLX_OUTPUT_SUBPAGE 1
+#define MLX_OUTPUT_RAW 2
+#define MLX_DEINTERLACE_HOLD 0
+#define MLX_DEINTERLACE_INTERPOLATE 1
+#define MLX_ANY_SUBPAGE 0xFF // accept whichever subpage the sensor delivers next
+
+#define MLX_TRANSPORT_UART 0
+#define MLX_TRANSPORT_USB_SERIAL_JTAG 1
+
 #define MLX_0_5_HZ_MILLIS 2000
 #define MLX_1_HZ_MILLIS 1000
 #define MLX_2_HZ_MILLIS 500
@@ -30,161 +30,655 @@ paramsMLX90640 mlx90640_params = {
     .outlierPixels = {0},
 };
 
+// MLX SET FORMAT values, indexed by MLX_PIXEL_* format
+static const char *pixel_format_names[MLX_PIXEL_FORMATS] = {"F32", "F16", "I16", "U8", "DELTA"};
+
+// Inter-frame encoder state of the output stream
+static FrameCodec_type frame_codec = {
+    .step = FRAME_CODEC_STEP,
+    .key_interval = FRAME_CODEC_KEY_INTERVAL,
+};
+
+// Sensor ambient temperature of the last calculated subpage, without ambient_offset
+float mlx_ambient_temperature = 0;
+
+// EEPROM words read by mlx_read_extract_eeprom, sent to the host before raw subpages
+uint16_t mlx_eeprom_dump[MLX90640_EEPROM_DUMP_NUM];
+
+// Raw subpages, both are kept when calibration is deferred until after the second read
+static uint16_t subpage_raw_data[2][834];
+
+MlxConfig_type mlx_config = {
+    .refresh_rate = MLX_REFRESH_RATE,
+    .resolution = MLX_RESOLUTION,
+    .pattern = MLX_PATTERN,
+    .emissivity = MLX_EMISSIVITY,
+    .ambient_offset = MLX_TA_OFFSET,
+    .output_mode = MLX_OUTPUT_MODE,
+    .deinterlace_method = MLX_DEINTERLACE_METHOD,
+    .governor = MLX_GOVERNOR,
+    .pixel_format = MLX_PIXEL_FORMAT,
+    .refresh_millis = MLX_REFRESH_MILLIS,
+    .subpage_delay_millis = MLX_REFRESH_MILLIS * MLX_SUBPAGE_DELAY_PERCENT / 100,
+};
+
 /**
  * @brief Delay the correct ammount of time after power on reset.
  *
  */
 void mlx_delay_after_por()
 {
-    vTaskDelay(pdMS_TO_TICKS(MLX_REFRESH_MILLIS * 2 + 80));
+    vTaskDelay(pdMS_TO_TICKS(MLX90640_GetRefreshMillis() * 2 + 80));
 }
 
 /**
  * @brief Read and extract EEPROM data.
  *
  * Read the EEPROM data and extract the parameters.
- * The extracted parameters are stored in paramsMLX90640 struct.
+ * The extracted parameters are stored in paramsMLX90640 struct, the dump is kept in mlx_eeprom_dump
+ * for hosts that calibrate raw subpages themselves.
  *
  * @return 0 OK
- * @return -1 Failed to allocate memory for eeprom_dump
- * @return -2 Failed to dump EEPROM data
- * @return -3 Failed to extract EEPROM data from dump
+ * @return -1 Failed to dump EEPROM data
+ * @return -2 Failed to extract EEPROM data from dump
  */
 int mlx_read_extract_eeprom()
 {
-    // create a temporary eeprom_dump of uint16_t type that will get deleted afterwards
-    uint16_t *eeprom_dump = (uint16_t *)calloc(832, sizeof(uint16_t));
-    if (eeprom_dump == NULL)
-    {
-        return -1;
-    }
-
     // Dump EEPROM data
-    if (MLX90640_DumpEE(MLX90640_SLAVE_ADR, eeprom_dump) != 0)
+    if (MLX90640_DumpEE(MLX90640_SLAVE_ADR, mlx_eeprom_dump) != 0)
     {
-        free(eeprom_dump);
-        return -2;
+        return -1;
     }
 
     // Extract EEPROM data
-    if (MLX90640_ExtractParameters(eeprom_dump, &mlx90640_params) != 0)
+    if (MLX90640_ExtractParameters(mlx_eeprom_dump, &mlx90640_params) != 0)
     {
-        free(eeprom_dump);
-        return -3;
+        return -2;
     }
-
-    free(eeprom_dump); // Free EEPROM dump memory as soon as it is no longer needed
     return 0;
 }
 
 /**
- * @brief Read raw frame data and calculate temperatures.
+ * @brief Read raw subpage data.
  *
- * Raw subpage sensor data is read into temp array and then the temperatures stored into the subpage_temps array.
+ * Blocks until the sensor flags new data, then reads the pixel, aux and control words.
  *
- * @param subpage_temps: pointer to the array of temperatures (768 floats)
+ * @param subpage_raw_data: pointer to the raw data array (834 words)
+ * @param desired_subpage_number: 0, 1 or MLX_ANY_SUBPAGE
  * @return frame_number: int 0 or 1
+ * @return -1 subpage_raw_data is NULL
+ * @return -3 failed to read or wrong subpage
  */
-int mlx_get_subpage_temps(float *subpage_temps, float emissivity, int8_t ambient_offset, uint8_t desired_subpage_number, TickType_t *last_wake_time)
+int mlx_read_subpage_raw(uint16_t *subpage_raw_data, uint8_t desired_subpage_number, TickType_t *last_wake_time)
 {
-    const char *TAG = "mlx_get_subpage_temps";
-    if (subpage_temps == NULL)
-    {
-        ESP_LOGE(TAG, "subpage_temps is NULL!");
-        return -1;
-    }
-
-    uint16_t *subpage_raw_data = (uint16_t *)calloc(834, sizeof(uint16_t));
+    const char *TAG = "mlx_read_subpage_raw";
     if (subpage_raw_data == NULL)
     {
-        ESP_LOGE(TAG, "frame_data is NULL!");
-        return -2;
+        ESP_LOGE(TAG, "subpage_raw_data is NULL!");
+        return -1;
     }
 
-    // MLX90640_SynchFrame(MLX90640_SLAVE_ADR);
     int subpage_number = MLX90640_GetFrameData(MLX90640_SLAVE_ADR, subpage_raw_data, last_wake_time);
-    if (subpage_number != desired_subpage_number)
+    if (subpage_number < 0 || (desired_subpage_number != MLX_ANY_SUBPAGE && subpage_number != desired_subpage_number))
     {
         ESP_LOGE(TAG, "Wrong subpage: (wanted: %d, read: %d)", desired_subpage_number, subpage_number);
-        free(subpage_raw_data);
         return -3;
     }
+    frame_governor_record_acquisition(esp_timer_get_time() - MLX90640_GetDataReadyTime());
+    frame_latency_mark(MLX_LATENCY_READ_0 + 2 * subpage_number);
+    return subpage_number;
+}
+
+/**
+ * @brief Calculate the temperatures of a raw subpage.
+ *
+ * Only the pixels of the raw subpage are written to subpage_temps (plus the corrected bad pixels).
+ * The chess/interleaved mode is taken from the control register copy in the raw data.
+ *
+ * @param subpage_raw_data: pointer to the raw data array (834 words)
+ * @param subpage_temps: pointer to the array of temperatures (768 floats)
+ * @param emissivity: emissivity of the object
+ * @param ambient_offset: offset to the ambient temperature
+ * @return 0 OK
+ * @return -1 null pointer passed
+ */
+int mlx_calculate_subpage_temps(uint16_t *subpage_raw_data, float *subpage_temps, float emissivity, int8_t ambient_offset)
+{
+    const char *TAG = "mlx_calculate_subpage_temps";
+    if (subpage_raw_data == NULL || subpage_temps == NULL)
+    {
+        ESP_LOGE(TAG, "subpage_raw_data or subpage_temps is NULL!");
+        return -1;
+    }
+
+    int64_t compute_start = esp_timer_get_time();
 
     // Get the ambient temperature
     float ambient_temperature = MLX90640_GetTa(subpage_raw_data, &mlx90640_params);
+    mlx_ambient_temperature = ambient_temperature;
     ambient_temperature += ambient_offset; // offset the ambient temperature
     ESP_LOGD(TAG, "Ambient temp: %.2f °C", ambient_temperature);
 
     // Calculate subpage temperatures
     MLX90640_CalculateTo(subpage_raw_data, &mlx90640_params, emissivity, ambient_temperature, subpage_temps);
-    // Free the raw data memory as soon as it is no longer needed
-    free(subpage_raw_data);
 
-    // Get the current mode of the sensor
-    int mode = MLX90640_GetCurMode(MLX90640_SLAVE_ADR);
+    // Mode of the sensor when the subpage was measured
+    int mode = (subpage_raw_data[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
     // Correct the broken or missing pixel values
     MLX90640_BadPixelsCorrection(mlx90640_params.brokenPixels, subpage_temps, mode, &mlx90640_params);
     MLX90640_BadPixelsCorrection(mlx90640_params.outlierPixels, subpage_temps, mode, &mlx90640_params);
+
+    frame_governor_record_compute(esp_timer_get_time() - compute_start);
+    frame_latency_mark(MLX_LATENCY_CALC_0 + 2 * (subpage_raw_data[833] & 1));
+    return 0;
+}
+
+/**
+ * @brief Read raw frame data and calculate temperatures.
+ *
+ * Raw subpage sensor data is read into temp array and then the temperatures stored into the subpage_temps array.
+ *
+ * @param subpage_temps: pointer to the array of temperatures (768 floats)
+ * @param desired_subpage_number: 0, 1 or MLX_ANY_SUBPAGE
+ * @return frame_number: int 0 or 1
+ */
+int mlx_get_subpage_temps(float *subpage_temps, float emissivity, int8_t ambient_offset, uint8_t desired_subpage_number, TickType_t *last_wake_time)
+{
+    const char *TAG = "mlx_get_subpage_temps";
+    if (subpage_temps == NULL)
+    {
+        ESP_LOGE(TAG, "subpage_temps is NULL!");
+        return -1;
+    }
+
+    int subpage_number = mlx_read_subpage_raw(subpage_raw_data[0], desired_subpage_number, last_wake_time);
+    if (subpage_number < 0)
+    {
+        return subpage_number;
+    }
+    mlx_calculate_subpage_temps(subpage_raw_data[0], subpage_temps, emissivity, ambient_offset);
     return subpage_number;
 }
 
 /**
  * @brief Read both subpages and calculate the temperatures.
  *
+ * Every stage is checked against the sensor period (see mlx_deadline). Subpage 0 is calculated
+ * before subpage 1 is read, unless that calculation would not finish before subpage 1 is ready.
+ * Then both raw subpages are read first and calculated afterwards. If the sensor already delivered
+ * the next subpage 0 while waiting for subpage 1, the frame slips by one subpage instead of failing.
+ *
  * @param subpage_temps_0: pointer to the array of subpage temperatures (at least 768 long)
  * @param subpage_temps_1: pointer to the array of subpage temperatures (at least 768 long)
  * @param emissivity: emissivity of the object
  * @param ambient_offset: offset to the ambient temperature
- * @return int
+ * @return 0 OK
+ * @return -1 failed to read subpage 0
+ * @return -2 failed to read subpage 1
  */
 int mlx_read_full_picture(float *subpage_temps_0, float *subpage_temps_1, float emissivity, int8_t ambient_offset, TickType_t *last_wake_time)
 {
     const char *TAG = "mlx_read_full_picture";
 
+    uint16_t *raw_0 = subpage_raw_data[0];
+    uint16_t *raw_1 = subpage_raw_data[1];
+    int64_t period_us = (int64_t)mlx_config.refresh_millis * 1000;
+    bool missed = false;
+    bool slipped = false;
     int page_number = -404;
 
     // Read subpage 0
-    page_number = mlx_get_subpage_temps(subpage_temps_0, emissivity, ambient_offset, 0, last_wake_time);
+    page_number = mlx_read_subpage_raw(raw_0, 0, last_wake_time);
     if (page_number != 0)
     {
         ESP_LOGE(TAG, "Failed to read subpage 0. Error: %d", page_number);
         return -1;
     }
-    xTaskDelayUntil(last_wake_time, pdMS_TO_TICKS(DELAY_BETWEEN_SUBPAGES));
+    int64_t ready_0 = MLX90640_GetDataReadyTime();
+    int32_t read_0_slack = mlx_deadline_record(DEADLINE_READ_0, ready_0 + period_us, esp_timer_get_time());
+    missed |= read_0_slack < 0;
+
+    // Calculate subpage 0 only if it finishes before subpage 1 is ready
+    bool deferred = mlx_deadline.defer_calibration || (read_0_slack < (int32_t)frame_governor.compute_us);
+    if (!deferred)
+    {
+        mlx_calculate_subpage_temps(raw_0, subpage_temps_0, emissivity, ambient_offset);
+        missed |= mlx_deadline_record(DEADLINE_CALC_0, ready_0 + period_us, esp_timer_get_time()) < 0;
+    }
+    xTaskDelayUntil(last_wake_time, pdMS_TO_TICKS(mlx_config.subpage_delay_millis));
 
     // Read subpage 1
-    page_number = mlx_get_subpage_temps(subpage_temps_1, emissivity, ambient_offset, 1, last_wake_time);
+    page_number = mlx_read_subpage_raw(raw_1, MLX_ANY_SUBPAGE, last_wake_time);
+    if (page_number == 0)
+    {
+        // Too late for subpage 1, start the frame over from the fresh subpage 0
+        ESP_LOGW(TAG, "Subpage 1 missed, slipping one subpage");
+        slipped = true;
+        deferred = true;
+        raw_0 = subpage_raw_data[1];
+        raw_1 = subpage_raw_data[0];
+        ready_0 = MLX90640_GetDataReadyTime();
+        page_number = mlx_read_subpage_raw(raw_1, 1, last_wake_time);
+    }
     if (page_number != 1)
     {
         ESP_LOGE(TAG, "mlx_read_full_picture: Failed to read subpage 1. Error: %d", page_number);
         return -2;
     }
+    missed |= mlx_deadline_record(DEADLINE_READ_1, ready_0 + 2 * period_us, esp_timer_get_time()) < 0;
+
+    if (deferred)
+    {
+        mlx_calculate_subpage_temps(raw_0, subpage_temps_0, emissivity, ambient_offset);
+        mlx_deadline_record(DEADLINE_CALC_0, ready_0 + 2 * period_us, esp_timer_get_time());
+        mlx_deadline.deferred_frames++;
+    }
+    mlx_calculate_subpage_temps(raw_1, subpage_temps_1, emissivity, ambient_offset);
+    missed |= mlx_deadline_record(DEADLINE_CALC_1, ready_0 + 2 * period_us, esp_timer_get_time()) < 0;
+
+    mlx_deadline_end_frame(missed, slipped, read_0_slack - (int32_t)frame_governor.compute_us);
+    return 0;
+}
+
+/**
+ * @brief Check which subpage a pixel belongs to.
+ *
+ * @param pixel: pixel index (0 - 767)
+ * @param mode: 0 interleaved, 1 chess pattern
+ * @return int 0 or 1
+ */
+static int mlx_pixel_subpage(int pixel, int mode)
+{
+    int row_parity = (pixel / MLX90640_LINE_SIZE) & 1;
+    if (mode == 0)
+    {
+        return row_parity;
+    }
+    return row_parity ^ (pixel & 1);
+}
+
+/**
+ * @brief Fill the pixels of the missing subpage.
+ *
+ * frame_temps holds freshly calculated temperatures for subpage_number. Pixels of the other subpage
+ * are either left as they are (previous subpage values) or interpolated from the neighbouring pixels
+ * of the fresh subpage. Interpolation only reads fresh pixels, so it is done in place.
+ *
+ * @param frame_temps: pointer to the array of frame temperatures (768 floats)
+ * @param subpage_number: subpage that was just calculated (0 or 1)
+ * @param mode: 0 interleaved, 1 chess pattern
+ * @param method: MLX_DEINTERLACE_HOLD or MLX_DEINTERLACE_INTERPOLATE
+ * @return 0 OK
+ * @return -1 frame_temps is NULL
+ * @return -2 unknown method
+ */
+int mlx_deinterlace_subpage(float *frame_temps, int subpage_number, int mode, uint8_t method)
+{
+    if (frame_temps == NULL)
+    {
+        return -1;
+    }
+    if (method == MLX_DEINTERLACE_HOLD)
+    {
+        return 0;
+    }
+    if (method != MLX_DEINTERLACE_INTERPOLATE)
+    {
+        return -2;
+    }
+
+    for (int pixel = 0; pixel < MLX90640_PIXEL_NUM; pixel++)
+    {
+        if (mlx_pixel_subpage(pixel, mode) == subpage_number)
+        {
+            continue;
+        }
+
+        int line = pixel / MLX90640_LINE_SIZE;
+        int column = pixel % MLX90640_LINE_SIZE;
+        float sum = 0;
+        int count = 0;
+
+        // Rows above and below always belong to the fresh subpage
+        if (line > 0)
+        {
+            sum += frame_temps[pixel - MLX90640_LINE_SIZE];
+            count++;
+        }
+        if (line < MLX90640_LINE_NUM - 1)
+        {
+            sum += frame_temps[pixel + MLX90640_LINE_SIZE];
+            count++;
+        }
+        // In chess mode the left and right neighbours belong to the fresh subpage as well
+        if (mode != 0)
+        {
+            if (column > 0)
+            {
+                sum += frame_temps[pixel - 1];
+                count++;
+            }
+            if (column < MLX90640_COLUMN_NUM - 1)
+            {
+                sum += frame_temps[pixel + 1];
+                count++;
+            }
+        }
+        frame_temps[pixel] = sum / count;
+    }
     return 0;
 }
 
 /**
- * @brief Merge both subpages into subpage_temps_0.
+ * @brief Read the next available subpage and publish it as a full frame.
  *
- * Temperatures from subpage 0 and 1 are add together and stored in subpage_temps_0.
+ * No frame synchronization is needed, whichever subpage is ready next gets calculated into frame_temps
+ * and the other half of the frame is filled with mlx_deinterlace_subpage.
  *
- * @param subpage_temps_0
- * @param subpage_temps_1
- * @return int
+ * @param frame_temps: pointer to the array of frame temperatures (768 floats), kept between calls
+ * @param emissivity: emissivity of the object
+ * @param ambient_offset: offset to the ambient temperature
+ * @param method: MLX_DEINTERLACE_HOLD or MLX_DEINTERLACE_INTERPOLATE
+ * @return 0 or 1 subpage number that was read
+ * @return -1 failed to read the subpage
+ * @return -2 failed to deinterlace the frame
  */
-int mlx_merge_subpages(float *subpage_temps_0, float *subpage_temps_1)
+int mlx_read_deinterlaced_frame(float *frame_temps, float emissivity, int8_t ambient_offset, uint8_t method, TickType_t *last_wake_time)
 {
-    const char *TAG = "mlx_merge_subpages";
+    const char *TAG = "mlx_read_deinterlaced_frame";
 
-    if (subpage_temps_0 == NULL || subpage_temps_1 == NULL)
+    int subpage_number = mlx_read_subpage_raw(subpage_raw_data[0], MLX_ANY_SUBPAGE, last_wake_time);
+    if (subpage_number < 0)
+    {
+        ESP_LOGE(TAG, "Failed to read subpage. Error: %d", subpage_number);
+        return -1;
+    }
+    int64_t ready = MLX90640_GetDataReadyTime();
+    int64_t period_us = (int64_t)mlx_config.refresh_millis * 1000;
+    bool missed = mlx_deadline_record(DEADLINE_READ_0, ready + period_us, esp_timer_get_time()) < 0;
+
+    mlx_calculate_subpage_temps(subpage_raw_data[0], frame_temps, emissivity, ambient_offset);
+    int mode = (subpage_raw_data[0][832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
+    if (mlx_deinterlace_subpage(frame_temps, subpage_number, mode, method) != 0)
+    {
+        ESP_LOGE(TAG, "Failed to deinterlace subpage %d", subpage_number);
+        return -2;
+    }
+    // Every subpage is a frame of its own, it has to be published before the next one is ready
+    missed |= mlx_deadline_record(DEADLINE_CALC_0, ready + period_us, esp_timer_get_time()) < 0;
+    mlx_deadline.frames++;
+    mlx_deadline.misses += missed;
+    return subpage_number;
+}
+
+/**
+ * @brief Delta encode the merged frame against the last key frame.
+ *
+ * Frames that do not compress below the int16 size are sent as MLX_PIXEL_INT16 instead,
+ * which also bounds the encode time. The next frame is then a key frame.
+ *
+ * @param frame_temps: merged frame temperatures (768 floats)
+ * @param pixel_format: set to MLX_PIXEL_DELTA or MLX_PIXEL_INT16
+ * @param encoded: encoded output pixels
+ * @param encoded_size: encoded buffer size, at least 768 * 2 bytes
+ * @param offset: decoding offset
+ * @param scale: quantization step or int16 scale
+ * @return encoded frame size in bytes
+ */
+int mlx_delta_encode_frame(const float *frame_temps, uint8_t *pixel_format, void *encoded, size_t encoded_size, float *offset, float *scale)
+{
+    size_t budget = MLX_FRAME_SIZE * pixel_format_size(MLX_PIXEL_INT16);
+    int size = frame_codec_encode(&frame_codec, frame_temps, encoded, (encoded_size < budget) ? encoded_size : budget);
+    if (size < 0)
+    {
+        *pixel_format = MLX_PIXEL_INT16;
+        return pixel_encode(frame_temps, MLX_FRAME_SIZE, MLX_PIXEL_INT16, encoded, offset, scale);
+    }
+    *pixel_format = MLX_PIXEL_DELTA;
+    *offset = 0;
+    *scale = frame_codec.step;
+    return size;
+}
+
+/**
+ * @brief Make the next delta encoded frame a key frame, e.g. after the host lost a packet.
+ */
+void mlx_delta_force_key(void)
+{
+    frame_codec.force_key = true;
+}
+
+/**
+ * @brief Write the sensor settings of new_config and make it the active configuration.
+ *
+ * Only the settings that differ from the active configuration are written, unless force is set.
+ * The caller must make sure no frame is being read while the sensor settings change.
+ *
+ * @param new_config: configuration to apply
+ * @param force: write all sensor settings
+ * @return 0 OK
+ * @return -1 new_config is NULL
+ * @return -2 failed to set refresh rate
+ * @return -3 failed to set resolution
+ * @return -4 failed to set chess or interleaved mode
+ */
+int mlx_config_apply(const MlxConfig_type *new_config, bool force)
+{
+    const char *TAG = "mlx_config_apply";
+    if (new_config == NULL)
     {
-        ESP_LOGE(TAG, "subpage_temps_0 or subpage_temps_1 is NULL!");
-        return 1;
+        return -1;
     }
 
-    for (int i = 0; i < 768; i++)
+    if (force || new_config->refresh_rate != mlx_config.refresh_rate)
+    {
+        if (MLX90640_SetRefreshRate(MLX90640_SLAVE_ADR, new_config->refresh_rate) != 0)
+        {
+            ESP_LOGE(TAG, "Failed to set refresh rate 0x%02x", new_config->refresh_rate);
+            return -2;
+        }
+        mlx_config.refresh_rate = new_config->refresh_rate;
+        mlx_config.refresh_millis = MLX_REFRESH_MILLIS_LUT[new_config->refresh_rate & 0x07];
+        mlx_config.subpage_delay_millis = mlx_config.refresh_millis * MLX_SUBPAGE_DELAY_PERCENT / 100;
+        mlx_deadline_reset();
+    }
+    if (force || new_config->resolution != mlx_config.resolution)
+    {
+        if (MLX90640_SetResolution(MLX90640_SLAVE_ADR, new_config->resolution) != 0)
+        {
+            ESP_LOGE(TAG, "Failed to set resolution 0x%02x", new_config->resolution);
+            return -3;
+        }
+        mlx_config.resolution = new_config->resolution;
+    }
+    if (force || new_config->pattern != mlx_config.pattern)
     {
-        subpage_temps_0[i] += subpage_temps_1[i];
+        int error_code = (new_config->pattern == MLX_PATTERN_CHESS) ? MLX90640_SetChessMode(MLX90640_SLAVE_ADR) : MLX90640_SetInterleavedMode(MLX90640_SLAVE_ADR);
+        if (error_code != 0)
+        {
+            ESP_LOGE(TAG, "Failed to set pattern %d", new_config->pattern);
+            return -4;
+        }
+        mlx_config.pattern = new_config->pattern;
     }
 
+    mlx_config.emissivity = new_config->emissivity;
+    mlx_config.ambient_offset = new_config->ambient_offset;
+    mlx_config.output_mode = new_config->output_mode;
+    mlx_config.deinterlace_method = new_config->deinterlace_method;
+    mlx_config.governor = new_config->governor;
+    mlx_config.pixel_format = new_config->pixel_format;
     return 0;
+}
+
+/**
+ * @brief Parse one configuration setting into config.
+ *
+ * Keys and values:
+ * RATE 0.5|1|2|4|8|16|32|64 (Hz), RES 16-19 (bits), PATTERN CHESS|INTERLEAVED,
+ * EMIS 0.01-1.0, TAOFF -128-127 (°C), OUT FULL|HOLD|INTERP|RAW, GOV ON|OFF, FORMAT F32|F16|I16|U8|DELTA
+ *
+ * @param config: configuration to modify
+ * @param key: null terminated setting name
+ * @param value: null terminated setting value
+ * @return 0 OK
+ * @return -1 null pointer passed
+ * @return -2 unknown key
+ * @return -3 invalid value
+ */
+int mlx_config_set(MlxConfig_type *config, const char *key, const char *value)
+{
+    if (config == NULL || key == NULL || value == NULL)
+    {
+        return -1;
+    }
+
+    char *end = NULL;
+    if (strcmp(key, "RATE") == 0)
+    {
+        float hz = strtof(value, &end);
+        for (uint8_t rate = 0; rate < 8; rate++)
+        {
+            float rate_hz = 0.5f * (1 << rate);
+            if (end != value && hz > rate_hz * 0.99f && hz < rate_hz * 1.01f)
+            {
+                config->refresh_rate = rate;
+                return 0;
+            }
+        }
+        return -3;
+    }
+    if (strcmp(key, "RES") == 0)
+    {
+        long bits = strtol(value, &end, 10);
+        if (end == value || bits < 16 || bits > 19)
+        {
+            return -3;
+        }
+        config->resolution = bits - 16;
+        return 0;
+    }
+    if (strcmp(key, "PATTERN") == 0)
+    {
+        if (strcmp(value, "CHESS") == 0)
+        {
+            config->pattern = MLX_PATTERN_CHESS;
+        }
+        else if (strcmp(value, "INTERLEAVED") == 0)
+        {
+            config->pattern = MLX_PATTERN_INTERLEAVED;
+        }
+        else
+        {
+            return -3;
+        }
+        return 0;
+    }
+    if (strcmp(key, "EMIS") == 0)
+    {
+        float emissivity = strtof(value, &end);
+        if (end == value || emissivity < 0.01f || emissivity > 1.0f)
+        {
+            return -3;
+        }
+        config->emissivity = emissivity;
+        return 0;
+    }
+    if (strcmp(key, "TAOFF") == 0)
+    {
+        long offset = strtol(value, &end, 10);
+        if (end == value || offset < -128 || offset > 127)
+        {
+            return -3;
+        }
+        config->ambient_offset = offset;
+        return 0;
+    }
+    if (strcmp(key, "OUT") == 0)
+    {
+        if (strcmp(value, "FULL") == 0)
+        {
+            config->output_mode = MLX_OUTPUT_FULL_FRAME;
+        }
+        else if (strcmp(value, "HOLD") == 0)
+        {
+            config->output_mode = MLX_OUTPUT_SUBPAGE;
+            config->deinterlace_method = MLX_DEINTERLACE_HOLD;
+        }
+        else if (strcmp(value, "INTERP") == 0)
+        {
+            config->output_mode = MLX_OUTPUT_SUBPAGE;
+            config->deinterlace_method = MLX_DEINTERLACE_INTERPOLATE;
+        }
+        else if (strcmp(value, "RAW") == 0)
+        {
+            config->output_mode = MLX_OUTPUT_RAW;
+        }
+        else
+        {
+            return -3;
+        }
+        return 0;
+    }
+    if (strcmp(key, "GOV") == 0)
+    {
+        if (strcmp(value, "ON") == 0)
+        {
+            config->governor = true;
+        }
+        else if (strcmp(value, "OFF") == 0)
+        {
+            config->governor = false;
+        }
+        else
+        {
+            return -3;
+        }
+        return 0;
+    }
+    if (strcmp(key, "FORMAT") == 0)
+    {
+        for (uint8_t format = 0; format < MLX_PIXEL_FORMATS; format++)
+        {
+            if (strcmp(value, pixel_format_names[format]) == 0)
+            {
+                config->pixel_format = format;
+                return 0;
+            }
+        }
+        return -3;
+    }
+    return -2;
+}
+
+/**
+ * @brief Write the configuration as text, in the same key value format mlx_config_set accepts.
+ *
+ * @param config: configuration to print
+ * @param buf: output buffer
+ * @param size: output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int mlx_config_format(const MlxConfig_type *config, char *buf, size_t size)
+{
+    const char *output_names[] = {"FULL", "HOLD", "INTERP", "RAW"};
+    int output = 3;
+    if (config->output_mode == MLX_OUTPUT_FULL_FRAME)
+    {
+        output = 0;
+    }
+    else if (config->output_mode == MLX_OUTPUT_SUBPAGE)
+    {
+        output = 1 + (config->deinterlace_method == MLX_DEINTERLACE_INTERPOLATE);
+    }
+
+    return snprintf(buf, size, "RATE %g RES %d PATTERN %s EMIS %.2f TAOFF %d OUT %s GOV %s FORMAT %s",
+                    0.5 * (1 << config->refresh_rate),
+                    16 + config->resolution,
+                    (config->pattern == MLX_PATTERN_CHESS) ? "CHESS" : "INTERLEAVED",
+                    config->emissivity,
+                    config->ambient_offset,
+                    output_names[output],
+                    config->governor ? "ON" : "OFF",
+                    pixel_format_names[config->pixel_format]);
 }
\ No newline at end of file
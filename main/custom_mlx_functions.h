@@ -1,21 +1,62 @@
 #ifndef CUSTOM_MLX_FUNCTIONS_H
-#define CUSTOM_MLX_FUNCTONS_H
+#define CUSTOM_MLX_FUNCTIONS_H
 
 #include "stdlib.h"
+#include <string.h>
+#include <stdbool.h>
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "constants.h"
 #include "mlx90640_api.h"
 #include "uart_isr_handler.h"
+#include "frame_governor.h"
+#include "mlx_deadline.h"
+#include "mlx_merge.h"
+#include "mlx_protocol.h"
+#include "pixel_encoding.h"
+#include "frame_codec.h"
+#include "frame_latency.h"
 
 
+/**
+ * @brief Runtime measurement and output configuration
+ *
+ * Sensor fields are written to the control register by mlx_config_apply,
+ * refresh_millis and subpage_delay_millis are derived from refresh_rate.
+ */
+typedef struct MlxConfig_type
+{
+	uint8_t refresh_rate;
+	uint8_t resolution;
+	uint8_t pattern;
+	float emissivity;
+	int8_t ambient_offset;
+	uint8_t output_mode;
+	uint8_t deinterlace_method;
+	bool governor;
+	uint8_t pixel_format;
+	uint16_t refresh_millis;
+	uint16_t subpage_delay_millis;
+} MlxConfig_type;
+
 extern paramsMLX90640 mlx90640_params;
+extern MlxConfig_type mlx_config;
+extern float mlx_ambient_temperature;
+extern uint16_t mlx_eeprom_dump[MLX90640_EEPROM_DUMP_NUM];
 
 void mlx_delay_after_por();
 int mlx_read_extract_eeprom();
+int mlx_read_subpage_raw(uint16_t *, uint8_t, TickType_t *);
+int mlx_calculate_subpage_temps(uint16_t *, float *, float, int8_t);
 int mlx_get_subpage_temps(float *, float , int8_t , uint8_t , TickType_t *);
 int mlx_read_full_picture(float *, float *, float , int8_t , TickType_t *);
-int mlx_merge_subpages(float *, float *);
+int mlx_delta_encode_frame(const float *, uint8_t *, void *, size_t, float *, float *);
+void mlx_delta_force_key(void);
+int mlx_deinterlace_subpage(float *, int, int, uint8_t);
+int mlx_read_deinterlaced_frame(float *, float, int8_t, uint8_t, TickType_t *);
+int mlx_config_apply(const MlxConfig_type *, bool);
+int mlx_config_set(MlxConfig_type *, const char *, const char *);
+int mlx_config_format(const MlxConfig_type *, char *, size_t);
 
 
 #endif // CUSTOM_MLX_FUNCTIONS_H
\ No newline at end of file
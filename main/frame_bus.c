@@ -0,0 +1,234 @@
+#include "frame_bus.h"
+
+static FrameBuffer_type *frame_pool_buffers;
+static QueueHandle_t queue_frame_pool; // free FrameBuffer_type pointers
+static FrameBusSubscriber_type frame_bus_subscribers[FRAME_BUS_MAX_SUBSCRIBERS];
+static uint8_t frame_bus_subscriber_count = 0;
+static uint32_t frame_bus_sequence = 0;
+static uint32_t frame_bus_pool_misses = 0; // frame_bus_acquire calls that found the pool empty
+static portMUX_TYPE frame_bus_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Allocate the frame pool
+ *
+ * @return 0 OK
+ * @return -1 failed to allocate frame buffers
+ * @return -2 failed to create pool queue
+ */
+int frame_bus_init(void)
+{
+	frame_pool_buffers = (FrameBuffer_type *)calloc(FRAME_BUS_POOL_SIZE, sizeof(FrameBuffer_type));
+	if (frame_pool_buffers == NULL)
+	{
+		return -1;
+	}
+	queue_frame_pool = xQueueCreate(FRAME_BUS_POOL_SIZE, sizeof(FrameBuffer_type *));
+	if (queue_frame_pool == NULL)
+	{
+		free(frame_pool_buffers);
+		frame_pool_buffers = NULL;
+		return -2;
+	}
+	for (int i = 0; i < FRAME_BUS_POOL_SIZE; i++)
+	{
+		FrameBuffer_type *frame = &frame_pool_buffers[i];
+		xQueueSend(queue_frame_pool, &frame, 0);
+	}
+	return 0;
+}
+
+/**
+ * @brief Register a new frame consumer
+ *
+ * Every subscriber gets its own queue, so a slow consumer only drops its own frames.
+ *
+ * @param name subscriber name used in logs
+ * @param queue_depth number of frames the subscriber can hold back
+ * @param drop_policy FRAME_BUS_DROP_NEWEST or FRAME_BUS_DROP_OLDEST
+ * @param subscriber returned subscriber handle
+ * @return 0 OK
+ * @return -1 null pointer passed or queue_depth 0
+ * @return -2 no free subscriber slots
+ * @return -3 failed to create subscriber queue
+ */
+int frame_bus_subscribe(const char *name, uint8_t queue_depth, uint8_t drop_policy, FrameBusSubscriber_type **subscriber)
+{
+	if (subscriber == NULL || queue_depth == 0)
+	{
+		return -1;
+	}
+	if (frame_bus_subscriber_count >= FRAME_BUS_MAX_SUBSCRIBERS)
+	{
+		return -2;
+	}
+
+	QueueHandle_t queue = xQueueCreate(queue_depth, sizeof(FrameBuffer_type *));
+	if (queue == NULL)
+	{
+		return -3;
+	}
+
+	taskENTER_CRITICAL(&frame_bus_mux);
+	FrameBusSubscriber_type *new_subscriber = &frame_bus_subscribers[frame_bus_subscriber_count];
+	new_subscriber->name = name;
+	new_subscriber->queue = queue;
+	new_subscriber->drop_policy = drop_policy;
+	new_subscriber->dropped = 0;
+	frame_bus_subscriber_count++;
+	taskEXIT_CRITICAL(&frame_bus_mux);
+
+	*subscriber = new_subscriber;
+	return 0;
+}
+
+/**
+ * @brief Take a free frame buffer from the pool
+ *
+ * The producer owns the returned buffer (refcount 1) until it is published.
+ *
+ * @param ticks_to_wait how long to wait for a buffer to be released
+ * @return FrameBuffer_type* or NULL when the pool stays empty
+ */
+FrameBuffer_type *frame_bus_acquire(TickType_t ticks_to_wait)
+{
+	FrameBuffer_type *frame = NULL;
+	if (xQueueReceive(queue_frame_pool, &frame, ticks_to_wait) != pdTRUE)
+	{
+		frame_bus_pool_misses++;
+		return NULL;
+	}
+	frame->refcount = 1;
+	frame->subpage = FRAME_BUS_FULL_FRAME;
+	return frame;
+}
+
+void frame_bus_retain(FrameBuffer_type *frame)
+{
+	taskENTER_CRITICAL(&frame_bus_mux);
+	frame->refcount++;
+	taskEXIT_CRITICAL(&frame_bus_mux);
+}
+
+/**
+ * @brief Drop one reference, the last one returns the buffer to the pool
+ *
+ * @param frame frame buffer
+ */
+void frame_bus_release(FrameBuffer_type *frame)
+{
+	if (frame == NULL)
+	{
+		return;
+	}
+
+	taskENTER_CRITICAL(&frame_bus_mux);
+	uint8_t refcount = --frame->refcount;
+	taskEXIT_CRITICAL(&frame_bus_mux);
+
+	if (refcount == 0)
+	{
+		xQueueSend(queue_frame_pool, &frame, 0);
+	}
+}
+
+/**
+ * @brief Hand the frame to every subscriber
+ *
+ * The frame must not be written after this call. Each accepted delivery holds its own reference
+ * and the producer reference is dropped before returning.
+ *
+ * @param frame frame buffer returned by frame_bus_acquire
+ * @return number of subscribers that received the frame
+ * @return -1 null pointer passed
+ */
+int frame_bus_publish(FrameBuffer_type *frame)
+{
+	const char *TAG = "FRAME BUS PUBLISH";
+	if (frame == NULL)
+	{
+		return -1;
+	}
+
+	frame->sequence = frame_bus_sequence++;
+	frame->timestamp_us = esp_timer_get_time();
+
+	int delivered = 0;
+	for (int i = 0; i < frame_bus_subscriber_count; i++)
+	{
+		FrameBusSubscriber_type *subscriber = &frame_bus_subscribers[i];
+
+		frame_bus_retain(frame);
+		if (xQueueSend(subscriber->queue, &frame, 0) == pdTRUE)
+		{
+			delivered++;
+			continue;
+		}
+
+		if (subscriber->drop_policy == FRAME_BUS_DROP_OLDEST)
+		{
+			FrameBuffer_type *oldest = NULL;
+			if (xQueueReceive(subscriber->queue, &oldest, 0) == pdTRUE)
+			{
+				frame_bus_release(oldest);
+				subscriber->dropped++;
+			}
+			if (xQueueSend(subscriber->queue, &frame, 0) == pdTRUE)
+			{
+				delivered++;
+				continue;
+			}
+		}
+
+		subscriber->dropped++;
+		frame_bus_release(frame);
+		ESP_LOGD(TAG, "Subscriber %s dropped frame %lu", subscriber->name, (unsigned long)frame->sequence);
+	}
+
+	frame_bus_release(frame);
+	return delivered;
+}
+
+/**
+ * @brief Wait for the next frame of the subscriber
+ *
+ * The caller holds a reference to the returned frame and must call frame_bus_release when done.
+ *
+ * @param subscriber subscriber handle
+ * @param ticks_to_wait how long to wait for a frame
+ * @return FrameBuffer_type* or NULL on timeout
+ */
+FrameBuffer_type *frame_bus_receive(FrameBusSubscriber_type *subscriber, TickType_t ticks_to_wait)
+{
+	FrameBuffer_type *frame = NULL;
+	if (subscriber == NULL || xQueueReceive(subscriber->queue, &frame, ticks_to_wait) != pdTRUE)
+	{
+		return NULL;
+	}
+	return frame;
+}
+
+/**
+ * @brief Frame bus load figures
+ *
+ * @param max_queued largest number of frames waiting in any subscriber queue
+ * @param dropped frames dropped by all subscribers plus frames lost to an empty pool
+ */
+void frame_bus_get_stats(uint8_t *max_queued, uint32_t *dropped)
+{
+	uint8_t queued = 0;
+	uint32_t dropped_total = frame_bus_pool_misses;
+	for (int i = 0; i < frame_bus_subscriber_count; i++)
+	{
+		UBaseType_t waiting = uxQueueMessagesWaiting(frame_bus_subscribers[i].queue);
+		queued = (waiting > queued) ? waiting : queued;
+		dropped_total += frame_bus_subscribers[i].dropped;
+	}
+	if (max_queued != NULL)
+	{
+		*max_queued = queued;
+	}
+	if (dropped != NULL)
+	{
+		*dropped = dropped_total;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef FRAME_BUS_H
+#define FRAME_BUS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "constants.h"
+#include "frame_latency.h"
+
+#define FRAME_BUS_POOL_SIZE 4		/*!< Number of frame buffers shared by all subscribers*/
+#define FRAME_BUS_MAX_SUBSCRIBERS 4 /*!< Max number of frame consumers*/
+
+#define FRAME_BUS_DROP_NEWEST 0 /*!< Full subscriber queue rejects the published frame*/
+#define FRAME_BUS_DROP_OLDEST 1 /*!< Full subscriber queue releases its oldest frame to make room*/
+
+#define FRAME_BUS_FULL_FRAME -1 /*!< FrameBuffer_type.subpage value of a frame merged from both subpages*/
+
+/**
+ * @brief Refcounted frame buffer
+ *
+ * Filled by the producer between frame_bus_acquire and frame_bus_publish, read-only afterwards.
+ * The buffer returns to the pool when the last holder calls frame_bus_release.
+ * encoded holds the output pixels when pixel_format is not float32, raw holds the sensor words of
+ * MLX_PIXEL_RAW frames.
+ */
+typedef struct FrameBuffer_type
+{
+	float temps[MLX_FRAME_SIZE];
+	union
+	{
+		uint16_t u16[MLX_FRAME_SIZE];
+		uint8_t u8[MLX_FRAME_SIZE * 2];
+		uint16_t raw[MLX_RAW_SUBPAGE_SIZE];
+	} encoded;
+	uint16_t encoded_size;
+	uint8_t pixel_format;
+	float offset;
+	float scale;
+	uint32_t sequence;
+	int64_t timestamp_us;
+	float ta;
+	int8_t subpage;
+	uint8_t refcount;
+	FrameLatency_type latency; // pipeline times, handed from the producer to the transmit task
+} FrameBuffer_type;
+
+typedef struct FrameBusSubscriber_type
+{
+	const char *name;
+	QueueHandle_t queue; // FrameBuffer_type pointers
+	uint8_t drop_policy;
+	uint32_t dropped;
+} FrameBusSubscriber_type;
+
+int frame_bus_init(void);
+int frame_bus_subscribe(const char *name, uint8_t queue_depth, uint8_t drop_policy, FrameBusSubscriber_type **subscriber);
+FrameBuffer_type *frame_bus_acquire(TickType_t ticks_to_wait);
+int frame_bus_publish(FrameBuffer_type *frame);
+FrameBuffer_type *frame_bus_receive(FrameBusSubscriber_type *subscriber, TickType_t ticks_to_wait);
+void frame_bus_retain(FrameBuffer_type *frame);
+void frame_bus_release(FrameBuffer_type *frame);
+void frame_bus_get_stats(uint8_t *max_queued, uint32_t *dropped);
+
+#endif // FRAME_BUS_H
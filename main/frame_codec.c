@@ -0,0 +1,295 @@
+#include "frame_codec.h"
+
+typedef struct BitWriter_type
+{
+	uint8_t *out;
+	size_t size;
+	size_t pos;
+	uint32_t acc;
+	int bits;
+} BitWriter_type;
+
+typedef struct BitReader_type
+{
+	const uint8_t *in;
+	size_t size;
+	size_t pos;
+	uint32_t acc;
+	int bits;
+} BitReader_type;
+
+/**
+ * @brief Append up to 24 bits, MSB first
+ *
+ * @return 0 OK
+ * @return -1 output full
+ */
+static inline int bit_write(BitWriter_type *writer, uint32_t value, int count)
+{
+	writer->acc = (writer->acc << count) | value;
+	writer->bits += count;
+	while (writer->bits >= 8)
+	{
+		if (writer->pos >= writer->size)
+		{
+			return -1;
+		}
+		writer->bits -= 8;
+		writer->out[writer->pos++] = writer->acc >> writer->bits;
+	}
+	return 0;
+}
+
+static int bit_flush(BitWriter_type *writer)
+{
+	if (writer->bits > 0)
+	{
+		return bit_write(writer, 0, 8 - writer->bits);
+	}
+	return 0;
+}
+
+/**
+ * @brief Read up to 24 bits, MSB first
+ *
+ * @return 0 OK
+ * @return -1 input exhausted
+ */
+static inline int bit_read(BitReader_type *reader, int count, uint32_t *value)
+{
+	while (reader->bits < count)
+	{
+		if (reader->pos >= reader->size)
+		{
+			return -1;
+		}
+		reader->acc = (reader->acc << 8) | reader->in[reader->pos++];
+		reader->bits += 8;
+	}
+	reader->bits -= count;
+	*value = (reader->acc >> reader->bits) & ((1u << count) - 1);
+	return 0;
+}
+
+static inline uint32_t zigzag_encode(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static inline int16_t codec_quantize(float temp, float inverse_step)
+{
+	float scaled = temp * inverse_step;
+	int32_t value = (int32_t)(scaled + ((scaled >= 0) ? 0.5f : -0.5f));
+	return (value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value;
+}
+
+/**
+ * @brief Reset the codec, the next encoded frame is a key frame
+ *
+ * @param codec codec state, one per stream on both sides
+ * @param step quantization step in °C
+ * @param key_interval frames between key frames
+ */
+void frame_codec_init(FrameCodec_type *codec, float step, uint16_t key_interval)
+{
+	memset(codec, 0, sizeof(FrameCodec_type));
+	codec->step = step;
+	codec->key_interval = key_interval;
+}
+
+/**
+ * @brief Quantize and encode one frame
+ *
+ * Runs in a single pass over the residuals and stops as soon as out_size is exceeded,
+ * so the encode time is bounded by out_size. A failed frame forces the next one to be a key frame.
+ *
+ * @param codec encoder state
+ * @param temps FRAME_CODEC_PIXELS temperatures in °C
+ * @param out payload output
+ * @param out_size payload budget in bytes
+ * @return payload size in bytes
+ * @return -1 payload does not fit out_size, send the frame in another format
+ */
+int frame_codec_encode(FrameCodec_type *codec, const float *temps, uint8_t *out, size_t out_size)
+{
+	bool key_frame = !codec->has_key || codec->force_key || codec->frames_since_key >= codec->key_interval;
+	float inverse_step = 1.0f / codec->step;
+	uint32_t residual_sum = 0;
+	int16_t previous = 0;
+
+	for (int i = 0; i < FRAME_CODEC_PIXELS; i++)
+	{
+		int16_t quantized = codec_quantize(temps[i], inverse_step);
+		int32_t residual;
+		if (key_frame)
+		{
+			residual = quantized - previous;
+			previous = quantized;
+			codec->key[i] = quantized;
+		}
+		else
+		{
+			residual = quantized - codec->key[i];
+		}
+		codec->residual[i] = zigzag_encode(residual);
+		residual_sum += codec->residual[i];
+	}
+
+	// Rice parameter close to log2 of the mean residual
+	uint8_t rice_k = 0;
+	while (rice_k < 15 && ((uint32_t)FRAME_CODEC_PIXELS << (rice_k + 1)) <= residual_sum)
+	{
+		rice_k++;
+	}
+
+	if (key_frame)
+	{
+		codec->key_id++;
+		codec->frames_since_key = 0;
+		codec->has_key = false; // valid once the key frame is encoded
+		codec->force_key = false;
+	}
+
+	if (out_size < FRAME_CODEC_HEADER_SIZE)
+	{
+		codec->force_key = true;
+		return -1;
+	}
+	out[0] = key_frame ? FRAME_CODEC_FLAG_KEY : 0;
+	out[1] = rice_k;
+	memcpy(&out[2], &codec->key_id, sizeof(codec->key_id));
+
+	BitWriter_type writer = {.out = out, .size = out_size, .pos = FRAME_CODEC_HEADER_SIZE};
+	uint32_t remainder_mask = (1u << rice_k) - 1;
+	for (int i = 0; i < FRAME_CODEC_PIXELS; i++)
+	{
+		uint32_t quotient = codec->residual[i] >> rice_k;
+		int error;
+		if (quotient < FRAME_CODEC_RICE_ESCAPE)
+		{
+			// quotient ones and a terminating zero, then k remainder bits
+			error = bit_write(&writer, ((1u << quotient) - 1) << 1, quotient + 1);
+			error |= bit_write(&writer, codec->residual[i] & remainder_mask, rice_k);
+		}
+		else
+		{
+			error = bit_write(&writer, (1u << FRAME_CODEC_RICE_ESCAPE) - 1, FRAME_CODEC_RICE_ESCAPE);
+			error |= bit_write(&writer, codec->residual[i], FRAME_CODEC_RAW_BITS);
+		}
+		if (error != 0)
+		{
+			codec->force_key = true;
+			return -1;
+		}
+	}
+	if (bit_flush(&writer) != 0)
+	{
+		codec->force_key = true;
+		return -1;
+	}
+
+	if (key_frame)
+	{
+		codec->has_key = true;
+	}
+	else
+	{
+		codec->frames_since_key++;
+	}
+	return writer.pos;
+}
+
+/**
+ * @brief Decode one frame
+ *
+ * Key frames replace the decoder key, delta frames need the key frame they were coded against.
+ *
+ * @param codec decoder state
+ * @param in payload
+ * @param in_size payload size
+ * @param temps FRAME_CODEC_PIXELS output temperatures in °C
+ * @return 0 OK
+ * @return -1 truncated or corrupt payload
+ * @return -2 delta frame without its key frame, wait for the next key frame
+ */
+int frame_codec_decode(FrameCodec_type *codec, const uint8_t *in, size_t in_size, float *temps)
+{
+	if (in_size < FRAME_CODEC_HEADER_SIZE || in[1] > 15)
+	{
+		return -1;
+	}
+	bool key_frame = in[0] & FRAME_CODEC_FLAG_KEY;
+	uint8_t rice_k = in[1];
+	uint32_t key_id;
+	memcpy(&key_id, &in[2], sizeof(key_id));
+
+	if (!key_frame && (!codec->has_key || key_id != codec->key_id))
+	{
+		return -2;
+	}
+
+	BitReader_type reader = {.in = in, .size = in_size, .pos = FRAME_CODEC_HEADER_SIZE};
+	int16_t previous = 0;
+	for (int i = 0; i < FRAME_CODEC_PIXELS; i++)
+	{
+		uint32_t quotient = 0;
+		uint32_t bit = 1;
+		while (quotient < FRAME_CODEC_RICE_ESCAPE)
+		{
+			if (bit_read(&reader, 1, &bit) != 0)
+			{
+				codec->has_key = codec->has_key && !key_frame;
+				return -1;
+			}
+			if (bit == 0)
+			{
+				break;
+			}
+			quotient++;
+		}
+
+		uint32_t value;
+		int error;
+		if (quotient == FRAME_CODEC_RICE_ESCAPE)
+		{
+			error = bit_read(&reader, FRAME_CODEC_RAW_BITS, &value);
+		}
+		else
+		{
+			uint32_t remainder = 0;
+			error = (rice_k > 0) ? bit_read(&reader, rice_k, &remainder) : 0;
+			value = (quotient << rice_k) | remainder;
+		}
+		if (error != 0)
+		{
+			codec->has_key = codec->has_key && !key_frame;
+			return -1;
+		}
+
+		int32_t residual = zigzag_decode(value);
+		int16_t quantized;
+		if (key_frame)
+		{
+			quantized = previous + residual;
+			previous = quantized;
+			codec->key[i] = quantized;
+		}
+		else
+		{
+			quantized = codec->key[i] + residual;
+		}
+		temps[i] = quantized * codec->step;
+	}
+
+	if (key_frame)
+	{
+		codec->key_id = key_id;
+		codec->has_key = true;
+	}
+	return 0;
+}
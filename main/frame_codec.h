@@ -0,0 +1,43 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define FRAME_CODEC_PIXELS 768
+#define FRAME_CODEC_STEP 0.05f		 /*!< Quantization step in °C*/
+#define FRAME_CODEC_KEY_INTERVAL 32	 /*!< A key frame every N frames*/
+#define FRAME_CODEC_HEADER_SIZE 6	 /*!< flags, rice k, key id*/
+#define FRAME_CODEC_FLAG_KEY 0x01
+#define FRAME_CODEC_RICE_ESCAPE 24	 /*!< Unary length that escapes to a raw value*/
+#define FRAME_CODEC_RAW_BITS 18		 /*!< Raw escaped value width, fits any zigzag int16 difference*/
+
+/**
+ * Payload layout:
+ *
+ * | flags (1 B) | rice k (1 B) | key id (4 B, little-endian) | Rice coded residuals, MSB first |
+ *
+ * Pixels are quantized to step. Key frames code the difference to the previous pixel,
+ * delta frames code the difference to the same pixel of key frame key id. Residuals are
+ * zigzag mapped and Rice coded with parameter k, quotients of FRAME_CODEC_RICE_ESCAPE or more
+ * are sent as FRAME_CODEC_RICE_ESCAPE ones followed by the FRAME_CODEC_RAW_BITS raw value.
+ */
+typedef struct FrameCodec_type
+{
+	int16_t key[FRAME_CODEC_PIXELS];
+	uint32_t residual[FRAME_CODEC_PIXELS];
+	uint32_t key_id;
+	uint16_t frames_since_key;
+	uint16_t key_interval;
+	float step;
+	bool has_key;
+	bool force_key;
+} FrameCodec_type;
+
+void frame_codec_init(FrameCodec_type *codec, float step, uint16_t key_interval);
+int frame_codec_encode(FrameCodec_type *codec, const float *temps, uint8_t *out, size_t out_size);
+int frame_codec_decode(FrameCodec_type *codec, const uint8_t *in, size_t in_size, float *temps);
+
+#endif // FRAME_CODEC_H
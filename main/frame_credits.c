@@ -0,0 +1,129 @@
+#include "frame_credits.h"
+
+FrameCredits_type frame_credits = {0};
+static portMUX_TYPE frame_credits_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Grant frames to the producer
+ *
+ * @param count number of frames
+ * @param first_sequence sequence number of the first granted frame
+ * @param last_sequence sequence number of the last granted frame
+ * @return 0 OK
+ * @return -1 count 0
+ * @return -2 more than FRAME_CREDITS_MAX credits would be waiting
+ */
+int frame_credits_grant(uint32_t count, uint32_t *first_sequence, uint32_t *last_sequence)
+{
+	if (count == 0)
+	{
+		return -1;
+	}
+	int error_code = 0;
+	taskENTER_CRITICAL(&frame_credits_mux);
+	if (count > FRAME_CREDITS_MAX - frame_credits.available)
+	{
+		error_code = -2;
+	}
+	else
+	{
+		*first_sequence = frame_credits.issued;
+		frame_credits.available += count;
+		frame_credits.issued += count;
+		*last_sequence = frame_credits.issued - 1;
+	}
+	taskEXIT_CRITICAL(&frame_credits_mux);
+	return error_code;
+}
+
+/**
+ * @brief Use one credit to start a frame
+ *
+ * @return true a frame may be produced
+ * @return false no credits
+ */
+bool frame_credits_take(void)
+{
+	bool taken = false;
+	taskENTER_CRITICAL(&frame_credits_mux);
+	if (frame_credits.available > 0)
+	{
+		frame_credits.available--;
+		taken = true;
+	}
+	taskEXIT_CRITICAL(&frame_credits_mux);
+	return taken;
+}
+
+/**
+ * @brief Give the credit of a frame that was not published back
+ *
+ * @param failed true for acquisition or merge errors, false for frames skipped on purpose
+ * @return 0 OK, the frame will be retried
+ * @return -1 FRAME_CREDITS_MAX_FAILURES consecutive errors, all credits were cancelled
+ */
+int frame_credits_refund(bool failed)
+{
+	int error_code = 0;
+	taskENTER_CRITICAL(&frame_credits_mux);
+	if (failed && ++frame_credits.failures >= FRAME_CREDITS_MAX_FAILURES)
+	{
+		// The failed credit is cancelled with the waiting ones
+		frame_credits.cancelled += frame_credits.available + 1;
+		frame_credits.issued -= frame_credits.available + 1;
+		frame_credits.available = 0;
+		frame_credits.failures = 0;
+		error_code = -1;
+	}
+	else
+	{
+		frame_credits.available++;
+		frame_credits.refunded++;
+	}
+	taskEXIT_CRITICAL(&frame_credits_mux);
+	return error_code;
+}
+
+/**
+ * @brief Count a published frame
+ */
+void frame_credits_published(void)
+{
+	taskENTER_CRITICAL(&frame_credits_mux);
+	frame_credits.published++;
+	frame_credits.failures = 0;
+	taskEXIT_CRITICAL(&frame_credits_mux);
+}
+
+/**
+ * @brief Cancel the waiting credits, frames already started are still sent
+ *
+ * @return number of cancelled credits
+ */
+uint32_t frame_credits_cancel(void)
+{
+	taskENTER_CRITICAL(&frame_credits_mux);
+	uint32_t cancelled = frame_credits.available;
+	frame_credits.cancelled += cancelled;
+	frame_credits.issued -= cancelled;
+	frame_credits.available = 0;
+	taskEXIT_CRITICAL(&frame_credits_mux);
+	return cancelled;
+}
+
+/**
+ * @brief Write the credit status as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int frame_credits_format(char *buf, size_t size)
+{
+	return snprintf(buf, size, "AVAILABLE %lu ISSUED %lu PUBLISHED %lu RETRIED %lu CANCELLED %lu",
+					(unsigned long)frame_credits.available,
+					(unsigned long)frame_credits.issued,
+					(unsigned long)frame_credits.published,
+					(unsigned long)frame_credits.refunded,
+					(unsigned long)frame_credits.cancelled);
+}
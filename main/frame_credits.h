@@ -0,0 +1,37 @@
+#ifndef FRAME_CREDITS_H
+#define FRAME_CREDITS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define FRAME_CREDITS_MAX 65535		 /*!< Max credits waiting to be used*/
+#define FRAME_CREDITS_MAX_FAILURES 8 /*!< Consecutive failed frames that cancel the remaining credits*/
+
+/**
+ * @brief Frame credits granted by the host
+ *
+ * Every credit produces one published frame. Failed frames give their credit back, so frame
+ * sequence numbers and credits stay in step: the n-th credit ever issued becomes frame sequence n - 1.
+ */
+typedef struct FrameCredits_type
+{
+	uint32_t available; // granted, not started
+	uint32_t issued;	// granted minus cancelled since boot
+	uint32_t published; // frames produced from credits
+	uint32_t refunded;	// failed frames that were retried
+	uint32_t cancelled;
+	uint8_t failures; // consecutive failed frames
+} FrameCredits_type;
+
+extern FrameCredits_type frame_credits;
+
+int frame_credits_grant(uint32_t count, uint32_t *first_sequence, uint32_t *last_sequence);
+bool frame_credits_take(void);
+int frame_credits_refund(bool failed);
+void frame_credits_published(void);
+uint32_t frame_credits_cancel(void);
+int frame_credits_format(char *buf, size_t size);
+
+#endif // FRAME_CREDITS_H
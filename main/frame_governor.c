@@ -0,0 +1,189 @@
+#include "frame_governor.h"
+
+FrameGovernor_type frame_governor = {0};
+
+/**
+ * @brief Exponential moving average with 1/8 weight of the new sample
+ */
+static uint32_t governor_average(uint32_t average, uint32_t sample)
+{
+	if (average == 0)
+	{
+		return sample;
+	}
+	return average + ((int32_t)sample - (int32_t)average) / 8;
+}
+
+/**
+ * @brief Per-frame work as a share of the frame period at refresh_rate
+ */
+static uint32_t governor_load_percent(uint32_t work_us, uint8_t refresh_rate, uint8_t subpages_per_frame)
+{
+	uint32_t period_us = (uint32_t)MLX_REFRESH_MILLIS_LUT[refresh_rate & 0x07] * 1000 * subpages_per_frame;
+	return (uint64_t)work_us * 100 / period_us;
+}
+
+/**
+ * @brief Share of the frame period used by the busier of the sensor pipeline and the link
+ *
+ * The link drains while the next frame is read, so it is a stage of its own and not added to the work.
+ * link_us includes the wait behind queued packets, it rises above the period when the link falls behind.
+ */
+static uint32_t governor_frame_load(uint32_t work_us, uint8_t refresh_rate, uint8_t subpages_per_frame)
+{
+	uint32_t work_load = governor_load_percent(work_us, refresh_rate, subpages_per_frame);
+	uint32_t link_load = governor_load_percent(frame_governor.link_us, refresh_rate, subpages_per_frame);
+	return (work_load > link_load) ? work_load : link_load;
+}
+
+/**
+ * @brief Record the time spent reading one subpage
+ *
+ * @param acquisition_us time from data ready until the subpage was read over I2C
+ */
+void frame_governor_record_acquisition(uint32_t acquisition_us)
+{
+	frame_governor.acquisition_us = governor_average(frame_governor.acquisition_us, acquisition_us);
+}
+
+/**
+ * @brief Record the time spent calculating one subpage
+ *
+ * @param compute_us Ta, To and bad pixel correction time
+ */
+void frame_governor_record_compute(uint32_t compute_us)
+{
+	frame_governor.compute_us = governor_average(frame_governor.compute_us, compute_us);
+}
+
+/**
+ * @brief Record the time the transmit task spent on one frame
+ *
+ * @param tx_us time to queue the frame packet for transmission
+ */
+void frame_governor_record_tx(uint32_t tx_us)
+{
+	frame_governor.tx_us = governor_average(frame_governor.tx_us, tx_us);
+}
+
+/**
+ * @brief Record the link latency of one frame
+ *
+ * @param link_us time from queueing the frame packet until it left the TX buffer
+ */
+void frame_governor_record_link(uint32_t link_us)
+{
+	frame_governor.link_us = governor_average(frame_governor.link_us, link_us);
+}
+
+/**
+ * @brief Record a frame skipped because the link could not keep up, counts as a dropped frame
+ */
+void frame_governor_record_skip(void)
+{
+	frame_governor.skipped++;
+}
+
+/**
+ * @brief Decide whether the refresh rate should change
+ *
+ * Called once per published frame. The load is the larger of the sensor pipeline and the link share
+ * of the frame period. The rate steps down as soon as frames are dropped or after
+ * GOVERNOR_DOWN_FRAMES overloaded frames, and steps up only after GOVERNOR_UP_FRAMES frames that
+ * would still have headroom at the next rate.
+ *
+ * @param refresh_rate active refresh rate
+ * @param subpages_per_frame 2 for full frame output, 1 for subpage output
+ * @param enabled false only updates the load figures
+ * @param new_rate refresh rate to apply on GOVERNOR_STEP_UP or GOVERNOR_STEP_DOWN
+ * @return GOVERNOR_HOLD, GOVERNOR_STEP_UP or GOVERNOR_STEP_DOWN
+ */
+int frame_governor_update(uint8_t refresh_rate, uint8_t subpages_per_frame, bool enabled, uint8_t *new_rate)
+{
+	uint8_t queued = 0;
+	uint32_t dropped = 0;
+	frame_bus_get_stats(&queued, &dropped);
+	dropped += frame_governor.skipped;
+	bool new_drops = dropped != frame_governor.dropped;
+	frame_governor.dropped = dropped;
+	frame_governor.queued = queued;
+
+	uint32_t work_us = subpages_per_frame * (frame_governor.acquisition_us + frame_governor.compute_us) + frame_governor.tx_us;
+	uint32_t load = governor_frame_load(work_us, refresh_rate, subpages_per_frame);
+	frame_governor.load_percent = (load > 255) ? 255 : load;
+	*new_rate = refresh_rate;
+
+	if (!enabled)
+	{
+		frame_governor.frames_over = 0;
+		frame_governor.frames_under = 0;
+		return GOVERNOR_HOLD;
+	}
+
+	int decision = GOVERNOR_HOLD;
+	if (new_drops || queued > GOVERNOR_MAX_QUEUED || load > GOVERNOR_HIGH_LOAD_PERCENT)
+	{
+		frame_governor.frames_under = 0;
+		frame_governor.frames_over++;
+		if (refresh_rate > GOVERNOR_MIN_RATE && (new_drops || frame_governor.frames_over >= GOVERNOR_DOWN_FRAMES))
+		{
+			decision = GOVERNOR_STEP_DOWN;
+		}
+	}
+	else if (refresh_rate < GOVERNOR_MAX_RATE && governor_frame_load(work_us, refresh_rate + 1, subpages_per_frame) < GOVERNOR_LOW_LOAD_PERCENT)
+	{
+		frame_governor.frames_over = 0;
+		frame_governor.frames_under++;
+		if (frame_governor.frames_under >= GOVERNOR_UP_FRAMES)
+		{
+			decision = GOVERNOR_STEP_UP;
+		}
+	}
+	else
+	{
+		frame_governor.frames_over = 0;
+		frame_governor.frames_under = 0;
+	}
+
+	if (decision != GOVERNOR_HOLD)
+	{
+		*new_rate = (decision == GOVERNOR_STEP_UP) ? refresh_rate + 1 : refresh_rate - 1;
+		frame_governor.last_decision = decision;
+		frame_governor.last_rate = *new_rate;
+		frame_governor.frames_over = 0;
+		frame_governor.frames_under = 0;
+		if (decision == GOVERNOR_STEP_UP)
+		{
+			frame_governor.step_ups++;
+		}
+		else
+		{
+			frame_governor.step_downs++;
+		}
+	}
+	return decision;
+}
+
+/**
+ * @brief Write the governor status as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int frame_governor_format(char *buf, size_t size)
+{
+	const char *decision_names[] = {"HOLD", "UP", "DOWN"};
+	return snprintf(buf, size, "LOAD %u ACQ %lu TO %lu TX %lu LINK %lu Q %u DROPS %lu UP %lu DOWN %lu LAST %s %g",
+					frame_governor.load_percent,
+					(unsigned long)frame_governor.acquisition_us,
+					(unsigned long)frame_governor.compute_us,
+					(unsigned long)frame_governor.tx_us,
+					(unsigned long)frame_governor.link_us,
+					frame_governor.queued,
+					(unsigned long)frame_governor.dropped,
+					(unsigned long)frame_governor.step_ups,
+					(unsigned long)frame_governor.step_downs,
+					decision_names[frame_governor.last_decision],
+					0.5 * (1 << frame_governor.last_rate));
+}
@@ -0,0 +1,55 @@
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "constants.h"
+#include "frame_bus.h"
+
+#define GOVERNOR_HIGH_LOAD_PERCENT 90 /*!< Step down above this share of the frame period*/
+#define GOVERNOR_LOW_LOAD_PERCENT 70  /*!< Step up when the next rate would stay below this share*/
+#define GOVERNOR_DOWN_FRAMES 2		  /*!< Consecutive overloaded frames before stepping down*/
+#define GOVERNOR_UP_FRAMES 16		  /*!< Consecutive frames with headroom before stepping up*/
+#define GOVERNOR_MAX_QUEUED 1		  /*!< Frames waiting in a subscriber queue that count as overload*/
+#define GOVERNOR_MIN_RATE 0x01		  /*!< 1 Hz*/
+#define GOVERNOR_MAX_RATE 0x07		  /*!< 64 Hz*/
+
+#define GOVERNOR_HOLD 0
+#define GOVERNOR_STEP_UP 1
+#define GOVERNOR_STEP_DOWN 2
+
+/**
+ * @brief Per-frame stage times and governor decisions
+ *
+ * Stage times are exponential moving averages in microseconds.
+ */
+typedef struct FrameGovernor_type
+{
+	uint32_t acquisition_us;
+	uint32_t compute_us;
+	uint32_t tx_us;
+	uint32_t link_us; // queued until sent, overlaps the next acquisition
+	uint8_t queued;
+	uint32_t dropped;
+	uint32_t skipped; // frames not sent because of link backpressure
+	uint8_t load_percent;
+	uint8_t last_decision;
+	uint8_t last_rate;
+	uint16_t frames_over;
+	uint16_t frames_under;
+	uint32_t step_ups;
+	uint32_t step_downs;
+} FrameGovernor_type;
+
+extern FrameGovernor_type frame_governor;
+
+void frame_governor_record_acquisition(uint32_t acquisition_us);
+void frame_governor_record_compute(uint32_t compute_us);
+void frame_governor_record_tx(uint32_t tx_us);
+void frame_governor_record_link(uint32_t link_us);
+void frame_governor_record_skip(void);
+int frame_governor_update(uint8_t refresh_rate, uint8_t subpages_per_frame, bool enabled, uint8_t *new_rate);
+int frame_governor_format(char *buf, size_t size);
+
+#endif // FRAME_GOVERNOR_H
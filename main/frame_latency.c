@@ -0,0 +1,348 @@
+#include "frame_latency.h"
+
+#include <string.h>
+
+FrameLatencyStats_type frame_latency = {0};
+static portMUX_TYPE frame_latency_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *frame_latency_stage_names[FRAME_LATENCY_STAGES] = {"TOTAL", "SYNC", "READ0", "CALC0", "READ1", "CALC1", "MERGE", "QUEUE", "LINK"};
+
+static int64_t frame_latency_pending_request = 0;	 // MLX START time of a frame started from idle
+static FrameLatency_type frame_latency_current;		 // frame being read, owned by the acquisition task until the handoff
+static FrameLatency_type frame_latency_in_flight[FRAME_LATENCY_IN_FLIGHT]; // transmit task only
+static uint8_t frame_latency_in_flight_next = 0;
+static MlxLatencyRecord_type frame_latency_records[FRAME_LATENCY_RECORDS]; // transmit task only
+static uint8_t frame_latency_records_head = 0;
+static uint8_t frame_latency_records_count = 0;
+
+/**
+ * @brief Histogram bucket of a time, bucket b holds 2^(b-1) to 2^b - 1 us
+ */
+static uint8_t latency_bucket(uint32_t us)
+{
+	uint8_t bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+	return (bucket < FRAME_LATENCY_BUCKETS) ? bucket : FRAME_LATENCY_BUCKETS - 1;
+}
+
+static void latency_mark(FrameLatency_type *latency, uint8_t point, int64_t now_us)
+{
+	uint32_t offset_us = (uint32_t)(now_us - latency->record.request_us);
+	latency->record.offset_us[point] = offset_us;
+	latency->record.marked |= 1u << point;
+	latency->stage_us[point] = offset_us - latency->last_offset_us;
+	latency->last_offset_us = offset_us;
+}
+
+/**
+ * @brief Remember the arrival of MLX START for a pipeline that was idle
+ */
+void frame_latency_request(void)
+{
+	int64_t now_us = esp_timer_get_time();
+	taskENTER_CRITICAL(&frame_latency_mux);
+	frame_latency_pending_request = now_us;
+	taskEXIT_CRITICAL(&frame_latency_mux);
+}
+
+/**
+ * @brief Request time of the frame whose credit was just taken
+ *
+ * @return MLX START time if the frame was started from idle, else the current time
+ */
+int64_t frame_latency_take_request(void)
+{
+	int64_t request_us = esp_timer_get_time();
+	taskENTER_CRITICAL(&frame_latency_mux);
+	if (frame_latency_pending_request != 0)
+	{
+		request_us = frame_latency_pending_request;
+		frame_latency_pending_request = 0;
+	}
+	taskEXIT_CRITICAL(&frame_latency_mux);
+	return request_us;
+}
+
+/**
+ * @brief Start timing a frame, called by the acquisition task once no other frame is in flight
+ *
+ * @param request_us frame_latency_take_request time
+ */
+void frame_latency_begin(int64_t request_us)
+{
+	memset(&frame_latency_current, 0, sizeof(frame_latency_current));
+	frame_latency_current.record.request_us = request_us;
+	frame_latency_current.record.marked = 1u << MLX_LATENCY_REQUEST;
+	frame_latency_current.active = true;
+}
+
+/**
+ * @brief Mark a point of the frame being read, does nothing outside of a frame
+ *
+ * A point passed again, e.g. after a retry, keeps the later time.
+ *
+ * @param point MLX_LATENCY_SYNC to MLX_LATENCY_CALC_1
+ */
+void frame_latency_mark(uint8_t point)
+{
+	if (frame_latency_current.active && point < MLX_LATENCY_POINTS)
+	{
+		latency_mark(&frame_latency_current, point, esp_timer_get_time());
+	}
+}
+
+/**
+ * @brief Mark the frame merged and move its times into the frame buffer, called by the merge task
+ *
+ * @param latency FrameBuffer_type latency of the frame about to be published
+ */
+void frame_latency_handoff(FrameLatency_type *latency)
+{
+	frame_latency_mark(MLX_LATENCY_MERGED);
+	*latency = frame_latency_current;
+	frame_latency_current.active = false;
+}
+
+/**
+ * @brief Track a frame that was written to the TX buffer, called by the transmit task
+ *
+ * @param latency FrameBuffer_type latency of the frame
+ * @param sequence frame sequence number
+ * @param tx_start_us time the transmit task started writing the frame
+ */
+void frame_latency_sent(const FrameLatency_type *latency, uint32_t sequence, int64_t tx_start_us)
+{
+	if (!latency->active)
+	{
+		return;
+	}
+	FrameLatency_type *tracked = &frame_latency_in_flight[frame_latency_in_flight_next];
+	frame_latency_in_flight_next = (frame_latency_in_flight_next + 1) % FRAME_LATENCY_IN_FLIGHT;
+	*tracked = *latency;
+	tracked->record.sequence = sequence;
+	latency_mark(tracked, MLX_LATENCY_TX_START, tx_start_us);
+}
+
+/**
+ * @brief Count a frame that left the TX buffer in the histograms, called from the transmit complete callback
+ *
+ * While tracing, the record is queued for frame_latency_take_record.
+ *
+ * @param sequence frame sequence number
+ */
+void frame_latency_complete(uint32_t sequence)
+{
+	int64_t now_us = esp_timer_get_time();
+	FrameLatency_type *tracked = NULL;
+	for (int i = 0; i < FRAME_LATENCY_IN_FLIGHT; i++)
+	{
+		if (frame_latency_in_flight[i].active && frame_latency_in_flight[i].record.sequence == sequence)
+		{
+			tracked = &frame_latency_in_flight[i];
+			break;
+		}
+	}
+
+	taskENTER_CRITICAL(&frame_latency_mux);
+	if (tracked == NULL)
+	{
+		frame_latency.unmatched++;
+		taskEXIT_CRITICAL(&frame_latency_mux);
+		return;
+	}
+	latency_mark(tracked, MLX_LATENCY_TX_DONE, now_us);
+	tracked->active = false;
+	tracked->stage_us[FRAME_LATENCY_TOTAL] = tracked->record.offset_us[MLX_LATENCY_TX_DONE];
+	if (frame_latency.window_frames >= FRAME_LATENCY_WINDOW)
+	{
+		// The older window is dropped, queries see the last 256 to 512 frames
+		frame_latency.window ^= 1;
+		memset(frame_latency.counts[frame_latency.window], 0, sizeof(frame_latency.counts[0]));
+		frame_latency.window_frames = 0;
+	}
+	for (uint8_t stage = 0; stage < FRAME_LATENCY_STAGES; stage++)
+	{
+		// Stage n ends at point n, TOTAL takes the slot of the request
+		if (stage == FRAME_LATENCY_TOTAL || (tracked->record.marked & (1u << stage)))
+		{
+			uint32_t us = tracked->stage_us[stage];
+			frame_latency.counts[frame_latency.window][stage][latency_bucket(us)]++;
+			frame_latency.max_us[stage] = (us > frame_latency.max_us[stage]) ? us : frame_latency.max_us[stage];
+		}
+	}
+	frame_latency.window_frames++;
+	frame_latency.frames++;
+	taskEXIT_CRITICAL(&frame_latency_mux);
+
+	if (!frame_latency.trace)
+	{
+		return;
+	}
+	if (frame_latency_records_count == FRAME_LATENCY_RECORDS)
+	{
+		frame_latency.records_dropped++;
+		return;
+	}
+	frame_latency_records[(frame_latency_records_head + frame_latency_records_count) % FRAME_LATENCY_RECORDS] = tracked->record;
+	frame_latency_records_count++;
+}
+
+/**
+ * @brief Take the oldest trace record, called by the transmit task
+ *
+ * @param record output
+ * @return true a record was taken
+ */
+bool frame_latency_take_record(MlxLatencyRecord_type *record)
+{
+	if (frame_latency_records_count == 0)
+	{
+		return false;
+	}
+	*record = frame_latency_records[frame_latency_records_head];
+	frame_latency_records_head = (frame_latency_records_head + 1) % FRAME_LATENCY_RECORDS;
+	frame_latency_records_count--;
+	return true;
+}
+
+/**
+ * @brief Send an MLX_PACKET_LATENCY record after every frame, or stop
+ */
+void frame_latency_set_trace(bool trace)
+{
+	frame_latency.trace = trace;
+}
+
+/**
+ * @brief Clear the histograms and counters
+ */
+void frame_latency_reset(void)
+{
+	taskENTER_CRITICAL(&frame_latency_mux);
+	memset(frame_latency.counts, 0, sizeof(frame_latency.counts));
+	memset(frame_latency.max_us, 0, sizeof(frame_latency.max_us));
+	frame_latency.window = 0;
+	frame_latency.window_frames = 0;
+	frame_latency.frames = 0;
+	frame_latency.unmatched = 0;
+	frame_latency.records_dropped = 0;
+	taskEXIT_CRITICAL(&frame_latency_mux);
+}
+
+/**
+ * @brief Stage of a name, e.g. READ0
+ *
+ * @return FRAME_LATENCY_* stage
+ * @return -1 unknown name
+ */
+int frame_latency_stage(const char *name)
+{
+	for (int stage = 0; stage < FRAME_LATENCY_STAGES; stage++)
+	{
+		if (strcmp(name, frame_latency_stage_names[stage]) == 0)
+		{
+			return stage;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Both windows of a stage added up
+ *
+ * @return number of frames
+ */
+static uint32_t latency_counts(uint8_t stage, uint32_t *counts)
+{
+	uint32_t frames = 0;
+	taskENTER_CRITICAL(&frame_latency_mux);
+	for (int bucket = 0; bucket < FRAME_LATENCY_BUCKETS; bucket++)
+	{
+		counts[bucket] = frame_latency.counts[0][stage][bucket] + frame_latency.counts[1][stage][bucket];
+		frames += counts[bucket];
+	}
+	taskEXIT_CRITICAL(&frame_latency_mux);
+	return frames;
+}
+
+/**
+ * @brief Upper bound in us of the bucket holding a percentile, the maximum in the last bucket
+ */
+static uint32_t latency_percentile(const uint32_t *counts, uint32_t frames, uint8_t stage, uint8_t percent)
+{
+	uint32_t rank = (frames * percent + 99) / 100;
+	uint32_t seen = 0;
+	for (int bucket = 0; bucket < FRAME_LATENCY_BUCKETS - 1; bucket++)
+	{
+		seen += counts[bucket];
+		if (seen >= rank && seen > 0)
+		{
+			return (1u << bucket) - 1;
+		}
+	}
+	return frame_latency.max_us[stage];
+}
+
+/**
+ * @brief Write the frame count and the median of every stage as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int frame_latency_format(char *buf, size_t size)
+{
+	uint32_t counts[FRAME_LATENCY_BUCKETS];
+	uint32_t medians[FRAME_LATENCY_STAGES];
+	for (uint8_t stage = 0; stage < FRAME_LATENCY_STAGES; stage++)
+	{
+		uint32_t frames = latency_counts(stage, counts);
+		medians[stage] = latency_percentile(counts, frames, stage, 50);
+	}
+	return snprintf(buf, size, "LATENCY N %lu P50 %lu %lu %lu %lu %lu %lu %lu %lu %lu",
+					(unsigned long)frame_latency.frames,
+					(unsigned long)medians[0], (unsigned long)medians[1], (unsigned long)medians[2],
+					(unsigned long)medians[3], (unsigned long)medians[4], (unsigned long)medians[5],
+					(unsigned long)medians[6], (unsigned long)medians[7], (unsigned long)medians[8]);
+}
+
+/**
+ * @brief Write the percentiles and the histogram of a stage as text
+ *
+ * The histogram is listed from the first to the last non-empty bucket, after the index of the first one.
+ *
+ * @param stage FRAME_LATENCY_* stage
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ * @return -1 unknown stage
+ */
+int frame_latency_format_stage(uint8_t stage, char *buf, size_t size)
+{
+	uint32_t counts[FRAME_LATENCY_BUCKETS];
+	if (stage >= FRAME_LATENCY_STAGES)
+	{
+		return -1;
+	}
+	uint32_t frames = latency_counts(stage, counts);
+	int first = 0;
+	int last = FRAME_LATENCY_BUCKETS - 1;
+	while (first < last && counts[first] == 0)
+	{
+		first++;
+	}
+	while (last > first && counts[last] == 0)
+	{
+		last--;
+	}
+	int length = snprintf(buf, size, "LATENCY %s N %lu P50 %lu P90 %lu P99 %lu MAX %lu B %d",
+						  frame_latency_stage_names[stage], (unsigned long)frames,
+						  (unsigned long)latency_percentile(counts, frames, stage, 50),
+						  (unsigned long)latency_percentile(counts, frames, stage, 90),
+						  (unsigned long)latency_percentile(counts, frames, stage, 99),
+						  (unsigned long)frame_latency.max_us[stage], first);
+	for (int bucket = first; bucket <= last && length > 0 && (size_t)length < size; bucket++)
+	{
+		length += snprintf(buf + length, size - length, " %lu", (unsigned long)counts[bucket]);
+	}
+	return length;
+}
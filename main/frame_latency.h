@@ -0,0 +1,66 @@
+#ifndef FRAME_LATENCY_H
+#define FRAME_LATENCY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "mlx_protocol.h"
+
+#define FRAME_LATENCY_TOTAL 0	   /*!< Histogram of MLX_LATENCY_REQUEST to MLX_LATENCY_TX_DONE*/
+#define FRAME_LATENCY_STAGES 9	   /*!< TOTAL, then the time up to every other MLX_LATENCY_* point*/
+#define FRAME_LATENCY_BUCKETS 24   /*!< Bucket b counts times below 2^b us, the last one everything above*/
+#define FRAME_LATENCY_WINDOW 256   /*!< Frames per histogram window, two windows are kept*/
+#define FRAME_LATENCY_IN_FLIGHT 16 /*!< Frames tracked from the transmit task until they left the TX buffer*/
+#define FRAME_LATENCY_RECORDS 8	   /*!< Trace records waiting for the transmit task*/
+
+/**
+ * @brief Pipeline times of one frame
+ *
+ * Written by the acquisition task while the frame is read, then by the merge task, and handed over
+ * with the frame buffer.
+ */
+typedef struct FrameLatency_type
+{
+	MlxLatencyRecord_type record;
+	uint32_t stage_us[MLX_LATENCY_POINTS]; // time since the previous point, in the order they were passed
+	uint32_t last_offset_us;
+	bool active;
+} FrameLatency_type;
+
+/**
+ * @brief Rolling latency histograms of the frames that left the TX buffer
+ *
+ * Frames are counted in windows of FRAME_LATENCY_WINDOW frames, queries add the current and the
+ * previous window.
+ */
+typedef struct FrameLatencyStats_type
+{
+	uint32_t counts[2][FRAME_LATENCY_STAGES][FRAME_LATENCY_BUCKETS];
+	uint32_t max_us[FRAME_LATENCY_STAGES]; // since the last reset
+	uint8_t window;
+	uint16_t window_frames;
+	uint32_t frames;
+	uint32_t unmatched; // completed frames without a tracked record
+	uint32_t records_dropped;
+	bool trace; // send an MLX_PACKET_LATENCY record after every frame
+} FrameLatencyStats_type;
+
+extern FrameLatencyStats_type frame_latency;
+
+void frame_latency_request(void);
+int64_t frame_latency_take_request(void);
+void frame_latency_begin(int64_t request_us);
+void frame_latency_mark(uint8_t point);
+void frame_latency_handoff(FrameLatency_type *latency);
+void frame_latency_sent(const FrameLatency_type *latency, uint32_t sequence, int64_t tx_start_us);
+void frame_latency_complete(uint32_t sequence);
+bool frame_latency_take_record(MlxLatencyRecord_type *record);
+void frame_latency_set_trace(bool trace);
+void frame_latency_reset(void);
+int frame_latency_stage(const char *name);
+int frame_latency_format(char *buf, size_t size);
+int frame_latency_format_stage(uint8_t stage, char *buf, size_t size);
+
+#endif // FRAME_LATENCY_H
@@ -36,6 +36,11 @@ static int IsPixelBad(uint16_t pixel, paramsMLX90640 *params);
 static int ValidateFrameData(uint16_t *frameData);
 static int ValidateAuxData(uint16_t *auxData);
 
+// Subpage period of the last refresh rate written to the sensor, used for the data ready timeouts
+static uint16_t refreshMillis = MLX_REFRESH_MILLIS;
+// esp timer time of the last data ready flag seen by MLX90640_GetFrameData
+static int64_t dataReadyTime = 0;
+
 int MLX90640_DumpEE(uint8_t slaveAddr, uint16_t *eeData)
 {
     return MLX90640_I2CRead(slaveAddr, MLX90640_EEPROM_START_ADDRESS, MLX90640_EEPROM_DUMP_NUM, eeData);
@@ -55,7 +60,7 @@ int MLX90640_SynchFrame(uint8_t slaveAddr)
     }
 
     // Added timeout to prevent infinite loop
-    uint64_t timeout = MLX_REFRESH_MILLIS * 2 * 1000; // esp timer is in micros
+    uint64_t timeout = (uint64_t)refreshMillis * 2 * 1000; // esp timer is in micros
     uint64_t deltatime = 0;
     uint64_t start_time = esp_timer_get_time();
     while (dataReady == 0)
@@ -133,7 +138,7 @@ int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t *frameData, uint32_t *last
     uint8_t cnt = 0;
 
     // Added timeout to prevent infinite loop
-    uint64_t timeout = MLX_REFRESH_MILLIS * 1000; // esp timer is in micros, therefore t * 1000
+    uint64_t timeout = (uint64_t)refreshMillis * 1000; // esp timer is in micros, therefore t * 1000
     uint64_t deltatime = 0;
     uint64_t start_time = esp_timer_get_time();
     while (dataReady == 0)
@@ -154,6 +159,7 @@ int MLX90640_GetFrameData(uint8_t slaveAddr, uint16_t *frameData, uint32_t *last
         }
     }
     *last_wake_time = xTaskGetTickCount();
+    dataReadyTime = esp_timer_get_time();
     // Reset the data ready bit
     error_code = MLX90640_I2CWrite(slaveAddr, MLX90640_STATUS_REG, MLX90640_INIT_STATUS_VALUE);
     if (error_code != MLX90640_NO_ERROR)
@@ -358,12 +364,30 @@ int MLX90640_SetRefreshRate(uint8_t slaveAddr, uint8_t refreshRate)
         value = (controlRegister1 & MLX90640_CTRL_REFRESH_MASK) | value;
         error = MLX90640_I2CWrite(slaveAddr, MLX90640_CTRL_REG, value);
     }
+    if (error == MLX90640_NO_ERROR)
+    {
+        refreshMillis = MLX_REFRESH_MILLIS_LUT[refreshRate & 0x07];
+    }
 
     return error;
 }
 
 //------------------------------------------------------------------------------
 
+int MLX90640_GetRefreshMillis(void)
+{
+    return refreshMillis;
+}
+
+//------------------------------------------------------------------------------
+
+int64_t MLX90640_GetDataReadyTime(void)
+{
+    return dataReadyTime;
+}
+
+//------------------------------------------------------------------------------
+
 int MLX90640_GetRefreshRate(uint8_t slaveAddr)
 {
     uint16_t controlRegister1;
@@ -18,8 +18,12 @@
 #define _MLX90640_API_H_
 
 #include <math.h>
+#ifdef ESP_PLATFORM
 #include "freertos/FreeRTOS.h"
 #include "esp_timer.h"
+#else
+#include "mlx90640_host.h" // host tools, see host/mlx90640_host.h
+#endif
 #include <mlx90640_i2c_driver.h>
 
 #define MLX90640_NO_ERROR 0
@@ -129,6 +133,8 @@ int MLX90640_SetResolution(uint8_t slaveAddr, uint8_t resolution);
 int MLX90640_GetCurResolution(uint8_t slaveAddr);
 int MLX90640_SetRefreshRate(uint8_t slaveAddr, uint8_t refreshRate);
 int MLX90640_GetRefreshRate(uint8_t slaveAddr);
+int MLX90640_GetRefreshMillis(void);
+int64_t MLX90640_GetDataReadyTime(void);
 int MLX90640_GetSubPageNumber(uint16_t *frameData);
 int MLX90640_GetCurMode(uint8_t slaveAddr);
 int MLX90640_SetInterleavedMode(uint8_t slaveAddr);
@@ -1,4 +1,5 @@
 #include "mlx90640_i2c_driver.h"
+#include "mlx_i2c_recorder.h"
 
 // Define the I2C master bus configuration
 const i2c_master_bus_config_t i2c_master_bus_config = {
@@ -64,6 +65,7 @@ int MLX90640_I2CGeneralReset()
 {
 	uint8_t write_buffer[2] = {0x00, 0x06};
 	int ack = i2c_master_transmit(master_dev_handle, write_buffer, 2, I2C_TIMEOUT_MS);
+	mlx_i2c_recorder_record(MLX_I2C_TRACE_RESET, 0x0006, 0, NULL, ack);
 	return ack;
 }
 
@@ -98,6 +100,7 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
 	if (i2c_master_transmit_receive(master_dev_handle, write_buffer, 2, read_buffer, nMemAddressRead * 2, I2C_TIMEOUT_MS) != ESP_OK)
 	{
 		free(read_buffer);
+		mlx_i2c_recorder_record(MLX_I2C_TRACE_READ, startAddress, nMemAddressRead, NULL, -3);
 		return -3;
 		
 	}
@@ -108,6 +111,7 @@ int MLX90640_I2CRead(uint8_t slaveAddr, uint16_t startAddress, uint16_t nMemAddr
 	}
 
 	free(read_buffer);
+	mlx_i2c_recorder_record(MLX_I2C_TRACE_READ, startAddress, nMemAddressRead, data, 0);
 	return 0;
 }
 
@@ -124,9 +128,11 @@ int MLX90640_I2CWrite(uint8_t slaveAddr, uint16_t writeAddress, uint16_t data)
 	if (i2c_master_transmit(master_dev_handle, write_buffer, 4, I2C_TIMEOUT_MS) != ESP_OK)
 	{
 		ESP_LOGE(TAG, "Error i2c master transmit");
+		mlx_i2c_recorder_record(MLX_I2C_TRACE_WRITE, writeAddress, 1, &data, -1);
 		return -1;
 	}
 
+	mlx_i2c_recorder_record(MLX_I2C_TRACE_WRITE, writeAddress, 1, &data, 0);
 	return 0;
 }
 
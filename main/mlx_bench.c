@@ -0,0 +1,184 @@
+#include "mlx_bench.h"
+
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+static const char *mlx_bench_stage_names[MLX_BENCH_STAGES] = {"POLL", "READ", "TAVDD", "TO", "BADPIX", "MERGE", "ENCODE"};
+
+/**
+ * @brief Buffers of one run, the raw subpage is read once and every stage works on it
+ */
+typedef struct MlxBenchContext_type
+{
+	uint16_t raw[MLX_RAW_SUBPAGE_SIZE];
+	uint16_t burst[MLX90640_PIXEL_NUM];
+	float temps[MLX_FRAME_SIZE];
+	float frame_temps[MLX_FRAME_SIZE];
+	uint8_t encoded[MLX_FRAME_SIZE * sizeof(float)];
+	int encoded_size;
+	uint8_t pixel_format;
+	int mode;
+	float ta;
+	volatile float vdd;	   // results the compiler could drop otherwise
+	volatile uint32_t crc;
+} MlxBenchContext_type;
+
+static int compare_cycles(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Run one iteration of a stage
+ *
+ * @return 0 OK
+ * @return -1 I2C error
+ */
+static int bench_stage(uint8_t stage, MlxBenchContext_type *context, uint32_t iteration)
+{
+	uint16_t status;
+	float offset;
+	float scale;
+	MlxPacketHeader_type header;
+
+	switch (stage)
+	{
+	case MLX_BENCH_POLL:
+		return (MLX90640_I2CRead(MLX90640_SLAVE_ADR, MLX90640_STATUS_REG, 1, &status) == 0) ? 0 : -1;
+
+	case MLX_BENCH_READ:
+		return (MLX90640_I2CRead(MLX90640_SLAVE_ADR, MLX90640_PIXEL_DATA_START_ADDRESS, MLX90640_PIXEL_NUM, context->burst) == 0) ? 0 : -1;
+
+	case MLX_BENCH_TA_VDD:
+		context->vdd = MLX90640_GetVdd(context->raw, &mlx90640_params);
+		context->ta = MLX90640_GetTa(context->raw, &mlx90640_params);
+		return 0;
+
+	case MLX_BENCH_TO:
+		MLX90640_CalculateTo(context->raw, &mlx90640_params, mlx_config.emissivity, context->ta + mlx_config.ambient_offset, context->temps);
+		return 0;
+
+	case MLX_BENCH_BAD_PIXELS:
+		MLX90640_BadPixelsCorrection(mlx90640_params.brokenPixels, context->temps, context->mode, &mlx90640_params);
+		MLX90640_BadPixelsCorrection(mlx90640_params.outlierPixels, context->temps, context->mode, &mlx90640_params);
+		return 0;
+
+	case MLX_BENCH_MERGE:
+		context->encoded_size = mlx_merge_subpages(context->frame_temps, context->temps, context->temps, context->pixel_format, context->encoded, &offset, &scale);
+		return 0;
+
+	case MLX_BENCH_ENCODE:
+		mlx_packet_header_init(&header, MLX_PACKET_FRAME, iteration, esp_timer_get_time(), context->encoded_size);
+		header.pixel_format = context->pixel_format;
+		context->crc = mlx_packet_crc(&header, (context->pixel_format == MLX_PIXEL_FLOAT32) ? (const uint8_t *)context->frame_temps : context->encoded);
+		return 0;
+	}
+	return 0;
+}
+
+/**
+ * @brief Time every pipeline stage in isolation on the running core
+ *
+ * One subpage is read from the sensor first, the calculation stages work on it. Each stage runs
+ * iterations times, timed with the cycle counter of the core. The caller must own the sensor, no
+ * frame may be in flight. The merge and encode stages use the output pixel format, delta frames are
+ * merged as float32 without touching the delta encoder.
+ *
+ * @param iterations 1 to MLX_BENCH_MAX_ITERATIONS
+ * @param bench output
+ * @return 0 OK
+ * @return -1 invalid iterations
+ * @return -2 out of memory
+ * @return -3 failed to read a subpage
+ * @return -4 I2C error during a stage
+ */
+int mlx_bench_run(uint16_t iterations, MlxBench_type *bench)
+{
+	const char *TAG = "mlx_bench_run";
+	uint32_t last_wake_time = 0;
+
+	if (iterations < 1 || iterations > MLX_BENCH_MAX_ITERATIONS)
+	{
+		return -1;
+	}
+	MlxBenchContext_type *context = calloc(1, sizeof(MlxBenchContext_type));
+	uint32_t *cycles = malloc(iterations * sizeof(uint32_t));
+	if (context == NULL || cycles == NULL)
+	{
+		free(context);
+		free(cycles);
+		return -2;
+	}
+	if (MLX90640_GetFrameData(MLX90640_SLAVE_ADR, context->raw, &last_wake_time) < 0)
+	{
+		ESP_LOGW(TAG, "Failed to read a subpage");
+		free(context);
+		free(cycles);
+		return -3;
+	}
+	context->ta = MLX90640_GetTa(context->raw, &mlx90640_params);
+	context->mode = (context->raw[832] & MLX90640_CTRL_MEAS_MODE_MASK) >> MLX90640_CTRL_MEAS_MODE_SHIFT;
+	context->pixel_format = (mlx_config.pixel_format == MLX_PIXEL_DELTA) ? MLX_PIXEL_FLOAT32 : mlx_config.pixel_format;
+	context->encoded_size = MLX_FRAME_SIZE * sizeof(float);
+
+	int error_code = 0;
+	bench->cpu_hz = esp_rom_get_cpu_ticks_per_us() * 1000000;
+	bench->iterations = iterations;
+	for (uint8_t stage = 0; stage < MLX_BENCH_STAGES; stage++)
+	{
+		for (uint16_t i = 0; i < iterations; i++)
+		{
+			uint32_t start = esp_cpu_get_cycle_count();
+			error_code = bench_stage(stage, context, i);
+			cycles[i] = esp_cpu_get_cycle_count() - start;
+			if (error_code != 0)
+			{
+				ESP_LOGW(TAG, "Stage %s failed", mlx_bench_stage_names[stage]);
+				error_code = -4;
+				break;
+			}
+			if (i % MLX_BENCH_YIELD_ITERATIONS == MLX_BENCH_YIELD_ITERATIONS - 1)
+			{
+				vTaskDelay(1);
+			}
+		}
+		if (error_code != 0)
+		{
+			break;
+		}
+		// Nearest rank percentiles
+		qsort(cycles, iterations, sizeof(uint32_t), compare_cycles);
+		MlxBenchStage_type *result = &bench->stages[stage];
+		result->min = cycles[0];
+		result->median = cycles[(iterations - 1) / 2];
+		result->p99 = cycles[(iterations * 99 + 99) / 100 - 1];
+		result->max = cycles[iterations - 1];
+	}
+	free(context);
+	free(cycles);
+	return error_code;
+}
+
+/**
+ * @brief Write the cycle counts of one stage as text
+ *
+ * @param bench mlx_bench_run result
+ * @param stage MLX_BENCH_* stage
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ * @return -1 unknown stage
+ */
+int mlx_bench_format_stage(const MlxBench_type *bench, uint8_t stage, char *buf, size_t size)
+{
+	if (stage >= MLX_BENCH_STAGES)
+	{
+		return -1;
+	}
+	const MlxBenchStage_type *result = &bench->stages[stage];
+	return snprintf(buf, size, "BENCH %s MIN %lu MED %lu P99 %lu MAX %lu", mlx_bench_stage_names[stage],
+					(unsigned long)result->min, (unsigned long)result->median,
+					(unsigned long)result->p99, (unsigned long)result->max);
+}
@@ -0,0 +1,45 @@
+#ifndef MLX_BENCH_H
+#define MLX_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "custom_mlx_functions.h"
+
+#define MLX_BENCH_POLL 0	   /*!< Status register read*/
+#define MLX_BENCH_READ 1	   /*!< Pixel burst read, 768 words*/
+#define MLX_BENCH_TA_VDD 2	   /*!< MLX90640_GetVdd and MLX90640_GetTa*/
+#define MLX_BENCH_TO 3		   /*!< MLX90640_CalculateTo of one subpage*/
+#define MLX_BENCH_BAD_PIXELS 4 /*!< MLX90640_BadPixelsCorrection of the broken and outlier pixels*/
+#define MLX_BENCH_MERGE 5	   /*!< mlx_merge_subpages in the output pixel format*/
+#define MLX_BENCH_ENCODE 6	   /*!< Frame packet header and CRC*/
+#define MLX_BENCH_STAGES 7
+
+#define MLX_BENCH_DEFAULT_ITERATIONS 50
+#define MLX_BENCH_MAX_ITERATIONS 100 /*!< About 4 s of burst reads, the command task and acquisition are blocked meanwhile*/
+#define MLX_BENCH_YIELD_ITERATIONS 16 /*!< Iterations between yields, keeps the idle task watchdog fed*/
+
+/**
+ * @brief Cycle counts of one stage over all iterations
+ */
+typedef struct MlxBenchStage_type
+{
+	uint32_t min;
+	uint32_t median;
+	uint32_t p99;
+	uint32_t max;
+} MlxBenchStage_type;
+
+/**
+ * @brief Result of a self benchmark, cycles of the core that ran it
+ */
+typedef struct MlxBench_type
+{
+	uint32_t cpu_hz;
+	uint16_t iterations;
+	MlxBenchStage_type stages[MLX_BENCH_STAGES];
+} MlxBench_type;
+
+int mlx_bench_run(uint16_t iterations, MlxBench_type *bench);
+int mlx_bench_format_stage(const MlxBench_type *bench, uint8_t stage, char *buf, size_t size);
+
+#endif // MLX_BENCH_H
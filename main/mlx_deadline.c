@@ -0,0 +1,105 @@
+#include "mlx_deadline.h"
+
+MlxDeadline_type mlx_deadline = {
+	.min_slack_us = {INT32_MAX, INT32_MAX, INT32_MAX, INT32_MAX},
+};
+
+/**
+ * @brief Record when a stage finished
+ *
+ * @param stage DEADLINE_* stage index
+ * @param deadline_us esp timer time the stage was due
+ * @param done_us esp timer time the stage finished
+ * @return slack in microseconds, negative on overrun
+ */
+int32_t mlx_deadline_record(uint8_t stage, int64_t deadline_us, int64_t done_us)
+{
+	if (stage >= DEADLINE_STAGES)
+	{
+		return 0;
+	}
+	int32_t slack = deadline_us - done_us;
+	mlx_deadline.slack_us[stage] = slack;
+	if (slack < mlx_deadline.min_slack_us[stage])
+	{
+		mlx_deadline.min_slack_us[stage] = slack;
+	}
+	return slack;
+}
+
+/**
+ * @brief Update the degradation policy after a frame
+ *
+ * Any overrun or slipped subpage switches to deferred calibration, where both subpages are read
+ * before either is calculated. Inline calibration resumes after DEADLINE_RECOVER_FRAMES frames
+ * in which it would have finished before subpage 1 was ready.
+ *
+ * @param missed a stage of this frame had negative slack
+ * @param slipped the sensor delivered subpage 0 again while waiting for subpage 1
+ * @param predicted_inline_slack_us slack subpage 0 calculation would have had inline
+ */
+void mlx_deadline_end_frame(bool missed, bool slipped, int32_t predicted_inline_slack_us)
+{
+	mlx_deadline.frames++;
+	mlx_deadline.misses += missed;
+	mlx_deadline.slipped_frames += slipped;
+
+	if (missed || slipped)
+	{
+		mlx_deadline.defer_calibration = true;
+		mlx_deadline.on_time_frames = 0;
+		return;
+	}
+	if (!mlx_deadline.defer_calibration)
+	{
+		return;
+	}
+	if (predicted_inline_slack_us <= 0)
+	{
+		mlx_deadline.on_time_frames = 0;
+		return;
+	}
+	if (++mlx_deadline.on_time_frames >= DEADLINE_RECOVER_FRAMES)
+	{
+		mlx_deadline.defer_calibration = false;
+		mlx_deadline.on_time_frames = 0;
+	}
+}
+
+/**
+ * @brief Clear the slack history, e.g. after the refresh rate changed
+ */
+void mlx_deadline_reset(void)
+{
+	for (int i = 0; i < DEADLINE_STAGES; i++)
+	{
+		mlx_deadline.slack_us[i] = 0;
+		mlx_deadline.min_slack_us[i] = INT32_MAX;
+	}
+	mlx_deadline.on_time_frames = 0;
+	mlx_deadline.defer_calibration = false;
+}
+
+/**
+ * @brief Write the last and worst slack of every stage as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int mlx_deadline_format(char *buf, size_t size)
+{
+	int32_t min_slack[DEADLINE_STAGES];
+	for (int i = 0; i < DEADLINE_STAGES; i++)
+	{
+		min_slack[i] = (mlx_deadline.min_slack_us[i] == INT32_MAX) ? 0 : mlx_deadline.min_slack_us[i];
+	}
+	return snprintf(buf, size, "SLACK %ld %ld %ld %ld MIN %ld %ld %ld %ld MISS %lu DEFER %lu SLIP %lu %s",
+					(long)mlx_deadline.slack_us[DEADLINE_READ_0], (long)mlx_deadline.slack_us[DEADLINE_CALC_0],
+					(long)mlx_deadline.slack_us[DEADLINE_READ_1], (long)mlx_deadline.slack_us[DEADLINE_CALC_1],
+					(long)min_slack[DEADLINE_READ_0], (long)min_slack[DEADLINE_CALC_0],
+					(long)min_slack[DEADLINE_READ_1], (long)min_slack[DEADLINE_CALC_1],
+					(unsigned long)mlx_deadline.misses, (unsigned long)mlx_deadline.deferred_frames,
+					(unsigned long)mlx_deadline.slipped_frames,
+					mlx_deadline.defer_calibration ? "DEFERRED" : "INLINE");
+}
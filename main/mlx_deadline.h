@@ -0,0 +1,40 @@
+#ifndef MLX_DEADLINE_H
+#define MLX_DEADLINE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DEADLINE_READ_0 0 /*!< Subpage 0 read, due when subpage 1 is ready*/
+#define DEADLINE_CALC_0 1 /*!< Subpage 0 calculated, due when subpage 1 is ready (or with subpage 1 when deferred)*/
+#define DEADLINE_READ_1 2 /*!< Subpage 1 read, due before the sensor overwrites it with the next subpage*/
+#define DEADLINE_CALC_1 3 /*!< Subpage 1 calculated, due at the end of the frame*/
+#define DEADLINE_STAGES 4
+
+#define DEADLINE_RECOVER_FRAMES 8 /*!< Frames with predicted positive slack before calibrating inline again*/
+
+/**
+ * @brief Slack of every pipeline stage relative to the sensor period
+ *
+ * Positive slack is time left until the stage deadline, negative slack is an overrun.
+ */
+typedef struct MlxDeadline_type
+{
+	int32_t slack_us[DEADLINE_STAGES];
+	int32_t min_slack_us[DEADLINE_STAGES];
+	uint32_t frames;
+	uint32_t misses;
+	uint32_t deferred_frames;
+	uint32_t slipped_frames;
+	uint16_t on_time_frames;
+	bool defer_calibration;
+} MlxDeadline_type;
+
+extern MlxDeadline_type mlx_deadline;
+
+int32_t mlx_deadline_record(uint8_t stage, int64_t deadline_us, int64_t done_us);
+void mlx_deadline_end_frame(bool missed, bool slipped, int32_t predicted_inline_slack_us);
+void mlx_deadline_reset(void);
+int mlx_deadline_format(char *buf, size_t size);
+
+#endif // MLX_DEADLINE_H
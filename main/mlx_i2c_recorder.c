@@ -0,0 +1,201 @@
+#include "mlx_i2c_recorder.h"
+
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "mlx90640_api.h"
+
+MlxI2cRecorder_type mlx_i2c_recorder = {0};
+// Both sides are tasks, a mutex keeps interrupts on while payloads are copied
+static SemaphoreHandle_t mlx_i2c_recorder_mutex = NULL;
+
+/**
+ * @brief Append to the fill chunk, a full fill chunk is handed to the transmit task first
+ *
+ * Called with the mutex held.
+ *
+ * @return 0 OK
+ * @return -1 all chunks are waiting for the transmit task
+ */
+static int recorder_append(const MlxI2cTraceEntry_type *entry, const uint16_t *words)
+{
+	MlxI2cRecorder_type *recorder = &mlx_i2c_recorder;
+	if (recorder->full == MLX_I2C_RECORDER_CHUNKS)
+	{
+		return -1;
+	}
+	MlxI2cTraceChunk_type *fill = &recorder->chunks[(recorder->head + recorder->full) % MLX_I2C_RECORDER_CHUNKS];
+	if (mlx_i2c_trace_append(fill, entry, words) == 0)
+	{
+		return 0;
+	}
+	recorder->full++;
+	if (recorder->full == MLX_I2C_RECORDER_CHUNKS)
+	{
+		return -1;
+	}
+	fill = &recorder->chunks[(recorder->head + recorder->full) % MLX_I2C_RECORDER_CHUNKS];
+	fill->size = 0;
+	return mlx_i2c_trace_append(fill, entry, words);
+}
+
+/**
+ * @brief Start a trace
+ *
+ * The trace begins with the EEPROM read of the startup, so a replay starts like the device did.
+ * Chunks of a previous trace that were not sent yet are discarded.
+ *
+ * @param eeprom_dump MLX90640_DumpEE words read at startup
+ * @return 0 OK
+ * @return -1 out of memory
+ */
+int mlx_i2c_recorder_start(const uint16_t *eeprom_dump)
+{
+	MlxI2cRecorder_type *recorder = &mlx_i2c_recorder;
+	if (recorder->chunks == NULL)
+	{
+		// Never freed, the transmit task may still be reading a chunk
+		recorder->chunks = calloc(MLX_I2C_RECORDER_CHUNKS, sizeof(MlxI2cTraceChunk_type));
+		if (recorder->chunks == NULL)
+		{
+			return -1;
+		}
+	}
+	if (mlx_i2c_recorder_mutex == NULL && (mlx_i2c_recorder_mutex = xSemaphoreCreateMutex()) == NULL)
+	{
+		return -1;
+	}
+	MlxI2cTraceEntry_type entry = {
+		.op = MLX_I2C_TRACE_READ,
+		.address = MLX90640_EEPROM_START_ADDRESS,
+		.count = MLX90640_EEPROM_DUMP_NUM,
+	};
+
+	xSemaphoreTake(mlx_i2c_recorder_mutex, portMAX_DELAY);
+	recorder->head = 0;
+	recorder->full = 0;
+	recorder->chunks[0].size = 0;
+	recorder->entries = 1;
+	recorder->dropped = 0;
+	recorder->gap = 0;
+	recorder->start_us = esp_timer_get_time();
+	recorder_append(&entry, eeprom_dump);
+	recorder->active = true;
+	xSemaphoreGive(mlx_i2c_recorder_mutex);
+	return 0;
+}
+
+/**
+ * @brief Stop the trace, the partly filled chunk is handed to the transmit task
+ */
+void mlx_i2c_recorder_stop(void)
+{
+	MlxI2cRecorder_type *recorder = &mlx_i2c_recorder;
+	if (mlx_i2c_recorder_mutex == NULL)
+	{
+		return;
+	}
+	xSemaphoreTake(mlx_i2c_recorder_mutex, portMAX_DELAY);
+	if (recorder->active && recorder->full < MLX_I2C_RECORDER_CHUNKS &&
+		recorder->chunks[(recorder->head + recorder->full) % MLX_I2C_RECORDER_CHUNKS].size > 0)
+	{
+		recorder->full++;
+	}
+	recorder->active = false;
+	xSemaphoreGive(mlx_i2c_recorder_mutex);
+}
+
+/**
+ * @brief Record a transaction of the I2C driver, does nothing without an active trace
+ *
+ * @param op MLX_I2C_TRACE_READ, MLX_I2C_TRACE_WRITE or MLX_I2C_TRACE_RESET
+ * @param address register address
+ * @param count words read, 1 for writes
+ * @param words words read or written, NULL if the transaction failed
+ * @param result return value of the driver function
+ */
+void mlx_i2c_recorder_record(uint8_t op, uint16_t address, uint16_t count, const uint16_t *words, int result)
+{
+	MlxI2cRecorder_type *recorder = &mlx_i2c_recorder;
+	if (!recorder->active)
+	{
+		return;
+	}
+	MlxI2cTraceEntry_type entry = {
+		.op = op,
+		.result = (result < INT8_MIN) ? INT8_MIN : (result > INT8_MAX) ? INT8_MAX : result,
+		.address = address,
+		.count = count,
+	};
+
+	// Timed before the wait for the mutex, like the transaction it records
+	int64_t now_us = esp_timer_get_time();
+	xSemaphoreTake(mlx_i2c_recorder_mutex, portMAX_DELAY);
+	entry.time_us = (uint32_t)(now_us - recorder->start_us);
+	if (recorder->gap > 0)
+	{
+		MlxI2cTraceEntry_type gap = {
+			.time_us = entry.time_us,
+			.op = MLX_I2C_TRACE_GAP,
+			.count = (recorder->gap > UINT16_MAX) ? UINT16_MAX : recorder->gap,
+		};
+		if (recorder_append(&gap, NULL) == 0)
+		{
+			recorder->gap = 0;
+		}
+	}
+	if (recorder->gap == 0 && recorder_append(&entry, words) == 0)
+	{
+		recorder->entries++;
+	}
+	else
+	{
+		recorder->dropped++;
+		recorder->gap++;
+	}
+	xSemaphoreGive(mlx_i2c_recorder_mutex);
+}
+
+/**
+ * @brief Take the oldest full chunk, called by the transmit task
+ *
+ * @param chunk output
+ * @return chunk size in bytes, 0 if no chunk is waiting
+ */
+uint16_t mlx_i2c_recorder_take(MlxI2cTraceChunk_type *chunk)
+{
+	MlxI2cRecorder_type *recorder = &mlx_i2c_recorder;
+	uint16_t size = 0;
+	if (mlx_i2c_recorder_mutex == NULL)
+	{
+		return 0;
+	}
+	xSemaphoreTake(mlx_i2c_recorder_mutex, portMAX_DELAY);
+	if (recorder->full > 0)
+	{
+		MlxI2cTraceChunk_type *oldest = &recorder->chunks[recorder->head];
+		size = oldest->size;
+		chunk->size = size;
+		memcpy(chunk->data, oldest->data, size);
+		// A freed chunk is the next fill chunk when all chunks were full
+		oldest->size = 0;
+		recorder->head = (recorder->head + 1) % MLX_I2C_RECORDER_CHUNKS;
+		recorder->full--;
+	}
+	xSemaphoreGive(mlx_i2c_recorder_mutex);
+	return size;
+}
+
+/**
+ * @brief Write the trace status as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int mlx_i2c_recorder_format(char *buf, size_t size)
+{
+	return snprintf(buf, size, "TRACE %s ENTRIES %lu DROPPED %lu",
+					mlx_i2c_recorder.active ? "ON" : "OFF",
+					(unsigned long)mlx_i2c_recorder.entries,
+					(unsigned long)mlx_i2c_recorder.dropped);
+}
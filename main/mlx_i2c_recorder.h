@@ -0,0 +1,39 @@
+#ifndef MLX_I2C_RECORDER_H
+#define MLX_I2C_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mlx_i2c_trace.h"
+
+#define MLX_I2C_RECORDER_CHUNKS 4 /*!< Chunks waiting for the TX task, allocated on the first MLX TRACE ON*/
+
+/**
+ * @brief Trace of the I2C driver, sent to the host while MLX TRACE ON
+ *
+ * The driver records every transaction into the fill chunk. Full chunks wait for the transmit task,
+ * when all chunks are waiting further entries are dropped and a MLX_I2C_TRACE_GAP entry marks the gap.
+ */
+typedef struct MlxI2cRecorder_type
+{
+	volatile bool active;
+	MlxI2cTraceChunk_type *chunks; // MLX_I2C_RECORDER_CHUNKS
+	uint8_t head;				   // oldest full chunk
+	uint8_t full;				   // full chunks, the fill chunk follows them
+	int64_t start_us;
+	uint32_t entries;
+	uint32_t dropped;
+	uint32_t gap; // dropped entries not yet marked in the trace
+} MlxI2cRecorder_type;
+
+extern MlxI2cRecorder_type mlx_i2c_recorder;
+
+int mlx_i2c_recorder_start(const uint16_t *eeprom_dump);
+void mlx_i2c_recorder_stop(void);
+void mlx_i2c_recorder_record(uint8_t op, uint16_t address, uint16_t count, const uint16_t *words, int result);
+uint16_t mlx_i2c_recorder_take(MlxI2cTraceChunk_type *chunk);
+int mlx_i2c_recorder_format(char *buf, size_t size);
+
+#endif // MLX_I2C_RECORDER_H
@@ -0,0 +1,80 @@
+#include "mlx_i2c_trace.h"
+
+/**
+ * @brief Number of words that follow an entry
+ */
+uint16_t mlx_i2c_trace_words(const MlxI2cTraceEntry_type *entry)
+{
+	switch (entry->op)
+	{
+	case MLX_I2C_TRACE_READ:
+		return entry->count;
+	case MLX_I2C_TRACE_WRITE:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Append an entry and its words to a chunk
+ *
+ * @param chunk chunk being filled
+ * @param entry entry
+ * @param words mlx_i2c_trace_words(entry) words, NULL writes zeros (e.g. a failed read)
+ * @return 0 OK
+ * @return -1 the chunk is full
+ */
+int mlx_i2c_trace_append(MlxI2cTraceChunk_type *chunk, const MlxI2cTraceEntry_type *entry, const uint16_t *words)
+{
+	size_t words_size = mlx_i2c_trace_words(entry) * sizeof(uint16_t);
+	if (chunk->size + sizeof(MlxI2cTraceEntry_type) + words_size > MLX_I2C_TRACE_CHUNK_SIZE)
+	{
+		return -1;
+	}
+	memcpy(&chunk->data[chunk->size], entry, sizeof(MlxI2cTraceEntry_type));
+	chunk->size += sizeof(MlxI2cTraceEntry_type);
+	if (words != NULL)
+	{
+		memcpy(&chunk->data[chunk->size], words, words_size);
+	}
+	else
+	{
+		memset(&chunk->data[chunk->size], 0, words_size);
+	}
+	chunk->size += words_size;
+	return 0;
+}
+
+/**
+ * @brief Read the entry at offset and advance offset past its words
+ *
+ * @param data trace
+ * @param size trace size in bytes
+ * @param offset position in the trace, 0 for the first entry
+ * @param entry output
+ * @param words output, the entry words, not aligned
+ * @return 1 entry read
+ * @return 0 end of the trace
+ * @return -1 the trace is cut inside the entry
+ */
+int mlx_i2c_trace_next(const uint8_t *data, size_t size, size_t *offset, MlxI2cTraceEntry_type *entry, const uint8_t **words)
+{
+	if (*offset >= size)
+	{
+		return 0;
+	}
+	if (size - *offset < sizeof(MlxI2cTraceEntry_type))
+	{
+		return -1;
+	}
+	memcpy(entry, &data[*offset], sizeof(MlxI2cTraceEntry_type));
+	size_t words_size = mlx_i2c_trace_words(entry) * sizeof(uint16_t);
+	if (size - *offset - sizeof(MlxI2cTraceEntry_type) < words_size)
+	{
+		return -1;
+	}
+	*words = &data[*offset + sizeof(MlxI2cTraceEntry_type)];
+	*offset += sizeof(MlxI2cTraceEntry_type) + words_size;
+	return 1;
+}
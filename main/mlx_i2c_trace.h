@@ -0,0 +1,54 @@
+#ifndef MLX_I2C_TRACE_H
+#define MLX_I2C_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "mlx_protocol.h"
+
+/**
+ * I2C transaction trace
+ *
+ * Every MLX90640_I2CRead, MLX90640_I2CWrite and MLX90640_I2CGeneralReset as one entry, followed by its
+ * words (little-endian):
+ *
+ * | Op | Words |
+ * | MLX_I2C_TRACE_READ | count words returned by the sensor |
+ * | MLX_I2C_TRACE_WRITE | the word written, count is 1 |
+ * | MLX_I2C_TRACE_RESET | none |
+ * | MLX_I2C_TRACE_GAP | none, count entries were dropped before this one |
+ *
+ * time_us is the completion time since the trace started, it wraps after 71 minutes. The device sends a
+ * trace as MLX_PACKET_I2C_TRACE packets of whole entries, the trace is the concatenation of their payloads.
+ */
+#define MLX_I2C_TRACE_READ 0x01
+#define MLX_I2C_TRACE_WRITE 0x02
+#define MLX_I2C_TRACE_RESET 0x03
+#define MLX_I2C_TRACE_GAP 0x04
+#define MLX_I2C_TRACE_CHUNK_SIZE MLX_PACKET_MAX_PAYLOAD /*!< One chunk per packet, holds the largest read*/
+
+typedef struct MlxI2cTraceEntry_type
+{
+	uint32_t time_us;
+	uint8_t op;
+	int8_t result; // return value of the driver function
+	uint16_t address;
+	uint16_t count;
+	uint16_t reserved;
+} MlxI2cTraceEntry_type;
+
+_Static_assert(sizeof(MlxI2cTraceEntry_type) == 12, "MlxI2cTraceEntry_type must stay 12 bytes");
+
+/**
+ * @brief Entries of one MLX_PACKET_I2C_TRACE packet
+ */
+typedef struct MlxI2cTraceChunk_type
+{
+	uint16_t size;
+	uint8_t data[MLX_I2C_TRACE_CHUNK_SIZE];
+} MlxI2cTraceChunk_type;
+
+uint16_t mlx_i2c_trace_words(const MlxI2cTraceEntry_type *entry);
+int mlx_i2c_trace_append(MlxI2cTraceChunk_type *chunk, const MlxI2cTraceEntry_type *entry, const uint16_t *words);
+int mlx_i2c_trace_next(const uint8_t *data, size_t size, size_t *offset, MlxI2cTraceEntry_type *entry, const uint8_t **words);
+
+#endif // MLX_I2C_TRACE_H
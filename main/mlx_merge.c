@@ -0,0 +1,100 @@
+#include "mlx_merge.h"
+
+#include <math.h>
+#include <stddef.h>
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#else
+#include "mlx90640_host.h"
+#endif
+
+/**
+ * @brief Merge both subpages into frame_temps and encode the output pixels in the same pass.
+ *
+ * Temperatures from subpage 0 and 1 are add together and stored in frame_temps.
+ * With subpage_temps_1 NULL subpage_temps_0 is copied (deinterlaced frame).
+ * frame_temps may point to subpage_temps_0 to merge in place.
+ * MLX_PIXEL_UINT8 needs the frame range, so it takes a second pass over frame_temps.
+ *
+ * @param frame_temps: output temperatures (768 floats)
+ * @param subpage_temps_0
+ * @param subpage_temps_1: NULL to copy subpage_temps_0
+ * @param pixel_format: MLX_PIXEL_* output format, encoded is not written for MLX_PIXEL_FLOAT32
+ * @param encoded: encoded output pixels (768 * pixel_format_size bytes)
+ * @param offset: decoding offset of integer formats
+ * @param scale: decoding scale of integer formats
+ * @return encoded frame size in bytes
+ * @return -1 null pointer passed
+ * @return -2 unknown pixel format
+ */
+int mlx_merge_subpages(float *frame_temps, const float *subpage_temps_0, const float *subpage_temps_1, uint8_t pixel_format, void *encoded, float *offset, float *scale)
+{
+	const char *TAG = "mlx_merge_subpages";
+
+	if (frame_temps == NULL || subpage_temps_0 == NULL || encoded == NULL || offset == NULL || scale == NULL)
+	{
+		ESP_LOGE(TAG, "Null pointer passed!");
+		return -1;
+	}
+
+	*offset = 0;
+	*scale = 1;
+	float temp;
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_FLOAT32:
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			frame_temps[i] = subpage_temps_0[i] + (subpage_temps_1 ? subpage_temps_1[i] : 0);
+		}
+		break;
+
+	case MLX_PIXEL_FLOAT16:
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			temp = subpage_temps_0[i] + (subpage_temps_1 ? subpage_temps_1[i] : 0);
+			frame_temps[i] = temp;
+			((uint16_t *)encoded)[i] = pixel_float_to_half(temp);
+		}
+		break;
+
+	case MLX_PIXEL_INT16:
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			temp = subpage_temps_0[i] + (subpage_temps_1 ? subpage_temps_1[i] : 0);
+			frame_temps[i] = temp;
+			int32_t value = pixel_round(temp * (1.0f / PIXEL_INT16_SCALE));
+			((int16_t *)encoded)[i] = (value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value;
+		}
+		*scale = PIXEL_INT16_SCALE;
+		break;
+
+	case MLX_PIXEL_UINT8:
+	{
+		float min = INFINITY;
+		float max = -INFINITY;
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			temp = subpage_temps_0[i] + (subpage_temps_1 ? subpage_temps_1[i] : 0);
+			frame_temps[i] = temp;
+			min = (temp < min) ? temp : min;
+			max = (temp > max) ? temp : max;
+		}
+		float range_scale = (max - min) / 255.0f;
+		float inverse_scale = (range_scale > 0) ? 1.0f / range_scale : 0;
+		for (int i = 0; i < MLX_FRAME_SIZE; i++)
+		{
+			((uint8_t *)encoded)[i] = pixel_round((frame_temps[i] - min) * inverse_scale);
+		}
+		*offset = min;
+		*scale = range_scale;
+		break;
+	}
+
+	default:
+		ESP_LOGE(TAG, "Unknown pixel format %d", pixel_format);
+		return -2;
+	}
+
+	return MLX_FRAME_SIZE * pixel_format_size(pixel_format);
+}
@@ -0,0 +1,16 @@
+#ifndef MLX_MERGE_H
+#define MLX_MERGE_H
+
+#include <stdint.h>
+#include "constants.h"
+#include "mlx_protocol.h"
+#include "pixel_encoding.h"
+
+/**
+ * Subpage merge and output pixel encoding
+ *
+ * Platform neutral, so the host benchmarks time the same code as the merge task.
+ */
+int mlx_merge_subpages(float *frame_temps, const float *subpage_temps_0, const float *subpage_temps_1, uint8_t pixel_format, void *encoded, float *offset, float *scale);
+
+#endif // MLX_MERGE_H
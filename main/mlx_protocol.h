@@ -0,0 +1,97 @@
+#ifndef MLX_PROTOCOL_H
+#define MLX_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "transport.h"
+
+/**
+ * Binary packet layout (little-endian):
+ *
+ * | MlxPacketHeader_type (32 B) | payload (payload_length B) | CRC32 of header and payload (4 B) |
+ *
+ * A receiver reads the fixed header, checks magic and version, waits for payload_length + 4 more
+ * bytes and verifies the CRC. No byte of the payload needs to be scanned.
+ */
+#define MLX_PACKET_MAGIC_0 'M'
+#define MLX_PACKET_MAGIC_1 'X'
+#define MLX_PACKET_VERSION 2
+#define MLX_PACKET_CRC_SIZE 4
+#define MLX_PACKET_MAX_PAYLOAD (768 * 4)
+
+// Packet types
+#define MLX_PACKET_FRAME 0x01	 /*!< Calculated 32x24 frame*/
+#define MLX_PACKET_RESPONSE 0x02 /*!< Command response text*/
+#define MLX_PACKET_EEPROM 0x03	 /*!< MLX90640_DumpEE words, sent ahead of raw frames*/
+#define MLX_PACKET_I2C_TRACE 0x04 /*!< I2C transactions while MLX TRACE ON, see mlx_i2c_trace.h*/
+#define MLX_PACKET_LATENCY 0x05	  /*!< MlxLatencyRecord_type of a sent frame while MLX LATENCY TRACE ON*/
+
+// Pixel formats, integer formats decode as °C = offset + value * scale
+#define MLX_PIXEL_FLOAT32 0x00 /*!< IEEE 754 single precision °C*/
+#define MLX_PIXEL_FLOAT16 0x01 /*!< IEEE 754 half precision °C*/
+#define MLX_PIXEL_INT16 0x02   /*!< int16, scale 0.01 (hundredths of a degree)*/
+#define MLX_PIXEL_UINT8 0x03   /*!< uint8, offset frame min, scale (max - min) / 255*/
+#define MLX_PIXEL_DELTA 0x04   /*!< frame_codec payload, scale is the quantization step*/
+#define MLX_PIXEL_FORMATS 5
+#define MLX_PIXEL_RAW 0x05	   /*!< MLX90640_GetFrameData words of one subpage, calibrated on the host*/
+
+#define MLX_PACKET_EEPROM_WORDS 832 /*!< MLX_PACKET_EEPROM payload, little-endian uint16*/
+#define MLX_PACKET_RAW_WORDS 834	/*!< MLX_PIXEL_RAW payload: 768 pixels, 64 aux, control, subpage*/
+
+// Subpage info
+#define MLX_SUBPAGE_FULL_FRAME -1 /*!< Frame merged from both subpages*/
+
+typedef struct __attribute__((packed)) MlxPacketHeader_type
+{
+	uint8_t magic[2];
+	uint8_t version;
+	uint8_t type;
+	uint32_t sequence;
+	uint64_t timestamp_us;
+	uint16_t payload_length;
+	uint8_t pixel_format;
+	int8_t subpage;
+	float ta;
+	float offset;
+	float scale;
+} MlxPacketHeader_type;
+
+_Static_assert(sizeof(MlxPacketHeader_type) == 32, "MlxPacketHeader_type must stay 32 bytes");
+
+// Frame pipeline points of MlxLatencyRecord_type, in the order a full frame passes them
+#define MLX_LATENCY_REQUEST 0  /*!< MLX START of a frame started from idle, else its credit was taken*/
+#define MLX_LATENCY_SYNC 1	   /*!< Frame synchronized, full frame output*/
+#define MLX_LATENCY_READ_0 2   /*!< Subpage 0 read*/
+#define MLX_LATENCY_CALC_0 3   /*!< Subpage 0 calculated*/
+#define MLX_LATENCY_READ_1 4   /*!< Subpage 1 read*/
+#define MLX_LATENCY_CALC_1 5   /*!< Subpage 1 calculated*/
+#define MLX_LATENCY_MERGED 6   /*!< Output frame merged and encoded*/
+#define MLX_LATENCY_TX_START 7 /*!< Transmit task started writing the packet*/
+#define MLX_LATENCY_TX_DONE 8  /*!< Packet left the TX ring buffer*/
+#define MLX_LATENCY_POINTS 9
+
+/**
+ * @brief MLX_PACKET_LATENCY payload, sent after the frame packet it describes
+ *
+ * Points a frame did not pass, e.g. SYNC and subpage 1 of raw frames, have their bit in marked clear.
+ * A deferred calculation passes READ_1 before CALC_0, order the points by their offsets.
+ */
+typedef struct __attribute__((packed)) MlxLatencyRecord_type
+{
+	uint32_t sequence; // MLX_PACKET_FRAME sequence number
+	uint16_t marked;   // bit n: point n was passed
+	uint16_t reserved;
+	int64_t request_us;						// device time of MLX_LATENCY_REQUEST
+	uint32_t offset_us[MLX_LATENCY_POINTS]; // time of every point after the request
+} MlxLatencyRecord_type;
+
+_Static_assert(sizeof(MlxLatencyRecord_type) == 52, "MlxLatencyRecord_type must stay 52 bytes");
+
+uint32_t mlx_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+void mlx_packet_header_init(MlxPacketHeader_type *header, uint8_t type, uint32_t sequence, uint64_t timestamp_us, uint16_t payload_length);
+int mlx_packet_header_validate(const MlxPacketHeader_type *header);
+uint32_t mlx_packet_crc(const MlxPacketHeader_type *header, const uint8_t *payload);
+int mlx_packet_write(const Transport_type *transport, const MlxPacketHeader_type *header, const uint8_t *payload);
+
+#endif // MLX_PROTOCOL_H
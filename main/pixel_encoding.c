@@ -0,0 +1,239 @@
+#include "pixel_encoding.h"
+
+/**
+ * @brief Convert to IEEE 754 half precision, rounding to nearest even
+ *
+ * @param value single precision value
+ * @return uint16_t half precision bits
+ */
+uint16_t pixel_float_to_half(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t exponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int32_t half_exponent = (int32_t)exponent - 127 + 15;
+
+	// Inf and NaN
+	if (exponent == 0xFF)
+	{
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	}
+	// Overflow
+	if (half_exponent >= 31)
+	{
+		return sign | 0x7C00;
+	}
+	// Subnormal half or zero
+	if (half_exponent <= 0)
+	{
+		if (half_exponent < -10)
+		{
+			return sign;
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - half_exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+		{
+			half++;
+		}
+		return sign | half;
+	}
+
+	uint32_t half = sign | ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+	uint32_t remainder = mantissa & 0x1FFF;
+	// A carry out of the mantissa correctly increments the exponent
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+	{
+		half++;
+	}
+	return half;
+}
+
+/**
+ * @brief Convert IEEE 754 half precision to single precision
+ *
+ * @param value half precision bits
+ * @return float
+ */
+float pixel_half_to_float(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1F;
+	uint32_t mantissa = value & 0x3FF;
+	uint32_t bits;
+
+	if (exponent == 0)
+	{
+		// Zero or subnormal, mantissa * 2^-24
+		float result = mantissa * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+	if (exponent == 31)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+/**
+ * @brief Bytes per pixel
+ *
+ * @param pixel_format MLX_PIXEL_* format
+ * @return size_t bytes per pixel, 0 for unknown and variable size formats
+ */
+size_t pixel_format_size(uint8_t pixel_format)
+{
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_FLOAT32:
+		return 4;
+	case MLX_PIXEL_FLOAT16:
+	case MLX_PIXEL_INT16:
+		return 2;
+	case MLX_PIXEL_UINT8:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Encode temperatures
+ *
+ * @param temps temperatures in °C
+ * @param count number of pixels
+ * @param pixel_format MLX_PIXEL_* format
+ * @param encoded output, count * pixel_format_size bytes
+ * @param offset decoding offset for integer formats (0 for float formats)
+ * @param scale decoding scale for integer formats (1 for float formats)
+ * @return number of bytes written
+ * @return -1 unknown pixel format
+ */
+int pixel_encode(const float *temps, size_t count, uint8_t pixel_format, void *encoded, float *offset, float *scale)
+{
+	*offset = 0;
+	*scale = 1;
+
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_FLOAT32:
+		memcpy(encoded, temps, count * sizeof(float));
+		break;
+
+	case MLX_PIXEL_FLOAT16:
+	{
+		uint16_t *out = (uint16_t *)encoded;
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = pixel_float_to_half(temps[i]);
+		}
+		break;
+	}
+
+	case MLX_PIXEL_INT16:
+	{
+		int16_t *out = (int16_t *)encoded;
+		for (size_t i = 0; i < count; i++)
+		{
+			int32_t value = pixel_round(temps[i] * (1.0f / PIXEL_INT16_SCALE));
+			out[i] = (value > INT16_MAX) ? INT16_MAX : (value < INT16_MIN) ? INT16_MIN : value;
+		}
+		*scale = PIXEL_INT16_SCALE;
+		break;
+	}
+
+	case MLX_PIXEL_UINT8:
+	{
+		uint8_t *out = (uint8_t *)encoded;
+		float min = temps[0];
+		float max = temps[0];
+		for (size_t i = 1; i < count; i++)
+		{
+			min = (temps[i] < min) ? temps[i] : min;
+			max = (temps[i] > max) ? temps[i] : max;
+		}
+		float range_scale = (max - min) / 255.0f;
+		float inverse_scale = (range_scale > 0) ? 1.0f / range_scale : 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			out[i] = pixel_round((temps[i] - min) * inverse_scale);
+		}
+		*offset = min;
+		*scale = range_scale;
+		break;
+	}
+
+	default:
+		return -1;
+	}
+	return count * pixel_format_size(pixel_format);
+}
+
+/**
+ * @brief Decode temperatures
+ *
+ * @param encoded encoded pixels
+ * @param count number of pixels
+ * @param pixel_format MLX_PIXEL_* format
+ * @param offset decoding offset from the packet header
+ * @param scale decoding scale from the packet header
+ * @param temps output temperatures in °C
+ * @return 0 OK
+ * @return -1 unknown pixel format
+ */
+int pixel_decode(const void *encoded, size_t count, uint8_t pixel_format, float offset, float scale, float *temps)
+{
+	switch (pixel_format)
+	{
+	case MLX_PIXEL_FLOAT32:
+		memcpy(temps, encoded, count * sizeof(float));
+		break;
+
+	case MLX_PIXEL_FLOAT16:
+	{
+		const uint16_t *in = (const uint16_t *)encoded;
+		for (size_t i = 0; i < count; i++)
+		{
+			temps[i] = pixel_half_to_float(in[i]);
+		}
+		break;
+	}
+
+	case MLX_PIXEL_INT16:
+	{
+		const int16_t *in = (const int16_t *)encoded;
+		for (size_t i = 0; i < count; i++)
+		{
+			temps[i] = offset + in[i] * scale;
+		}
+		break;
+	}
+
+	case MLX_PIXEL_UINT8:
+	{
+		const uint8_t *in = (const uint8_t *)encoded;
+		for (size_t i = 0; i < count; i++)
+		{
+			temps[i] = offset + in[i] * scale;
+		}
+		break;
+	}
+
+	default:
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef PIXEL_ENCODING_H
+#define PIXEL_ENCODING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "mlx_protocol.h"
+
+#define PIXEL_INT16_SCALE 0.01f /*!< MLX_PIXEL_INT16 resolution in °C*/
+
+/**
+ * @brief Round half away from zero without a libm call
+ */
+static inline int32_t pixel_round(float value)
+{
+	return (int32_t)(value + ((value >= 0) ? 0.5f : -0.5f));
+}
+
+uint16_t pixel_float_to_half(float value);
+float pixel_half_to_float(uint16_t value);
+size_t pixel_format_size(uint8_t pixel_format);
+int pixel_encode(const float *temps, size_t count, uint8_t pixel_format, void *encoded, float *offset, float *scale);
+int pixel_decode(const void *encoded, size_t count, uint8_t pixel_format, float offset, float scale, float *temps);
+
+#endif // PIXEL_ENCODING_H
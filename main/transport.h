@@ -0,0 +1,75 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRANSPORT_WAIT_FOREVER UINT32_MAX
+#define TRANSPORT_ERROR_OVERFLOW -2 /*!< read: received bytes were lost, resync the stream*/
+#define TRANSPORT_ERROR_NO_SPACE -3 /*!< read: the buffer cannot hold a whole datagram, free space and read again*/
+
+/**
+ * @brief Byte stream carrying commands to the device and packets to the host
+ *
+ * Backends fill the function pointers and pass their state in context. Platform neutral,
+ * see transport_uart.h and transport_usb.h for the device backends and host/transport_fd.h
+ * for the host backend.
+ */
+typedef struct Transport_type
+{
+	const char *name;
+	/**
+	 * @brief Queue bytes for transmission, blocks only while the TX buffer is full
+	 * @return number of bytes written, negative on error
+	 */
+	int (*write)(void *context, const void *data, size_t size);
+	/**
+	 * @brief Read the bytes that arrived, waits up to timeout_ms for the first one
+	 * @return number of bytes read, 0 on timeout, TRANSPORT_ERROR_OVERFLOW or negative on error
+	 */
+	int (*read)(void *context, void *data, size_t size, uint32_t timeout_ms);
+	/**
+	 * @brief Bytes written but not sent yet, NULL when the backend cannot tell
+	 * @return 0 OK, negative on error
+	 */
+	int (*tx_queued)(void *context, size_t *queued);
+	/**
+	 * @brief End of a packet, datagram backends send it now, NULL for byte streams
+	 * @return 0 OK, negative on error
+	 */
+	int (*flush)(void *context);
+	size_t tx_buffer_size; /*!< 0 when unknown*/
+	void *context;
+} Transport_type;
+
+static inline int transport_write(const Transport_type *transport, const void *data, size_t size)
+{
+	return transport->write(transport->context, data, size);
+}
+
+static inline int transport_read(const Transport_type *transport, void *data, size_t size, uint32_t timeout_ms)
+{
+	return transport->read(transport->context, data, size, timeout_ms);
+}
+
+static inline int transport_flush(const Transport_type *transport)
+{
+	return (transport->flush != NULL) ? transport->flush(transport->context) : 0;
+}
+
+/**
+ * @brief Bytes waiting in the TX buffer
+ *
+ * @return 0 OK
+ * @return -1 unknown for this backend
+ */
+static inline int transport_tx_queued(const Transport_type *transport, size_t *queued)
+{
+	if (transport->tx_queued == NULL || transport->tx_buffer_size == 0)
+	{
+		return -1;
+	}
+	return transport->tx_queued(transport->context, queued);
+}
+
+#endif // TRANSPORT_H
@@ -0,0 +1,90 @@
+#include "transport_uart.h"
+#include "uart_isr_handler.h"
+
+static int transport_uart_write(void *context, const void *data, size_t size)
+{
+	TransportUart_type *uart = (TransportUart_type *)context;
+	return uart_write_bytes(uart->port, data, size);
+}
+
+/**
+ * @brief Read the buffered bytes, wait for a uart event when there are none
+ *
+ * Overflow events flush the RX buffer and the event queue.
+ */
+static int transport_uart_read(void *context, void *data, size_t size, uint32_t timeout_ms)
+{
+	TransportUart_type *uart = (TransportUart_type *)context;
+	uart_event_t uart_event;
+	size_t buffered = 0;
+
+	uart_get_buffered_data_len(uart->port, &buffered);
+	if (buffered == 0)
+	{
+		TickType_t ticks = (timeout_ms == TRANSPORT_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+		if (xQueueReceive(uart->event_queue, (void *)&uart_event, ticks) != pdTRUE)
+		{
+			return 0;
+		}
+		switch (uart_event.type)
+		{
+		case UART_DATA:
+			break;
+
+		case UART_FIFO_OVF:
+		case UART_BUFFER_FULL:
+			uart_flush_input(uart->port);
+			xQueueReset(uart->event_queue);
+			return TRANSPORT_ERROR_OVERFLOW;
+
+		default:
+			return 0;
+		}
+	}
+	return uart_read_bytes(uart->port, data, size, 0);
+}
+
+static int transport_uart_tx_queued(void *context, size_t *queued)
+{
+	TransportUart_type *uart = (TransportUart_type *)context;
+	size_t free_size = 0;
+	if (uart_get_tx_buffer_free_size(uart->port, &free_size) != ESP_OK || free_size > uart->tx_buffer_size)
+	{
+		return -1;
+	}
+	*queued = uart->tx_buffer_size - free_size;
+	return 0;
+}
+
+/**
+ * @brief Install the uart driver and fill the transport
+ *
+ * @param transport transport to fill
+ * @param uart backend state, must outlive the transport
+ * @param port valid uart port number
+ * @param gpio_tx tx pin
+ * @param gpio_rx rx pin
+ * @param tx_buff_size tx ring buffer size, writes return once the bytes are queued
+ * @param rx_buff_size rx ring buffer size
+ * @param event_queue_size number of uart events queued
+ * @return 0 OK
+ * @return myuart_init_with_isr_queue error code
+ */
+int transport_uart_init(Transport_type *transport, TransportUart_type *uart, uart_port_t port, int gpio_tx, int gpio_rx, int tx_buff_size, int rx_buff_size, int event_queue_size)
+{
+	int error_code = 0;
+	if ((error_code = myuart_init_with_isr_queue(&uart_config, port, gpio_tx, gpio_rx, tx_buff_size, rx_buff_size, &uart->event_queue, event_queue_size, 0)) != 0)
+	{
+		return error_code;
+	}
+	uart->port = port;
+	uart->tx_buffer_size = tx_buff_size;
+	transport->name = "UART";
+	transport->write = transport_uart_write;
+	transport->read = transport_uart_read;
+	transport->tx_queued = transport_uart_tx_queued;
+	transport->flush = NULL;
+	transport->tx_buffer_size = tx_buff_size;
+	transport->context = uart;
+	return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef TRANSPORT_UART_H
+#define TRANSPORT_UART_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "transport.h"
+
+typedef struct TransportUart_type
+{
+	uart_port_t port;
+	QueueHandle_t event_queue; // uart driver events
+	size_t tx_buffer_size;
+} TransportUart_type;
+
+int transport_uart_init(Transport_type *transport, TransportUart_type *uart, uart_port_t port, int gpio_tx, int gpio_rx, int tx_buff_size, int rx_buff_size, int event_queue_size);
+
+#endif // TRANSPORT_UART_H
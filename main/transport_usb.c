@@ -0,0 +1,59 @@
+#include "transport_usb.h"
+
+#if SOC_USB_SERIAL_JTAG_SUPPORTED
+#include "driver/usb_serial_jtag.h"
+
+static int transport_usb_write(void *context, const void *data, size_t size)
+{
+	return usb_serial_jtag_write_bytes(data, size, portMAX_DELAY);
+}
+
+static int transport_usb_read(void *context, void *data, size_t size, uint32_t timeout_ms)
+{
+	TickType_t ticks = (timeout_ms == TRANSPORT_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+	return usb_serial_jtag_read_bytes(data, size, ticks);
+}
+
+/**
+ * @brief Install the USB-Serial-JTAG driver and fill the transport
+ *
+ * Runs at USB full speed, the baud rate set by the host is ignored. The driver does not report
+ * the TX buffer fill level, so there is no link backpressure and writes block while the host is
+ * not reading.
+ *
+ * @param transport transport to fill
+ * @return 0 OK
+ * @return -1 failed to install the driver
+ */
+int transport_usb_init(Transport_type *transport)
+{
+	usb_serial_jtag_driver_config_t config = {
+		.tx_buffer_size = TRANSPORT_USB_TX_BUFF_SIZE,
+		.rx_buffer_size = TRANSPORT_USB_RX_BUFF_SIZE};
+	if (usb_serial_jtag_driver_install(&config) != ESP_OK)
+	{
+		return -1;
+	}
+	transport->name = "USB";
+	transport->write = transport_usb_write;
+	transport->read = transport_usb_read;
+	transport->tx_queued = NULL;
+	transport->flush = NULL;
+	transport->tx_buffer_size = 0;
+	transport->context = NULL;
+	return 0;
+}
+
+#else
+
+/**
+ * @brief USB-Serial-JTAG is not available on this target
+ *
+ * @return -2 not supported
+ */
+int transport_usb_init(Transport_type *transport)
+{
+	return -2;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef TRANSPORT_USB_H
+#define TRANSPORT_USB_H
+
+#include "freertos/FreeRTOS.h"
+#include "soc/soc_caps.h"
+#include "transport.h"
+
+#define TRANSPORT_USB_TX_BUFF_SIZE (1024 * 8)
+#define TRANSPORT_USB_RX_BUFF_SIZE 1024
+
+int transport_usb_init(Transport_type *transport);
+
+#endif // TRANSPORT_USB_H
@@ -52,256 +52,181 @@ int myuart_init_with_isr_queue(uart_config_t *uart_config, uart_port_t port_num,
 	return 0;
 }
 
+// Fixed message slots, handed to the message handler through queue_enqueued_msg_processing
+static uint8_t message_slots[UART_MSG_SLOT_COUNT][UART_MSG_SLOT_SIZE];
+static QueueHandle_t queue_free_message_slots;
+
+// Flags as they appear in the parser window
+#define ENCAP_WINDOW(pattern) (((uint32_t)(pattern)[0] << 16) | ((uint32_t)(pattern)[1] << 8) | (uint32_t)(pattern)[2])
+#define ENCAP_WINDOW_MASK 0xFFFFFF
+
+enum parser_states
+{
+	PARSER_WAIT_START,
+	PARSER_MESSAGE,
+};
+
 /**
- * @brief Encapsulated message start flag handling
- *
- * Confirm the structure of encapsulated messages start flag.
+ * @brief Create the pool of message slots
  *
- * @param uart_num uart port number
- * @param encap_start_buf uint8_t encapsulation start flag buffer
- * @param pattern_index starting index of the detected pattern
  * @return 0 OK
- * @return -1 failed malloc
- * @return -2 not enough bytes in RX buffer
+ * @return -1 failed to create the free slot queue
  */
-int myuart_encapsulation_start_flag_handler(uart_port_t uart_num, int pattern_index)
+int myuart_message_pool_init(void)
 {
-	const char *TAG = "ENCAP START";
-
-	int message_size = pattern_index + ENCAP_FLAG_SIZE;
-	uint8_t *tmp_buffer = (uint8_t *)malloc(message_size * sizeof(uint8_t));
-	if (tmp_buffer == NULL)
+	queue_free_message_slots = xQueueCreate(UART_MSG_SLOT_COUNT, sizeof(uint8_t *));
+	if (queue_free_message_slots == NULL)
 	{
-		ESP_LOGE(TAG, "Failed to malloc tmp_buffer");
-		return -2;
+		return -1;
 	}
-
-	if (uart_read_bytes(uart_num, tmp_buffer, message_size, pdMS_TO_TICKS(100)) != message_size)
+	for (int i = 0; i < UART_MSG_SLOT_COUNT; i++)
 	{
-		ESP_LOGE(TAG, "Wrong message size");
-		free(tmp_buffer);
-		return -3;
+		uint8_t *slot = message_slots[i];
+		xQueueSend(queue_free_message_slots, &slot, 0);
 	}
-
-	int return_value = memcmp(&tmp_buffer[pattern_index], ENCAP_START_PAT, ENCAP_FLAG_SIZE);
-	free(tmp_buffer);
-	tmp_buffer = NULL;
-
-	return return_value;
+	return 0;
 }
 
 /**
- * @brief Encapsulated message end flag handling
- *
- * Confirm the position and structure of the encapsulated messages end flag
+ * @brief Return a processed message slot to the pool
  *
- * @param uart_num uart port number
- * @param encap_stop_buf uint8_t encapsulation end flag buffer
- * @param pattern_index starting index of the detected pattern
- * @return 0 OK
- * @return -1 wrong pattern indice
- * @return -2 not enough bytes in RX buffer
+ * @param msg_ptr msg_ptr of a TaskQueueMessage_type received from queue_enqueued_msg_processing
  */
-int myuart_encapsulation_end_flag_handler(uart_port_t uart_num, int pattern_index)
+void myuart_message_release(uint8_t *msg_ptr)
 {
-	uint8_t *tmp_buffer = (uint8_t *)malloc(ENCAP_FLAG_SIZE * sizeof(uint8_t));
-
-	const char *TAG = "ENCAP STOP";
-
-	if (pattern_index != 1)
-	{
-		ESP_LOGE(TAG, "Pat indice != -1");
-		return -2;
-	}
-
-	if (uart_read_bytes(uart_num, tmp_buffer, ENCAP_FLAG_SIZE, pdMS_TO_TICKS(100)) != ENCAP_FLAG_SIZE)
+	if (msg_ptr != NULL)
 	{
-		ESP_LOGE(TAG, "Incorrect message size");
-		return -3;
+		xQueueSend(queue_free_message_slots, &msg_ptr, 0);
 	}
-
-	int return_value = memcmp(tmp_buffer, ENCAP_END_PAT, ENCAP_FLAG_SIZE);
-	free(tmp_buffer);
-	tmp_buffer = NULL;
-	return return_value;
 }
 
 /**
- * @brief Store the encapsulated message
+ * @brief Drop the message in progress and wait for a start flag
  *
- * @param uart_num uart port number
- * @param message_buf uint8_t message buffer array
- * @param message_size message buffer size
- * @return 0 OK
- * @return -1 null operator passed
- * @return -2 message_size < 0
- * @return -3 not enough bytes in RX buffer
+ * @param parser uart parser
  */
-int myuart_encapsulated_message_handler(uart_port_t uart_num, uint8_t *message_buf, int message_size)
+void myuart_parser_reset(UartParser_type *parser)
 {
-	/*
-	This function simply reads the encapsulated message that should sit between two encapsulation flags.
-	*/
-	const char *TAG = "ENCAP MSG";
-	if (message_buf == NULL)
+	if (parser->slot != NULL)
 	{
-		ESP_LOGE(TAG, "Null operators passed to the function");
-		return -1;
+		myuart_message_release(parser->slot);
+		parser->slot = NULL;
 	}
-	if (message_size < 0)
-		return -2;
+	parser->state = PARSER_WAIT_START;
+	parser->window = 0;
+	parser->size = 0;
+}
 
-	if (uart_read_bytes(uart_num, message_buf, message_size, pdMS_TO_TICKS(100)) != message_size)
+/**
+ * @brief Start a message after a start flag
+ *
+ * Without a free slot the message is still parsed to find its end, but it is dropped.
+ */
+static void myuart_parser_start(UartParser_type *parser)
+{
+	if (parser->slot == NULL && xQueueReceive(queue_free_message_slots, &parser->slot, 0) != pdTRUE)
 	{
-		ESP_LOGE(TAG, "Wrong message size");
-		return -3;
+		parser->slot = NULL;
 	}
-	return 0;
+	parser->state = PARSER_MESSAGE;
+	parser->window = 0;
+	parser->size = 0;
 }
 
-int myuart_message_send_to_queue(uint8_t *message, size_t message_size)
+/**
+ * @brief Pass a complete message to the message handler
+ *
+ * @return 1 message queued
+ * @return 0 message dropped
+ */
+static int myuart_parser_end(UartParser_type *parser)
 {
-	const char *TAG = "MSG PREP SEND TO Q";
+	const char *TAG = "UART PARSER";
+	int queued = 0;
+	size_t message_size = parser->size - ENCAP_FLAG_SIZE;
 
-	if (message == NULL)
+	if (message_size < 1 || parser->size > UART_MSG_SLOT_SIZE)
 	{
-		ESP_LOGE(TAG, "Message null pointer passed");
-		return -1;
+		ESP_LOGW(TAG, "Bad message size %u", (unsigned)message_size);
+		parser->errors++;
 	}
-
-	TaskQueueMessage_type message_to_queue = {
-		.msg_ptr = (uint8_t *)malloc(message_size * sizeof(uint8_t)),
-		.msg_size = message_size};
-
-	if (message_to_queue.msg_ptr == NULL)
+	else if (parser->slot == NULL)
 	{
-		ESP_LOGE(TAG, "Failed to malloc queued message buffer");
-		return -2;
+		ESP_LOGW(TAG, "No free message slot");
+		parser->dropped++;
 	}
-	// Copy message to the new address
-	memcpy(message_to_queue.msg_ptr, message, message_size * sizeof(uint8_t));
-
-	// Send the message to queue
-	if (xQueueSend(queue_enqueued_msg_processing, &message_to_queue, portMAX_DELAY) != pdTRUE)
+	else
 	{
-		free(message_to_queue.msg_ptr);
-		return -3;
+		TaskQueueMessage_type message_to_queue = {
+			.msg_size = message_size,
+			.msg_ptr = parser->slot};
+		// Never blocks, the queue holds as many messages as there are slots
+		if (xQueueSend(queue_enqueued_msg_processing, &message_to_queue, 0) == pdTRUE)
+		{
+			parser->slot = NULL;
+			parser->messages++;
+			queued = 1;
+		}
+		else
+		{
+			parser->dropped++;
+		}
 	}
-	return 0;
+	// The slot is kept for the next message if it was not queued
+	parser->state = PARSER_WAIT_START;
+	parser->window = 0;
+	parser->size = 0;
+	return queued;
 }
 
 /**
- * @brief Handles the state of the received message and manages the UART communication flow
+ * @brief Feed received bytes to the parser
  *
- * Function checks if the successfull start and stop flags have been received and if the received message was complete.
+ * Messages are framed as ++*message*++. Bytes outside of a frame are ignored and a start flag inside a
+ * message restarts it, so the parser resynchronizes on the next start flag after any framing error.
  *
- * @param uart_num uart port number
- * @param encap_state encapsulation state counter (nothing happened = 0, start flag received = 1, stop flag received = 2)
- * @param pattern_index index of the detected pattern
- * @param encap_start_buf debug buffer for checking how the received start flag looks like
- * @param encap_stop_buf debuf buffer for checking how the stop flag looks like
- * @param message_buf received message buffer
- * @param message_size received message size
- * @return 1 start flag ok message received successfully
- * @return 0 message received ok
- * @return -1 bad start flag
- * @return -2 message size < 1
- * @return -3 failed to malloc message buffer
- * @return -4 failed to to read the message from RX buffer
- * @return -5 failed malloc message buffer for queue message
- * @return -6 failed to send the message copy to queue
- * @return -7 bad stop flag
+ * @param parser uart parser
+ * @param data received bytes
+ * @param data_size number of received bytes
+ * @return number of messages passed to the message handler
  */
-int myuart_encapsulation_handler(uart_port_t uart_num, int *encap_state, int *pattern_index)
+int myuart_parser_feed(UartParser_type *parser, const uint8_t *data, size_t data_size)
 {
-	enum encap_states
-	{
-		START_FLAG_CONFIRMATION,
-		END_FLAG_CONFIRMATION,
-	};
-	const char *TAG = "ENCAP HANDLER";
-	uint8_t *tmp_message_buf = NULL;
-	int tmp_message_size = 0; // To store corrected message size
-	int error_code = 0;		  // To store the error code and then return it
+	int queued = 0;
 
-	switch (*encap_state)
+	for (size_t i = 0; i < data_size; i++)
 	{
-	case START_FLAG_CONFIRMATION:
-		/**
-		 * @brief Read and check the START FLAG
-		 */
-		if (myuart_encapsulation_start_flag_handler(UART_NUM, *pattern_index) == 0)
-		{
-			(*encap_state)++;
-			return 1; // Start flag OK, return immediately
-		}
-		else
-		{
-			ESP_LOGE(TAG, "Bad start flag");
-			error_code = -1; // Error code for bad start flag
-			goto memcleanup;
-		}
-		break;
+		uint8_t byte = data[i];
+		parser->window = ((parser->window << 8) | byte) & ENCAP_WINDOW_MASK;
 
-	case END_FLAG_CONFIRMATION:
-		tmp_message_size = *pattern_index - 1;
-
-		if (tmp_message_size < 1)
+		if (parser->state == PARSER_WAIT_START)
 		{
-			ESP_LOGE(TAG, "Message size %d is less than 1", tmp_message_size);
-			error_code = -2; // Error code for invalid message size
-			goto memcleanup;
-		}
-
-		tmp_message_buf = (uint8_t *)malloc(tmp_message_size * sizeof(uint8_t));
-		if (tmp_message_buf == NULL)
-		{
-			ESP_LOGE(TAG, "Failed to malloc tmp message buffer");
-			error_code = -3; // Error code for memory allocation failure
-			goto memcleanup;
+			if (parser->window == ENCAP_WINDOW(ENCAP_START_PAT))
+			{
+				myuart_parser_start(parser);
+			}
+			continue;
 		}
 
-		/**
-		 * @brief Read the MESSAGE bytes
-		 */
-		if (myuart_encapsulated_message_handler(UART_NUM, tmp_message_buf, tmp_message_size) == 0)
-		{
-			*pattern_index -= tmp_message_size;
-		}
-		else
+		if (parser->slot != NULL && parser->size < UART_MSG_SLOT_SIZE)
 		{
-			ESP_LOGE(TAG, "Failed to receive message");
-			error_code = -4; // Error code for failed message receipt
-			goto memcleanup;
+			parser->slot[parser->size] = byte;
 		}
+		parser->size++;
 
-		/**
-		 * @brief Read and check STOP FLAG
-		 */
-		if (myuart_encapsulation_end_flag_handler(UART_NUM, *pattern_index) == 0)
+		// The window is cleared on start, so both flags need three new bytes
+		if (parser->size >= ENCAP_FLAG_SIZE)
 		{
-			if (myuart_message_send_to_queue(tmp_message_buf, tmp_message_size) != 0)
+			if (parser->window == ENCAP_WINDOW(ENCAP_END_PAT))
 			{
-				ESP_LOGE(TAG, "Failed to send message to queue");
+				queued += myuart_parser_end(parser);
+			}
+			else if (parser->window == ENCAP_WINDOW(ENCAP_START_PAT))
+			{
+				parser->errors++;
+				myuart_parser_start(parser);
 			}
 		}
-		else
-		{
-			ESP_LOGE(TAG, "Bad stop flag");
-			error_code = -7; // Error code for failed stop flag
-		}
-		break;
-
-	default:
-		break;
-	}
-memcleanup:
-	if (tmp_message_buf != NULL)
-	{
-		free(tmp_message_buf);
 	}
-	*encap_state = 0;
-	uart_pattern_queue_reset(UART_NUM, UART_PAT_QUEUE_SIZE);
-	return error_code;
+	return queued;
 }
-
@@ -15,27 +15,46 @@
 #define UART_BAUD 460800
 #define UART_NUM UART_NUM_0
 #define UART_RX_BUFF_SIZE 1024
-#define UART_TX_BUFF_SIZE 0
+#define UART_TX_BUFF_SIZE (1024 * 8) /*!< Holds two float32 frame packets, writes return once queued*/
 #define UART_EVENT_QUEUE_SIZE 10 /*!< Number of UART ISR events queued*/
-#define UART_PAT_QUEUE_SIZE 8 /*!< Number of queued pattern index positions*/
 #define UART_TXD 43
 #define UART_RXD 44
 
 #define ENCAP_START_PAT "++*"
 #define ENCAP_END_PAT "*++"
-#define UART_PATTERN_SIZE (strlen((const char*)ENCAP_START_PAT) - 1)
-#define ENCAP_FLAG_SIZE strlen((const char*)ENCAP_START_PAT)
+#define ENCAP_FLAG_SIZE 3
+#define UART_RX_CHUNK_SIZE 128 /*!< Bytes moved from the transport RX buffer per read*/
+#define UART_MSG_SLOT_COUNT 4 /*!< Messages waiting for the message handler*/
+#define UART_MSG_SLOT_SIZE 128 /*!< Slot size, holds the message and the end flag*/
+#define UART_MSG_MAX_SIZE (UART_MSG_SLOT_SIZE - ENCAP_FLAG_SIZE)
+
+/**
+ * @brief Streaming parser of encapsulated messages
+ *
+ * Bytes are consumed as they arrive. The last three bytes are kept in window to match the start and
+ * end flags, the message is written straight into a slot taken from the message pool.
+ */
+typedef struct UartParser_type
+{
+	uint8_t state;
+	uint32_t window;   /*!< Last three received bytes*/
+	uint8_t *slot;	   /*!< Message slot, NULL when the pool was empty*/
+	size_t size;	   /*!< Bytes received since the start flag*/
+	uint32_t messages; /*!< Messages passed to the message queue*/
+	uint32_t errors;   /*!< Empty, oversized or restarted messages*/
+	uint32_t dropped;  /*!< Messages lost to a full message pool*/
+} UartParser_type;
 
 // Uart config struct
 extern uart_config_t uart_config;
 
 // init uart
 int myuart_init_with_isr_queue(uart_config_t *uart_config, uart_port_t port_num, int gpio_tx, int gpio_rx, int tx_buff_size, int rx_buff_size, QueueHandle_t *isr_queue_handle, int isr_queue_size, int intr_alloc_flags);
-int myuart_encapsulation_start_flag_handler(uart_port_t uart_num, int pattern_index);
-int myuart_encapsulation_end_flag_handler(uart_port_t uart_num, int pattern_index);
-int myuart_encapsulated_message_handler(uart_port_t uart_num, uint8_t *message_buf, int message_size);
-int myuart_message_send_to_queue(uint8_t *message, size_t message_size);
-int myuart_encapsulation_handler(uart_port_t uart_num, int *encap_state, int *pattern_index);
+// encapsulated messages
+int myuart_message_pool_init(void);
+void myuart_message_release(uint8_t *msg_ptr);
+void myuart_parser_reset(UartParser_type *parser);
+int myuart_parser_feed(UartParser_type *parser, const uint8_t *data, size_t data_size);
 
 
 #endif // UART_ISR_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,381 @@
+#include "uart_tx.h"
+
+static const Transport_type *uart_tx_transport;
+static FrameBusSubscriber_type *uart_tx_frame_subscriber;
+static QueueHandle_t queue_tx_control; // UartTxControl_type, served in order with frames, at most one frame ahead
+static QueueSetHandle_t queue_set_tx;  // control queue and frame subscriber queue
+static uint32_t uart_tx_control_sequence = 0;
+static UartTxCompleteCallback_type uart_tx_complete_callback = NULL;
+
+/**
+ * @brief Packet in the TX ring buffer, complete once end_offset bytes were drained
+ */
+typedef struct UartTxPending_type
+{
+	uint8_t type;
+	uint32_t sequence;
+	uint64_t end_offset;
+	int64_t queued_us;
+} UartTxPending_type;
+
+static UartTxPending_type uart_tx_pending[UART_TX_PENDING_SIZE];
+static uint8_t uart_tx_pending_head = 0;
+static uint8_t uart_tx_pending_count = 0;
+static uint64_t uart_tx_written = 0; // bytes queued since init
+
+UartTxStats_type uart_tx_stats = {0};
+
+/**
+ * @brief Create the control channel and the queue set shared with the frame channel
+ *
+ * Call before anything is published to frame_subscriber, queues must be empty when added to a set.
+ *
+ * @param transport link to the host, must outlive the transmit task
+ * @param frame_subscriber frame bus subscriber of the data channel, FRAME_BUS_DROP_NEWEST
+ * @return 0 OK
+ * @return -1 null pointer passed
+ * @return -2 failed to create the control queue
+ * @return -3 failed to create the queue set
+ */
+int uart_tx_init(const Transport_type *transport, FrameBusSubscriber_type *frame_subscriber)
+{
+	if (transport == NULL || frame_subscriber == NULL)
+	{
+		return -1;
+	}
+	queue_tx_control = xQueueCreate(UART_TX_CONTROL_QUEUE_SIZE, sizeof(UartTxControl_type));
+	if (queue_tx_control == NULL)
+	{
+		return -2;
+	}
+	queue_set_tx = xQueueCreateSet(UART_TX_CONTROL_QUEUE_SIZE + FRAME_BUS_POOL_SIZE);
+	if (queue_set_tx == NULL)
+	{
+		return -3;
+	}
+	xQueueAddToSet(queue_tx_control, queue_set_tx);
+	xQueueAddToSet(frame_subscriber->queue, queue_set_tx);
+	uart_tx_transport = transport;
+	uart_tx_frame_subscriber = frame_subscriber;
+	return 0;
+}
+
+/**
+ * @brief Set the packet completion callback
+ *
+ * The callback runs in the transmit task and must not block.
+ *
+ * @param callback completion callback, NULL to disable
+ */
+void uart_tx_set_complete_callback(UartTxCompleteCallback_type callback)
+{
+	uart_tx_complete_callback = callback;
+}
+
+/**
+ * @brief Bytes waiting in the transport TX buffer, 0 when unknown
+ *
+ * The uart hardware FIFO is not included, so a packet completes up to one FIFO before its last byte is on the wire.
+ */
+static size_t uart_tx_queued_bytes(void)
+{
+	size_t queued = 0;
+	if (transport_tx_queued(uart_tx_transport, &queued) != 0 || queued > uart_tx_transport->tx_buffer_size)
+	{
+		return 0;
+	}
+	return queued;
+}
+
+/**
+ * @brief Link backpressure seen by the frame producer
+ *
+ * @return UART_TX_BACKPRESSURE_NONE, UART_TX_BACKPRESSURE_HIGH or UART_TX_BACKPRESSURE_FULL
+ */
+uint8_t uart_tx_backpressure(void)
+{
+	size_t buffer_size = uart_tx_transport->tx_buffer_size;
+	size_t queued = uart_tx_queued_bytes();
+	if (buffer_size == 0)
+	{
+		return UART_TX_BACKPRESSURE_NONE;
+	}
+	if (buffer_size - queued < sizeof(MlxPacketHeader_type) + MLX_PACKET_MAX_PAYLOAD + MLX_PACKET_CRC_SIZE)
+	{
+		return UART_TX_BACKPRESSURE_FULL;
+	}
+	if (queued > buffer_size / 2)
+	{
+		return UART_TX_BACKPRESSURE_HIGH;
+	}
+	return UART_TX_BACKPRESSURE_NONE;
+}
+
+/**
+ * @brief Complete the packets that left the TX ring buffer
+ *
+ * @return number of packets still pending
+ */
+int uart_tx_poll_complete(void)
+{
+	size_t queued = uart_tx_queued_bytes();
+	uint64_t drained = uart_tx_written - queued;
+	int64_t now = esp_timer_get_time();
+
+	uart_tx_stats.queued_bytes = queued;
+	while (uart_tx_pending_count > 0 && uart_tx_pending[uart_tx_pending_head].end_offset <= drained)
+	{
+		UartTxPending_type *pending = &uart_tx_pending[uart_tx_pending_head];
+		if (uart_tx_complete_callback != NULL)
+		{
+			uart_tx_complete_callback(pending->type, pending->sequence, now - pending->queued_us);
+		}
+		uart_tx_pending_head = (uart_tx_pending_head + 1) % UART_TX_PENDING_SIZE;
+		uart_tx_pending_count--;
+		uart_tx_stats.completed++;
+	}
+	return uart_tx_pending_count;
+}
+
+/**
+ * @brief Copy a packet into the transport TX buffer and track its completion
+ *
+ * Transport writes return once the bytes are buffered. They only block when the buffer is full,
+ * which the producer avoids by reacting to uart_tx_backpressure.
+ */
+static void uart_tx_queue_packet(const MlxPacketHeader_type *header, const uint8_t *payload)
+{
+	// Wait for a tracking slot, only when many small packets are queued
+	while (uart_tx_pending_count >= UART_TX_PENDING_SIZE && uart_tx_poll_complete() >= UART_TX_PENDING_SIZE)
+	{
+		vTaskDelay(pdMS_TO_TICKS(UART_TX_POLL_MS));
+	}
+
+	mlx_packet_write(uart_tx_transport, header, payload);
+	uart_tx_written += sizeof(*header) + header->payload_length + MLX_PACKET_CRC_SIZE;
+
+	UartTxPending_type *pending = &uart_tx_pending[(uart_tx_pending_head + uart_tx_pending_count) % UART_TX_PENDING_SIZE];
+	pending->type = header->type;
+	pending->sequence = header->sequence;
+	pending->end_offset = uart_tx_written;
+	pending->queued_us = esp_timer_get_time();
+	uart_tx_pending_count++;
+}
+
+/**
+ * @brief Append response bytes, the response is truncated at UART_TX_CONTROL_MAX_SIZE
+ *
+ * Matches CommandResponse_type.write with a UartTxControl_type as context.
+ *
+ * @param control UartTxControl_type being built
+ * @param data response bytes
+ * @param size number of bytes
+ */
+void uart_tx_control_append(void *control, const void *data, size_t size)
+{
+	UartTxControl_type *tx_control = (UartTxControl_type *)control;
+	size_t free_size = UART_TX_CONTROL_MAX_SIZE - tx_control->size;
+	size = (size < free_size) ? size : free_size;
+	memcpy(&tx_control->data[tx_control->size], data, size);
+	tx_control->size += size;
+}
+
+/**
+ * @brief Queue a response for the control channel
+ *
+ * @param control response, copied into the queue
+ * @return 0 OK
+ * @return -1 null pointer passed
+ * @return -2 control queue full
+ */
+int uart_tx_send_control(UartTxControl_type *control)
+{
+	if (control == NULL)
+	{
+		return -1;
+	}
+	control->timestamp_us = esp_timer_get_time();
+	if (xQueueSend(queue_tx_control, control, pdMS_TO_TICKS(UART_TX_CONTROL_WAIT_MS)) != pdTRUE)
+	{
+		return -2;
+	}
+	return 0;
+}
+
+/**
+ * @brief Queue a text response for the control channel
+ *
+ * @return uart_tx_send_control return value
+ */
+int uart_tx_send_text(const char *text)
+{
+	UartTxControl_type control = {0};
+	uart_tx_control_append(&control, text, strlen(text));
+	return uart_tx_send_control(&control);
+}
+
+/**
+ * @brief Write the oldest queued response as an MLX_PACKET_RESPONSE packet
+ *
+ * Only call after xQueueSelectFromSet returned the control queue, every item holds one handle in the set.
+ *
+ * @return 1 a packet was written
+ * @return 0 no response was queued
+ */
+int uart_tx_write_control(void)
+{
+	UartTxControl_type control;
+	MlxPacketHeader_type header;
+
+	if (xQueueReceive(queue_tx_control, &control, 0) != pdTRUE)
+	{
+		return 0;
+	}
+	mlx_packet_header_init(&header, MLX_PACKET_RESPONSE, uart_tx_control_sequence++, control.timestamp_us, control.size);
+	uart_tx_queue_packet(&header, control.data);
+	return 1;
+}
+
+/**
+ * @brief Wait for the next packet to send
+ *
+ * Responses and frames are served in the order they were queued, one per call, so a response waits for
+ * at most the frames queued before it. While packets are in the TX ring buffer the wait wakes up every
+ * UART_TX_POLL_MS to complete them.
+ *
+ * @param ticks_to_wait max wait for either channel
+ * @return FrameBuffer_type* next frame, release it after uart_tx_write_frame
+ * @return NULL a response was sent or timeout
+ */
+FrameBuffer_type *uart_tx_wait(TickType_t ticks_to_wait)
+{
+	TickType_t poll_ticks = pdMS_TO_TICKS(UART_TX_POLL_MS);
+	if (uart_tx_pending_count > 0 && ticks_to_wait > poll_ticks)
+	{
+		ticks_to_wait = (poll_ticks > 0) ? poll_ticks : 1;
+	}
+	// Receive only from the member the set returned, the set holds one handle per queued item
+	QueueSetMemberHandle_t member = xQueueSelectFromSet(queue_set_tx, ticks_to_wait);
+	if (member == (QueueSetMemberHandle_t)queue_tx_control)
+	{
+		uart_tx_write_control();
+	}
+	uart_tx_poll_complete();
+	if (member == (QueueSetMemberHandle_t)uart_tx_frame_subscriber->queue)
+	{
+		return frame_bus_receive(uart_tx_frame_subscriber, 0);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Queue a frame as one MLX_PACKET_FRAME packet
+ *
+ * Frame bytes are copied straight from the shared frame buffer into the TX ring buffer,
+ * the frame can be released when this returns.
+ *
+ * @param frame published frame
+ * @return 0 OK
+ * @return -1 null pointer passed
+ */
+int uart_tx_write_frame(const FrameBuffer_type *frame)
+{
+	MlxPacketHeader_type header;
+
+	if (frame == NULL)
+	{
+		return -1;
+	}
+	const uint8_t *payload = (frame->pixel_format == MLX_PIXEL_FLOAT32) ? (const uint8_t *)frame->temps : frame->encoded.u8;
+	mlx_packet_header_init(&header, MLX_PACKET_FRAME, frame->sequence, frame->timestamp_us, frame->encoded_size);
+	header.pixel_format = frame->pixel_format;
+	header.subpage = frame->subpage;
+	header.ta = frame->ta;
+	header.offset = frame->offset;
+	header.scale = frame->scale;
+	uart_tx_queue_packet(&header, payload);
+	return 0;
+}
+
+/**
+ * @brief Queue the sensor EEPROM as one MLX_PACKET_EEPROM packet
+ *
+ * Hosts need it to calibrate MLX_PIXEL_RAW frames, it is written ahead of the first raw frame.
+ *
+ * @param eeprom_dump MLX90640_DumpEE words
+ * @return 0 OK
+ * @return -1 null pointer passed
+ */
+int uart_tx_write_eeprom(const uint16_t *eeprom_dump)
+{
+	MlxPacketHeader_type header;
+
+	if (eeprom_dump == NULL)
+	{
+		return -1;
+	}
+	mlx_packet_header_init(&header, MLX_PACKET_EEPROM, uart_tx_control_sequence++, esp_timer_get_time(), MLX_PACKET_EEPROM_WORDS * sizeof(uint16_t));
+	uart_tx_queue_packet(&header, (const uint8_t *)eeprom_dump);
+	return 0;
+}
+
+/**
+ * @brief Queue entries of the I2C trace as one MLX_PACKET_I2C_TRACE packet
+ *
+ * @param data whole mlx_i2c_trace entries
+ * @param size bytes, at most MLX_PACKET_MAX_PAYLOAD
+ * @return 0 OK
+ * @return -1 null pointer passed or size too large
+ */
+int uart_tx_write_i2c_trace(const uint8_t *data, uint16_t size)
+{
+	MlxPacketHeader_type header;
+
+	if (data == NULL || size > MLX_PACKET_MAX_PAYLOAD)
+	{
+		return -1;
+	}
+	mlx_packet_header_init(&header, MLX_PACKET_I2C_TRACE, uart_tx_control_sequence++, esp_timer_get_time(), size);
+	uart_tx_queue_packet(&header, data);
+	return 0;
+}
+
+/**
+ * @brief Queue the pipeline times of a sent frame as one MLX_PACKET_LATENCY packet
+ *
+ * @param record times of the frame, its sequence number is in the payload
+ * @return 0 OK
+ * @return -1 null pointer passed
+ */
+int uart_tx_write_latency(const MlxLatencyRecord_type *record)
+{
+	MlxPacketHeader_type header;
+
+	if (record == NULL)
+	{
+		return -1;
+	}
+	mlx_packet_header_init(&header, MLX_PACKET_LATENCY, uart_tx_control_sequence++, record->request_us, sizeof(MlxLatencyRecord_type));
+	uart_tx_queue_packet(&header, (const uint8_t *)record);
+	return 0;
+}
+
+/**
+ * @brief Write the transmit status as text
+ *
+ * @param buf output buffer
+ * @param size output buffer size
+ * @return number of characters written (snprintf semantics)
+ */
+int uart_tx_format(char *buf, size_t size)
+{
+	const char *level_names[] = {"NONE", "HIGH", "FULL"};
+	return snprintf(buf, size, "QUEUED %lu OF %u LEVEL %s PENDING %u SENT %lu SKIPPED %lu COMPACT %lu",
+					(unsigned long)uart_tx_stats.queued_bytes,
+					(unsigned)uart_tx_transport->tx_buffer_size,
+					level_names[uart_tx_backpressure()],
+					uart_tx_pending_count,
+					(unsigned long)uart_tx_stats.completed,
+					(unsigned long)uart_tx_stats.skipped,
+					(unsigned long)uart_tx_stats.compacted);
+}
@@ -0,0 +1,74 @@
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "frame_bus.h"
+#include "mlx_protocol.h"
+#include "transport.h"
+
+#define UART_TX_CONTROL_QUEUE_SIZE 4  /*!< Responses waiting for the link*/
+#define UART_TX_CONTROL_MAX_SIZE 128  /*!< Response payload size*/
+#define UART_TX_CONTROL_WAIT_MS 50	  /*!< Max wait for a free control queue entry*/
+#define UART_TX_PENDING_SIZE 16		  /*!< Packets tracked until they leave the TX ring buffer*/
+#define UART_TX_POLL_MS 2			  /*!< Completion polling period while packets are pending*/
+
+// Backpressure levels
+#define UART_TX_BACKPRESSURE_NONE 0 /*!< Send frames as configured*/
+#define UART_TX_BACKPRESSURE_HIGH 1 /*!< More than half of the TX buffer queued, send compact frames*/
+#define UART_TX_BACKPRESSURE_FULL 2 /*!< A float32 frame would not fit, skip the frame*/
+// Transports that cannot report their TX buffer fill level always report UART_TX_BACKPRESSURE_NONE
+
+/**
+ * @brief Control channel packet, a command response
+ */
+typedef struct UartTxControl_type
+{
+	uint16_t size;
+	int64_t timestamp_us;
+	uint8_t data[UART_TX_CONTROL_MAX_SIZE];
+} UartTxControl_type;
+
+/**
+ * @brief Called by the transmit task when a packet left the TX ring buffer
+ *
+ * @param type MLX_PACKET_* type of the packet
+ * @param sequence packet sequence number
+ * @param link_us time from queueing the packet until it left the TX ring buffer
+ */
+typedef void (*UartTxCompleteCallback_type)(uint8_t type, uint32_t sequence, uint32_t link_us);
+
+/**
+ * @brief Transmit statistics, the producer counts its backpressure reactions
+ */
+typedef struct UartTxStats_type
+{
+	uint32_t queued_bytes; // in the transport TX buffer at the last poll
+	uint32_t completed;	   // packets that left the TX ring buffer
+	uint32_t skipped;	   // frames skipped on UART_TX_BACKPRESSURE_FULL
+	uint32_t compacted;	   // frames sent as int16 on UART_TX_BACKPRESSURE_HIGH
+} UartTxStats_type;
+
+extern UartTxStats_type uart_tx_stats;
+
+int uart_tx_init(const Transport_type *transport, FrameBusSubscriber_type *frame_subscriber);
+void uart_tx_set_complete_callback(UartTxCompleteCallback_type callback);
+uint8_t uart_tx_backpressure(void);
+int uart_tx_poll_complete(void);
+int uart_tx_format(char *buf, size_t size);
+void uart_tx_control_append(void *control, const void *data, size_t size);
+int uart_tx_send_control(UartTxControl_type *control);
+int uart_tx_send_text(const char *text);
+int uart_tx_write_control(void);
+FrameBuffer_type *uart_tx_wait(TickType_t ticks_to_wait);
+int uart_tx_write_frame(const FrameBuffer_type *frame);
+int uart_tx_write_eeprom(const uint16_t *eeprom_dump);
+int uart_tx_write_i2c_trace(const uint8_t *data, uint16_t size);
+int uart_tx_write_latency(const MlxLatencyRecord_type *record);
+
+#endif // UART_TX_H